@@ -25,6 +25,22 @@
 #define SDP_EOF_SIZE  1 // number of EOF bytes
 #define SDP_ACK_SIZE  1 // number of acknowledgement bytes
 #define SDP_CRC_SIZE  2 // number of CRC bytes
+#define SDP_COBS_BLOCK_SIZE 254  // COBS framing: max number of non-zero bytes after each code byte
+#define SDP_FLAGS_NONE 0x00 // length framing: FLAGS header field value (reserved for protocol extensions)
+
+// link control frames (ACK field == SDP_CTRL), first payload byte is opcode
+#define SDP_CTRL_HELLO  0x01  // HELLO | VERSION | MAX_PAYLOAD | WINDOW | FRAMINGS | OPTIONS | BAUDRATES (msb, lsb)
+#define SDP_CTRL_SWITCH 0x02  // SWITCH | FRAMING | MAX_PAYLOAD | WINDOW | OPTIONS | BAUD_INDEX -> response: SWITCH | STATUS
+#define SDP_CTRL_CONFIRM  0x03  // CONFIRM - sent with new settings
+#define SDP_CTRL_TOKEN  0x04  // TOKEN - token ring: receiver becomes token holder -> response: TOKEN
+#define SDP_CTRL_GROUP_POLL 0x05  // GROUP_POLL | GROUP -> response: GROUP_POLL | GROUP | SEQ | RECEIVED (lsb, msb)
+#define SDP_CTRL_HELLO_SIZE 8
+#define SDP_CTRL_SWITCH_SIZE  6
+#define SDP_CTRL_GROUP_POLL_SIZE  5
+#define SDP_LINK_VERSION  1 // link control frames version
+#define SDP_BAUD_KEEP 0xFF  // SWITCH frame BAUD_INDEX: do not change baud rate
+#define SDP_BAUDRATE_COUNT  10  // number of SDP_BAUD_xxx values
+#define SDP_FEC_POLYNOME  0x1D  // FEC option: GF(2^8) primitive polynomial x^8 + x^4 + x^3 + x^2 + 1 (0x11D), x^8 term is implicit
 
 // RX
 static void search_for_sof(SDP_data_t *node);
@@ -34,10 +50,139 @@ static void check_if_eof(SDP_data_t *node);
 static bool rx_frame_timeout(SDP_data_t *node);
 static bool check_rx_message(SDP_data_t *node);
 static bool rx_data_put(SDP_data_t *node, uint8_t data);
+static void handle_rx_frame(SDP_data_t *node);
+static void handle_request(SDP_data_t *node);
+static void receive_notification(SDP_data_t *node);
+static void notify_record(SDP_data_t *node, uint8_t seq);
+static void receive_datagram(SDP_data_t *node);
+static void append_cobs_data(SDP_data_t *node);
+static bool cobs_rx_put(SDP_data_t *node, uint8_t data);
+static void receive_header(SDP_data_t *node);
+static void receive_length_data(SDP_data_t *node);
+static void receive_address(SDP_data_t *node);
+static bool check_rx_address(SDP_data_t *node, uint8_t *address);
+static uint8_t address_filter(SDP_data_t *node, uint8_t *data);
+static uint8_t filter_length_header(SDP_data_t *node, uint8_t *data);
+static uint8_t filter_dst(SDP_data_t *node, uint8_t *data, uint8_t dst, bool held_code);
+static void rx_buffer_put(SDP_data_t *node, uint8_t *data, uint8_t size);
 // TX
 static bool sdp_transmit_data(SDP_data_t *node);  
 static bool compose_frame(SDP_data_t *node, uint8_t ack, uint8_t *data, uint8_t size);
 static bool append_crc_bytes(SDP_data_t *node, uint16_t crc_value);
+static bool compose_cobs_frame(SDP_data_t *node, uint8_t ack, uint8_t *data, uint8_t size, bool append_crc);
+static bool cobs_put_byte(SDP_data_t *node, uint8_t data);
+static bool compose_length_frame(SDP_data_t *node, uint8_t ack, uint8_t *data, uint8_t size);
+static bool send_empty_frame(SDP_data_t *node, uint8_t ack);
+static bool send_nack(SDP_data_t *node, uint8_t reason);
+static uint8_t get_nack_reason(SDP_data_t *node);
+static void send_fast_nack(SDP_data_t *node, uint8_t reason);
+static bool send_datagram(SDP_data_t *node, uint8_t *payload, uint8_t payload_size);
+static bool send_group_frame(SDP_data_t *node, uint8_t *payload, uint8_t payload_size);
+// Link
+static bool negotiate_link(SDP_data_t *node);
+static bool send_frame(SDP_data_t *node, uint8_t dst, uint8_t ack, uint8_t *payload, uint8_t payload_size);
+static void handle_control_frame(SDP_data_t *node);
+static void compose_hello(SDP_data_t *node, uint8_t *payload);
+static void select_link_settings(SDP_data_t *node, uint8_t *peer_hello, uint8_t *settings);
+static bool check_link_settings(SDP_data_t *node, uint8_t *settings);
+static bool apply_link_settings(SDP_data_t *node, uint8_t *settings);
+static void link_fallback(SDP_data_t *node);
+// Token ring
+static bool wait_for_token(SDP_data_t *node);
+static void token_service(SDP_data_t *node);
+static void send_token(SDP_data_t *node);
+// Request ID
+static uint8_t get_id_size(SDP_data_t *node);
+static bool is_response(SDP_data_t *node);
+static bool receive_prefix(SDP_data_t *node);
+static uint8_t new_request_id(SDP_data_t *node);
+static uint8_t get_request_window(SDP_data_t *node);
+static SDP_request_t * get_free_request(SDP_data_t *node);
+static bool open_request(SDP_data_t *node, SDP_request_t *request, uint8_t channel, uint8_t dst, uint8_t *payload, uint8_t payload_size, SDP_response_callback_t callback);
+static SDP_request_t * find_request(SDP_data_t *node, uint8_t id);
+static void handle_request_response(SDP_data_t *node, SDP_request_t *request);
+static bool transmit_request(SDP_data_t *node, SDP_request_t *request);
+static void retry_request(SDP_data_t *node, SDP_request_t *request);
+static void close_request(SDP_data_t *node, SDP_request_t *request, bool status);
+static void request_service(SDP_data_t *node);
+// Channels
+static uint8_t get_channel_size(SDP_data_t *node);
+static uint8_t get_prefix_size(SDP_data_t *node);
+static uint8_t select_channel(SDP_data_t *node);
+static void channel_service(SDP_data_t *node);
+// Response cache
+static SDP_cached_response_t * find_cached_response(SDP_data_t *node, uint8_t address, uint8_t id);
+static bool replay_response(SDP_data_t *node);
+static void cache_response(SDP_data_t *node, uint8_t address, uint8_t id, uint8_t *payload, uint8_t payload_size);
+static void clear_cached_responses(SDP_data_t *node, uint8_t address);
+// Adaptive timeout
+static uint32_t get_timeout(SDP_data_t *node, bool link_acked);
+static uint32_t get_retransmit_delay(SDP_data_t *node);
+static void rtt_sample(SDP_data_t *node, uint32_t rtt);
+static void rto_backoff(SDP_data_t *node);
+static void rtt_reset(SDP_data_t *node);
+// Adaptive payload
+static void payload_success(SDP_data_t *node);
+static void payload_error(SDP_data_t *node);
+// Aggregation
+static void receive_batch(SDP_data_t *node);
+static void batch_service(SDP_data_t *node);
+// Groups
+static bool is_own_address(SDP_data_t *node, uint8_t address);
+static void receive_group_frame(SDP_data_t *node);
+static void group_record(SDP_data_t *node, uint8_t group, uint8_t address, uint8_t seq);
+static SDP_group_rx_t * find_group_rx(SDP_data_t *node, uint8_t group, uint8_t address);
+// Credits
+static uint8_t get_credit_size(SDP_data_t *node);
+static uint8_t get_rx_credit(SDP_data_t *node);
+static uint8_t get_frame_credits(SDP_data_t *node, uint8_t payload_size);
+static bool has_credit(SDP_data_t *node, uint8_t dst, uint8_t payload_size, bool probe);
+static bool wait_for_credit(SDP_data_t *node, uint8_t dst, uint8_t payload_size);
+static void update_credits(SDP_data_t *node, uint32_t mark);
+// Redundancy
+static uint8_t get_copies(SDP_data_t *node, uint8_t ack);
+static void transmit_copies(SDP_data_t *node, uint8_t copies);
+static bool transmit_hedge(SDP_data_t *node, uint8_t dst, uint8_t id, uint8_t channel, uint8_t ack, uint8_t *payload, uint8_t payload_size);
+// Deadlines
+static uint32_t get_deadline(SDP_data_t *node);
+static bool is_expired(uint32_t deadline);
+static bool is_earlier(uint32_t deadline, uint32_t other);
+static uint8_t earliest_queued(SDP_channel_t *ch);
+static uint32_t get_queued_deadline(SDP_channel_t *ch);
+static void move_queued(SDP_channel_t *ch, uint8_t from, uint8_t to);
+static void expire_queued(SDP_data_t *node);
+// Link bonding
+static void receive_bond_frame(SDP_data_t *node);
+static void deliver_bonded(SDP_data_t *node);
+static void skip_bonded(SDP_data_t *node);
+static void bond_service(SDP_data_t *node);
+static bool is_bond_window_full(SDP_data_t *node);
+// Fast path
+static void fast_receive(SDP_data_t *node, uint8_t data);
+static bool fast_handle_frame(SDP_data_t *node);
+static SDP_fast_handler_t find_fast_handler(SDP_data_t *node, uint8_t opcode);
+static uint8_t fast_decode(SDP_data_t *node, uint8_t *frame);
+static uint8_t fast_compose(SDP_data_t *node, uint8_t *frame, uint8_t size);
+static void fast_timeout(SDP_data_t *node);
+// Forward error correction
+static uint8_t get_fec_size(SDP_data_t *node);
+static bool fec_correct(SDP_data_t *node);
+static bool receive_parity(SDP_data_t *node);
+static void fec_encode(uint8_t *data, uint8_t size, uint8_t *parity);
+static int8_t fec_decode(uint8_t *data, uint8_t size);
+static uint8_t gf_mul(uint8_t a, uint8_t b);
+static uint8_t gf_pow(uint8_t a, uint8_t n);
+// Other
+static uint16_t get_max_frame_size(SDP_framing_t framing, uint8_t payload_size, uint8_t address_size);
+static bool resize_frame_buffers(SDP_data_t *node);
+static void wait_parsing(SDP_data_t *node, uint32_t delay);
+static uint16_t fast_crc(uint8_t *data, uint8_t size);
+
+static const uint32_t sdp_baudrates[SDP_BAUDRATE_COUNT] = {9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600, 1000000, 2000000};
+// CRC-16 (SDP_CRC_POLYNOME, initial value 0) of each 4-bit value, CRC in RX interrupt doesn't use sdp_user_calculate_crc()
+static const uint16_t sdp_crc_nibbles[16] = {0x0000, 0x8005, 0x800F, 0x000A, 0x801B, 0x001E, 0x0014, 0x8011, 
+                                             0x8033, 0x0036, 0x003C, 0x8039, 0x0028, 0x802D, 0x8027, 0x0022};
+static const SDP_framing_t sdp_framing_preference[] = {SDP_FRAMING_LENGTH, SDP_FRAMING_COBS, SDP_FRAMING_DLE}; // negotiation: most efficient first
 
 /* Init and parsers ------------------------------------------------------------------*/
 /**
@@ -48,12 +193,18 @@ static bool append_crc_bytes(SDP_data_t *node, uint16_t crc_value);
 //bool sdp_init_node(SDP_data_t *node, SDP_uart_t *uart_handle, uint8_t id){
 bool sdp_init_node(SDP_data_t *node, SDP_uart_t *uart_handle, uint8_t id, uint8_t payload_size, uint8_t rx_buff_count){
   uint16_t rx_buff_size;
+  uint8_t i;
   
   node->uart = *uart_handle;
   node->id = id;
   
   node->rx_tx_max_payload = payload_size;
-  node->_max_frame_size = (SDP_SOF_SIZE  + SDP_ACK_SIZE + payload_size*2+ SDP_CRC_SIZE*2 + SDP_EOF_SIZE ); // payload/crc worst case = *2 - if every byte is special character, escaped with DLE
+  node->framing = SDP_DEFAULT_FRAMING;
+  node->options = 0;
+  node->_address_size = 0; // point-to-point, enable with sdp_set_addressing()
+  node->_max_frame_size = get_max_frame_size(node->framing, payload_size, node->_address_size);
+  node->_alloc_frame_size = node->_max_frame_size;
+  node->_rx_buff_count = rx_buff_count;
   
   // init rx ring buffer for storing all received bytes
   rx_buff_size = (node->_max_frame_size * rx_buff_count) +1;
@@ -66,7 +217,7 @@ bool sdp_init_node(SDP_data_t *node, SDP_uart_t *uart_handle, uint8_t id, uint8_
   node->rx_msg_timeout = SDP_DEFAULT_RX_MSG_TIMEOUT;
   
   // init rx payload "array"
-  node->rx_data = calloc(node->rx_tx_max_payload +1, sizeof(uint8_t)); // allocate memory of payload bytes, set all values to 0.
+  node->rx_data = calloc(node->rx_tx_max_payload + SDP_REQUEST_ID_SIZE + SDP_CHANNEL_SIZE + SDP_CREDIT_SIZE + SDP_FEC_SIZE + SDP_CRC_SIZE, sizeof(uint8_t)); // allocate memory of (ID + channel + credit +) payload (+ parity) + CRC bytes, set all values to 0.
   if(node->rx_data == NULL){  // buff must not be pointer to nowhere
     sdp_debug(node, 41);
     return false;
@@ -84,17 +235,547 @@ bool sdp_init_node(SDP_data_t *node, SDP_uart_t *uart_handle, uint8_t id, uint8_
   
   node->ack = SDP_ACK;
   node->_expect_response = false;
+  node->_sending = false;
+  node->_handler_time = 0;
   node->response_timeout = SDP_DEFAULT_RESPONSE_TIMEOUT;
+  node->ack_timeout = SDP_DEFAULT_ACK_TIMEOUT;
+  node->_link_acked = true;
+  node->notify_handler = NULL;
+  node->notify_seq = 0;
+  node->notify_lost = 0;
+  node->_notify_tx_seq = 0;
+  node->_notify_rx_seq = 0;
+  node->_notify_src = 0;
+  node->_notify_synced = false;
+  node->nack_reason = SDP_NACK_UNKNOWN;
+  node->_nack_time = 0;
+  node->fec_corrected = 0;
+  node->rx_crc_errors = 0;
+  node->tx_errors = 0;
+  node->tx_qos = SDP_QOS_RELIABLE;
+  node->tx_copies = 1;
+  node->hedge_delay = 0;
+  node->tx_redundant = 0;
+  node->tx_deadline = 0;
+  node->tx_expired = 0;
+  node->_request_deadline = 0;
+  node->tx_dropped = 0;
+  node->rx_dropped = 0;
+  
+  // groups (addressing mode), join with sdp_set_group()
+  node->group_seq = 0;
+  node->_rx_dst = 0;
+  node->_groups = (1 << (SDP_BROADCAST_ADDRESS - SDP_GROUP_ADDRESS));
+  for(i = 0; i < SDP_GROUP_COUNT; i++){
+    node->_group_tx_seq[i] = 0;
+  }
+  for(i = 0; i < SDP_GROUP_SENDERS; i++){
+    memset(&node->_group_rx[i], 0, sizeof(SDP_group_rx_t));
+  }
+  node->_group_rx_next = 0;
+  
+  // credits option (disabled by default), first frame is sent without credits
+  node->credit_stalls = 0;
+  node->_rx_credit = 0;
+  node->_tx_credit_used = 0;
+  node->_tx_credit_limit = 0;
+  node->_credit_mark = 0;
+  node->_credit_dst = 0;
+  
+  // link bonding (disabled by default), buffers are allocated by sdp_set_bond()
+  node->_bond = NULL;
+  node->_bond_count = 0;
+  node->_bond_next = 0;
+  node->_bond_tx_seq = 0;
+  node->_bond_tx = NULL;
+  node->_bond_rx_seq = 0;
+  node->_bond_rx_count = 0;
+  node->_bond_gap_time = 0;
+  for(i = 0; i < SDP_BOND_WINDOW; i++){
+    node->_bond_rx[i] = NULL;
+    node->_bond_rx_size[i] = 0;
+    node->_bond_skipped[i] = false;
+  }
+  
+  // fast path (disabled by default), register handlers with sdp_set_fast_handler()
+  node->fast_responses = 0;
+  node->_tx_busy = false;
+  node->_fast_count = 0;
+  node->_fast_state = SDP_FAST_IDLE;
+  node->_fast_rx_size = 0;
+  node->_fast_remaining = 0;
+  node->_fast_rx_time = 0;
+  node->_fast_tx_busy = false;
+  
+  node->min_payload = 0;  // adaptive payload disabled, enable with sdp_set_adaptive_payload()
+  node->tx_payload = payload_size;
+  node->_payload_growth = 0;
+  
+  // aggregation (disabled by default), batch buffer is allocated by sdp_set_aggregation()
+  node->batch_delay = SDP_DEFAULT_BATCH_DELAY;
+  node->batch_threshold = 0;
+  node->_batch = NULL;
+  node->_batch_size = 0;
+  node->_batch_dst = 0;
+  node->_batch_time = 0;
+  node->_batch_sending = false;
+  node->_suppress_response = false;
+  node->rto_min = SDP_DEFAULT_RTO_MIN;
+  node->rto_max = 0;  // adaptive timeout disabled, enable with sdp_set_adaptive_timeout()
+  rtt_reset(node);
+  
+  // link capabilities and initial settings
+  node->caps.max_payload = payload_size;
+  node->caps.window = SDP_MAX_REQUESTS;
+  node->caps.framings = (1 << SDP_FRAMING_DLE) | (1 << SDP_FRAMING_COBS) | (1 << SDP_FRAMING_LENGTH);
+  node->caps.options = 0;
+  node->caps.baudrates = 0;
+  node->link_state = SDP_LINK_INIT;
+  node->baudrate = node->uart.baudrate;
+  node->_base_framing = node->framing;
+  node->_base_max_payload = payload_size;
+  node->_base_options = node->options;
+  
+  // addressing mode (disabled by default)
+  node->tx_address = 0;
+  node->rx_address = 0;
+  node->_tx_dst = 0;
+  node->_filter_state = SDP_FILTER_IDLE;
+  node->_filter_count = 0;
+  node->_filter_header_index = 0;
+  
+  // token ring (disabled by default)
+  node->token = false;
+  node->token_hold_time = SDP_DEFAULT_TOKEN_HOLD_TIME;
+  node->token_timeout = SDP_DEFAULT_TOKEN_TIMEOUT;
+  node->_token_ring = NULL;
+  node->_token_ring_size = 0;
+  node->_token_wanted = false;
+  node->_token_next = 0;
+  
+  // request ID option (disabled by default)
+  node->rx_id = 0;
+  node->_tx_id = 0;
+  node->_next_id = 0;
+  node->_request_count = 0;
+  // payload with prefix (ID, channel, credit, group/notification sequence) and parity bytes, used by all prefix options
+  node->_tx_payload = calloc(node->rx_tx_max_payload + SDP_REQUEST_ID_SIZE + SDP_CHANNEL_SIZE + SDP_CREDIT_SIZE + SDP_FEC_SIZE, sizeof(uint8_t));
+  if(node->_tx_payload == NULL){
+    sdp_debug(node, 43);
+    return false;
+  }
+  for(i = 0; i < SDP_MAX_REQUESTS; i++){
+    node->_requests[i].active = false;
+    node->_requests[i].payload = NULL; // allocated when slot is used first time, see get_free_request()
+  }
+  
+  // channels option (disabled by default), channel TX queues are allocated by sdp_set_channel()
+  node->tx_channel = 0;
+  node->rx_channel = 0;
+  node->_tx_channel = 0;
+  node->_queued_count = 0;
+  for(i = 0; i < SDP_MAX_CHANNELS; i++){
+    memset(&node->_channels[i], 0, sizeof(SDP_channel_t));
+  }
+  
+  // response cache (disabled by default), allocated by sdp_set_response_cache()
+  node->_cache_size = 0;
+  node->_cache_next = 0;
+  for(i = 0; i < SDP_RESPONSE_CACHE_SIZE; i++){
+    memset(&node->_cache[i], 0, sizeof(SDP_cached_response_t));
+  }
     
   return true;
 }
 
+/**
+* @brief Change node frame encoding. Rx buffer and tx data array are re-allocated to fit new worst case frame size.
+* @note Call this function after sdp_init_node() and before RXNE interrupt is enabled. Both nodes must use the same framing.
+*/
+bool sdp_set_framing(SDP_data_t *node, SDP_framing_t framing){
+  node->framing = framing;
+  node->_base_framing = framing;
+  node->_rx_state = SDP_RX_IDLE;
+  node->_filter_state = SDP_FILTER_IDLE;
+  node->_fast_state = SDP_FAST_IDLE;
+  
+  return resize_frame_buffers(node);
+}
+
+/**
+* @brief Enable/disable addressing mode (multi-drop bus, like RS-485). Each frame carries DST and SRC address 
+*        after start byte: node->id is address of this node, node->tx_address is destination of sdp_send_data() 
+*        frames and responses are sent to source of received frame (node->rx_address).
+*        Frames addressed to other nodes are dropped in sdp_receive_data() (ISR) and never reach rx buffer.
+* @note Call this function after sdp_init_node() and before RXNE interrupt is enabled. All nodes on bus must use 
+*       addressing mode. Addresses are not escaped - with DLE framing, do not use SOF, DLE and EOF values as address.
+*/
+bool sdp_set_addressing(SDP_data_t *node, bool enable){
+  node->_address_size = enable ? SDP_ADDRESS_SIZE : 0;
+  node->_rx_state = SDP_RX_IDLE;
+  node->_filter_state = SDP_FILTER_IDLE;
+  node->_fast_state = SDP_FAST_IDLE;
+  
+  return resize_frame_buffers(node);
+}
+
+/**
+* @brief Set protocol options (SDP_OPTION_xxx bitmask). Options can also be negotiated with sdp_negotiate() (node->caps.options).
+*        SDP_OPTION_LINK_ACK: parser acknowledges each received request (SDP_LINK_ACK/SDP_LINK_NACK frame without payload) 
+*        as soon as CRC is checked, application response follows later. Sender retransmits if link ACK does not arrive 
+*        in node->ack_timeout, so lost frames are detected early while slow message handlers can use long response_timeout.
+*        SDP_OPTION_CHANNELS: each frame carries logical channel number (node->tx_channel), received messages are passed 
+*        to channel handler (sdp_set_channel()). With request ID option, channel TX queues are scheduled by priority.
+*        SDP_OPTION_FEC: each frame carries SDP_FEC_SIZE Reed-Solomon parity bytes, receiver corrects up to 
+*        SDP_FEC_SIZE/2 corrupted bytes when CRC check fails, instead of NACK and retransmission (node->fec_corrected).
+*        SDP_OPTION_CREDITS: each frame carries free rx buffer space of sender (in SDP_CREDIT_UNIT bytes). Requests, 
+*        datagrams and batches are not transmitted beyond credits that other node granted with its last response, so 
+*        fast sender doesn't overrun rx buffer (which is flushed on overflow, all frames in it are retransmitted).
+*        Without credits (or with nothing in flight), one frame is sent as probe - its response grants new credits.
+* @note Both nodes must use the same options.
+*/
+void sdp_set_options(SDP_data_t *node, uint8_t options){
+  node->options = options;
+  node->_base_options = options;
+  node->_tx_credit_limit = node->_tx_credit_used; // credits option: credits of other node are unknown
+}
+
+/**
+* @brief Enable token passing bus arbitration (multi-master shared half-duplex bus). Only token holder can initiate 
+*        transmission (sdp_send_data() waits for token), other nodes only respond. Holder keeps token for 
+*        token_hold_time and passes it to next node in ring (nodes that don't respond are skipped). If bus is idle 
+*        for token_timeout + SDP_TOKEN_SLOT_TIME * (position in ring), token is considered lost and this node 
+*        regenerates it - first node in ring creates initial token.
+* @param ring - addresses of all nodes in ring order (array must stay valid), must include this node. ring_size = 0 disables token passing.
+* @note Addressing mode must be enabled. Token is passed in sdp_parse_rx_data(), which must be polled frequently.
+* @retval Returns false if addressing mode is disabled or this node is not part of ring, true otherwise
+*/
+bool sdp_set_token_ring(SDP_data_t *node, uint8_t *ring, uint8_t ring_size){
+  uint8_t i;
+  
+  node->_token_ring = NULL;
+  node->_token_ring_size = 0;
+  node->token = false;
+  if(ring_size == 0){
+    return true;
+  }
+  if(node->_address_size == 0){
+    return false;
+  }
+  for(i = 0; i < ring_size; i++){
+    if(ring[i] == node->id){
+      node->_token_ring = ring;
+      node->_token_ring_size = ring_size;
+      node->_token_position = i;
+      node->_bus_activity_time = HAL_GetTick();
+      
+      return true;
+    }
+  }
+  
+  return false;
+}
+
+/**
+* @brief Enable/disable adaptive retransmission timeout. Round trip time (until link ACK or response) of each request 
+*        that was not retransmitted is measured (Karn's rule), smoothed RTT and RTT variation give retransmission 
+*        timeout (Jacobson): rto = srtt + 4 * rttvar, limited to rto_min - rto_max. On each timeout, rto is doubled 
+*        (exponential backoff, up to rto_max) until new RTT sample is taken. Until first sample, fixed 
+*        response_timeout/ack_timeout are used.
+*        Adaptive timeout is used only with request ID option - without it, late response to frame that timed out 
+*        can't be told apart from response to retransmitted frame, so short timeout would shift all responses.
+* @param rto_max - backoff cap [ms], 0 disables adaptive timeout (fixed response_timeout/ack_timeout)
+* @note Without link ACK option, RTT includes other node's message handler time - slow handlers (that sometimes take 
+*       more than rto) cause retransmissions, use link ACK option (response_timeout stays fixed) or large rto_min.
+*/
+void sdp_set_adaptive_timeout(SDP_data_t *node, uint32_t rto_min, uint32_t rto_max){
+  node->rto_min = rto_min;
+  node->rto_max = rto_max;
+  rtt_reset(node);
+}
+
+/**
+* @brief Enable/disable adaptive payload: fragment size of sdp_send_fragments() (node->tx_payload) follows observed 
+*        error rate of transmitted frames. Each NACK-ed or lost frame shrinks it by 1/4 (down to min_payload), each 
+*        acknowledged frame grows it by 1/4 of frame overhead (up to negotiated rx_tx_max_payload). Frame error rate 
+*        settles near overhead/payload ratio, where goodput is highest: big fragments on clean link, small on noisy.
+* @param min_payload - lower limit of fragment size, 0 disables adaptive payload (fragments are rx_tx_max_payload bytes)
+* @retval Returns false if min_payload > rx_tx_max_payload
+*/
+bool sdp_set_adaptive_payload(SDP_data_t *node, uint8_t min_payload){
+  if(min_payload > node->rx_tx_max_payload){
+    sdp_debug(node, 66);
+    return false;
+  }
+  node->min_payload = min_payload;
+  node->tx_payload = node->rx_tx_max_payload;
+  node->_payload_growth = 0;
+  
+  return true;
+}
+
+/**
+* @brief Enable/disable aggregation: small messages posted with sdp_post_message() are packed into one batch frame 
+*        (LEN | MESSAGE | LEN | MESSAGE ...), which is acknowledged once - per message framing overhead and round 
+*        trips are shared. Batch is sent when it holds threshold bytes, when next message does not fit into frame, 
+*        or when oldest message waits delay ms (from sdp_parse_rx_data()). Other node passes each message to its 
+*        message handler (channels option: handler of batch channel), its responses are not transmitted.
+* @param delay - [ms] max time posted message waits for other messages, 0 - batch is sent from next sdp_parse_rx_data()
+* @param threshold - number of batch bytes (with length bytes) that triggers transmission, limited to 
+*        rx_tx_max_payload (1 - each message is sent immediately), 0 disables aggregation
+* @note Batch buffer (rx_tx_max_payload bytes) is allocated here. Both nodes must support aggregation.
+* @retval Returns false if batch buffer can't be allocated, true otherwise
+*/
+bool sdp_set_aggregation(SDP_data_t *node, uint32_t delay, uint8_t threshold){
+  if(node->_batch_size != 0){
+    sdp_flush_messages(node);
+  }
+  if((threshold != 0) && (node->_batch == NULL)){
+    node->_batch = calloc(node->_base_max_payload, sizeof(uint8_t));
+    if(node->_batch == NULL){
+      sdp_debug(node, 44);
+      return false;
+    }
+  }
+  node->batch_delay = delay;
+  node->batch_threshold = (threshold > node->rx_tx_max_payload) ? node->rx_tx_max_payload : threshold;
+  
+  return true;
+}
+
+/**
+* @brief Channels option: set up logical channel. Messages received on this channel are passed to handler, frames 
+*        queued with sdp_queue_request() are transmitted by priority: whenever request slot is free, oldest frame of 
+*        waiting channel with highest priority is sent, so urgent message waits at most one frame behind bulk transfer 
+*        (last request slot is reserved for channel with highest priority). Channel with share != 0 can send max share 
+*        frames in a row while other channels are waiting, so it can't block lower priority channels.
+* @param handler - message handler of this channel, NULL - messages are passed to sdp_user_handle_message()
+* @note Call this function after sdp_init_node(). Channel TX queue (SDP_CHANNEL_QUEUE_SIZE frames) is allocated here.
+* @retval Returns false if channel number is out of range or queue can't be allocated, true otherwise
+*/
+bool sdp_set_channel(SDP_data_t *node, uint8_t channel, uint8_t priority, uint8_t share, SDP_message_handler_t handler){
+  SDP_channel_t *ch;
+  uint8_t i;
+  
+  if(channel >= SDP_MAX_CHANNELS){
+    sdp_debug(node, 230);
+    return false;
+  }
+  ch = &node->_channels[channel];
+  ch->priority = priority;
+  ch->share = share;
+  ch->budget = share;
+  ch->handler = handler;
+  for(i = 0; i < SDP_CHANNEL_QUEUE_SIZE; i++){
+    if(ch->queue[i].payload == NULL){
+      ch->queue[i].payload = calloc(node->rx_tx_max_payload, sizeof(uint8_t));
+      if(ch->queue[i].payload == NULL){
+        sdp_debug(node, 44);
+        return false;
+      }
+    }
+  }
+  
+  return true;
+}
+
+/**
+* @brief Request ID option: enable/disable response cache. Last size handled requests (source address, ID and payload 
+*        CRC) and their responses are kept, so retransmitted request (response was lost) is answered from cache by 
+*        parser - message handler is not called again, so expensive or non-idempotent commands are executed once. 
+*        Retransmitted request whose (deferred) response was not sent yet is ignored, response follows.
+*        Request IDs of other node start again when it restarts - its cached responses are dropped when it starts link 
+*        negotiation (HELLO), so node that restarts must call sdp_negotiate() before its first request.
+* @param size - number of cached responses (<= SDP_RESPONSE_CACHE_SIZE), 0 disables cache
+* @note Response payload buffers (rx_tx_max_payload bytes each) are allocated here. Only ACK responses are cached 
+*       (sdp_send_response(), sdp_send_deferred_response() and sdp_send_dummy_response()).
+* @retval Returns false if size is out of range or buffers can't be allocated, true otherwise
+*/
+bool sdp_set_response_cache(SDP_data_t *node, uint8_t size){
+  uint8_t i;
+  
+  if(size > SDP_RESPONSE_CACHE_SIZE){
+    sdp_debug(node, 140);
+    return false;
+  }
+  for(i = 0; i < size; i++){
+    if(node->_cache[i].payload == NULL){
+      node->_cache[i].payload = calloc(node->rx_tx_max_payload, sizeof(uint8_t));
+      if(node->_cache[i].payload == NULL){
+        sdp_debug(node, 44);
+        return false;
+      }
+    }
+  }
+  for(i = 0; i < SDP_RESPONSE_CACHE_SIZE; i++){
+    node->_cache[i].used = false;
+  }
+  node->_cache_size = size;
+  node->_cache_next = 0;
+  
+  return true;
+}
+
+/**
+* @brief Addressing mode: join or leave group. Frames addressed to group address (or SDP_BROADCAST_ADDRESS, 
+*        all nodes are members) are accepted by all its members and passed to message handler without response - 
+*        sender transmits frame once for all nodes and can poll members for received frames later (sdp_poll_group()).
+* @param address - group address, SDP_GROUP_ADDRESS - (SDP_BROADCAST_ADDRESS - 1)
+* @retval Returns false if address is not group address, true otherwise
+*/
+bool sdp_set_group(SDP_data_t *node, uint8_t address, bool member){
+  if((address < SDP_GROUP_ADDRESS) || (address == SDP_BROADCAST_ADDRESS)){
+    sdp_debug(node, 98);
+    return false;
+  }
+  if(member){
+    node->_groups |= (uint16_t)(1 << (address - SDP_GROUP_ADDRESS));
+  }
+  else{
+    node->_groups &= (uint16_t)~(1 << (address - SDP_GROUP_ADDRESS));
+  }
+  
+  return true;
+}
+
+/**
+* @brief Link bonding: bond this node with other nodes (physical links, each with own UART) into one logical link. 
+*        Frames sent with sdp_send_bonded() are striped across links (round robin, link with free request slot) 
+*        and carry sequence number of bond. Receiver (bonded with the same number of links) acknowledges each frame 
+*        on its link and passes payloads to message handler of this node in sequence order, without response.
+* @param links - other nodes of bond (initialised with sdp_init_node(), the same max payload), must stay valid. 
+*        NULL or count = 0 disables bonding.
+* @note Request ID option must be enabled on all links. Call sdp_parse_rx_data() for each link (retransmission 
+*       and reordering is done there). Reorder buffers (SDP_BOND_WINDOW frames) are allocated here.
+* @retval Returns false if there are too many links, max payload of links differ or buffers can't be allocated
+*/
+bool sdp_set_bond(SDP_data_t *node, SDP_data_t **links, uint8_t count){
+  uint8_t i;
+  
+  if((links == NULL) || (count == 0)){
+    for(i = 0; i < node->_bond_count; i++){
+      node->_bond_links[i]->_bond = NULL;
+    }
+    node->_bond_count = 0;
+    return true;
+  }
+  if(count >= SDP_BOND_MAX_LINKS){ // primary node is link too
+    sdp_debug(node, 151);
+    return false;
+  }
+  for(i = 0; i < count; i++){
+    if(links[i]->rx_tx_max_payload != node->rx_tx_max_payload){
+      sdp_debug(node, 151);
+      return false;
+    }
+  }
+  if(node->_bond_tx == NULL){
+    node->_bond_tx = calloc(node->rx_tx_max_payload, sizeof(uint8_t));
+  }
+  for(i = 0; i < SDP_BOND_WINDOW; i++){
+    if(node->_bond_rx[i] == NULL){
+      node->_bond_rx[i] = calloc(node->rx_tx_max_payload, sizeof(uint8_t));
+    }
+    if((node->_bond_rx[i] == NULL) || (node->_bond_tx == NULL)){
+      sdp_debug(node, 151);
+      return false;
+    }
+    node->_bond_rx_size[i] = 0;
+    node->_bond_skipped[i] = false;
+  }
+  
+  node->_bond_links[0] = node;
+  for(i = 0; i < count; i++){
+    node->_bond_links[i + 1] = links[i];
+  }
+  node->_bond_count = count + 1;
+  for(i = 0; i < node->_bond_count; i++){
+    node->_bond_links[i]->_bond = node;
+  }
+  node->_bond_next = 0;
+  node->_bond_tx_seq = 0;
+  node->_bond_rx_seq = 0;
+  node->_bond_rx_count = 0;
+  node->_bond_gap_time = 0;
+  
+  return true;
+}
+
+/**
+* @brief Fast path: register handler of latency-critical requests, selected by first payload byte (opcode). 
+*        Request (ACK frame that is not a response) of up to SDP_FAST_FRAME_SIZE encoded bytes is held in 
+*        sdp_receive_data() until end of frame, checked with CRC and passed to handler directly from RX interrupt. 
+*        Response is composed and transmitted from interrupt too - request never reaches rx buffer and parser.
+* @param handler - NULL removes handler of opcode
+* @note Handler runs in interrupt context: it must be short, must not call SDP functions and must be idempotent 
+*       (retransmitted request is handled again, fast responses are not cached). Handler must not write more than 
+*       response_size bytes. Request is passed to sdp_parse_rx_data() as usual if handler returns 0 (or more than 
+*       response_size), encoded response doesn't fit SDP_FAST_FRAME_SIZE or node is 
+*       transmitting other frame (sdp_transmit_data() or previous fast response). FEC and credits options disable 
+*       fast path. Response is transmitted with non-blocking sdp_user_start_transmit() (TXE interrupt or DMA), 
+*       which must be implemented together with sdp_transmit_complete() call from TX interrupt.
+*       Register handlers before RXNE interrupt is enabled.
+* @retval Returns false if SDP_MAX_FAST_HANDLERS handlers are already registered
+*/
+bool sdp_set_fast_handler(SDP_data_t *node, uint8_t opcode, SDP_fast_handler_t handler){
+  uint8_t i;
+  
+  for(i = 0; i < node->_fast_count; i++){
+    if(node->_fast_opcodes[i] == opcode){
+      break;
+    }
+  }
+  if(handler == NULL){
+    if(i < node->_fast_count){  // move last handler into free slot
+      node->_fast_count--;
+      node->_fast_opcodes[i] = node->_fast_opcodes[node->_fast_count];
+      node->_fast_handlers[i] = node->_fast_handlers[node->_fast_count];
+    }
+    return true;
+  }
+  if(i == SDP_MAX_FAST_HANDLERS){
+    sdp_debug(node, 157);
+    return false;
+  }
+  node->_fast_opcodes[i] = opcode;
+  node->_fast_handlers[i] = handler;
+  if(i == node->_fast_count){
+    node->_fast_count++;
+  }
+  
+  return true;
+}
+
 /**
 * @brief Parse all data in rx buffer
 * @note This function should be polled frequently to handle incoming data from ring buffer asap.
 */
 void sdp_parse_rx_data(SDP_data_t *node){
   //uint16_t size = ring_buffer_size(&node->_rx_buff);
+  bool expect_response = node->_expect_response;
+  
+  if((node->link_state == SDP_LINK_SWITCHED) && (HAL_GetTick() > node->_link_fallback_time)){
+    sdp_debug(node, 186); // new settings not confirmed, use initial settings
+    link_fallback(node);
+  }
+  if(node->_token_ring_size != 0){
+    token_service(node);
+  }
+  if(node->_request_count != 0){
+    request_service(node);
+  }
+  if(node->_queued_count != 0){
+    channel_service(node);
+  }
+  if((node->_bond != NULL) && (node->_bond->_bond_rx_count != 0)){
+    bond_service(node->_bond);
+  }
+  if(node->_batch_size != 0){
+    batch_service(node);
+  }
+  if(node->_fast_state != SDP_FAST_IDLE){
+    fast_timeout(node);
+  }
   
   while(ring_buffer_size(&node->_rx_buff)){ // at least one byte is in buffer
     switch(node->_rx_state){
@@ -117,17 +798,41 @@ void sdp_parse_rx_data(SDP_data_t *node){
         rx_frame_timeout(node); // check for timeout
         break;
       
+      case SDP_RX_COBS_ACK:
+      case SDP_RX_COBS:
+        append_cobs_data(node);
+        rx_frame_timeout(node); // check for timeout
+        break;
+      
+      case SDP_RX_HEADER:
+        receive_header(node);
+        rx_frame_timeout(node); // check for timeout
+        break;
+      
+      case SDP_RX_LENGTH:
+        receive_length_data(node);
+        rx_frame_timeout(node); // check for timeout
+        break;
+      
+      case SDP_RX_ADDRESS:
+        receive_address(node);
+        rx_frame_timeout(node); // check for timeout
+        break;
+      
       default: // invalid rx_state
         sdp_debug(node, 50);
         node->_rx_state = SDP_RX_IDLE; // re-init to IDLE
         break;
     }
+    
+    if(expect_response && !node->_expect_response){
+      // response received - next frame (from other node, or next request) is parsed after sdp_send_data() reads response
+      break;
+    }
   }
-  /*
-  else{ // even if buffer is empty, but data should be received 
+  if(node->_rx_state != SDP_RX_IDLE){ // even if buffer is empty, incomplete frame times out (sender is NACK-ed)
     rx_frame_timeout(node); // check for timeout
   }
-  */
 }
 
 /**
@@ -135,17 +840,27 @@ void sdp_parse_rx_data(SDP_data_t *node){
 * @note Call this function from RXNE interrupt routine.
 */
 void sdp_receive_data(SDP_data_t *node){
-  uint8_t data;
+  uint8_t data[SDP_SOF_SIZE + SDP_ADDRESS_SIZE + SDP_LENGTH_HEADER_SIZE + SDP_LENGTH_HCRC_SIZE]; // received byte (+ held start byte and COBS code byte or length framing header in addressing mode)
+  uint8_t size = 1;
+  uint8_t i;
   
-  if(!sdp_user_receive_byte(node, &data)){
+  if(!sdp_user_receive_byte(node, &data[0])){
     sdp_debug(node, 1);
     return;
   }
-  if(ring_buffer_put(&node->_rx_buff, &data, 1) != RB_OK){
-    sdp_debug(node, 2); //ring buffer full or not enough space
-    
-    ring_buffer_flush(&node->_rx_buff); // discard all data in buffer
+  if(node->_address_size != 0){ // drop frames addressed to other nodes before they reach rx buffer
+    size = address_filter(node, data);
+    if(size == 0){
+      return;
+    }
+  }
+  if((node->_fast_count != 0) || (node->_fast_state != SDP_FAST_IDLE)){ // fast path: short requests are handled in this interrupt
+    for(i = 0; i < size; i++){
+      fast_receive(node, data[i]);
+    }
+    return;
   }
+  rx_buffer_put(node, data, size);
 }
 
 /**
@@ -161,86 +876,288 @@ bool sdp_transmit_data(SDP_data_t *node){
     return false;
   }
   
+  node->_tx_busy = true; // fast path: RX interrupt must not transmit response in the middle of this frame
+  while(node->_fast_tx_busy){ // fast path response is being transmitted (TXE interrupt or DMA)
+    if(HAL_GetTick() > timeout){
+      sdp_debug(node, 12);
+      node->_tx_busy = false;
+      
+      return false;
+    }
+  }
   while(num != node->_tx_data_size){
   
     if(!sdp_user_transmit_byte(node, node->_tx_data[num])){
       sdp_debug(node, 11);
+      node->_tx_busy = false;
       
       return false;
     }
     num++;
     if(HAL_GetTick() > timeout){  // check for frame transmission timeout
       sdp_debug(node, 12);
+      node->_tx_busy = false;
      
       return false;
     }
   }
+  node->_tx_busy = false;
+  if((get_credit_size(node) != 0) && ((node->_address_size == 0) || (node->_tx_dst == node->_credit_dst))){
+    node->_tx_credit_used += (node->_tx_data_size + SDP_CREDIT_UNIT - 1) / SDP_CREDIT_UNIT; // each frame (also responses) takes rx buffer space of other node
+  }
   
   return true;  // on success return true
 }
+
+/**
+* @brief Fast path: response started with sdp_user_start_transmit() is transmitted, sdp_transmit_data() can continue
+* @note Call this function from TX interrupt routine (TXE after last byte, or DMA transfer complete).
+*/
+void sdp_transmit_complete(SDP_data_t *node){
+  node->_fast_tx_busy = false;
+}
   
 /**
 * @brief This function is called when message is received and checked with CRC.
 * @note Data is fetched from rx_data buffer
 */
 void sdp_handle_message(SDP_data_t *node){
-  if(node->_expect_response){// arrived data must be response
+  uint32_t start;
+  
+  if(is_response(node)){// arrived data must be response
+    if(node->ack == SDP_NACK){
+      node->nack_reason = get_nack_reason(node);
+    }
     node->_expect_response = false; // reset flag to let sdp_send_data() function continue
   }
+  else if(node->_expect_response){ // request ID option: request of other node while waiting for response (full-duplex)
+    start = HAL_GetTick();
+    handle_request(node);
+    node->_handler_time = node->_handler_time + (HAL_GetTick() - start);
+  }
   else{ // message is not a response to sdp_send_data()
-    if(node->ack == SDP_ACK){
-      sdp_user_handle_message(node, node->rx_data, node->rx_data_index); // call user message handler in sdp_user.c
+    handle_request(node);
+  }
+}
+
+/**
+* @brief Received frame is request (or other frame that is not a response): pass it to message handler (or handle it 
+*        internally) - called from sdp_handle_message(), also while this node waits for response to sdp_send_data()
+*/
+static void handle_request(SDP_data_t *node){
+  if(node->token && !((node->ack == SDP_CTRL) && (node->rx_data_index != 0) && (node->rx_data[0] == SDP_CTRL_TOKEN))){
+    sdp_debug(node, 202); // other node initiated transmission while this node holds token - duplicated token, drop it
+    node->token = false;
+  }
+  if(node->ack == SDP_ACK){
+    if(replay_response(node)){
+      return; // retransmitted request, message handler is not called again
+    }
+    if((get_channel_size(node) != 0) && (node->rx_channel < SDP_MAX_CHANNELS) && (node->_channels[node->rx_channel].handler != NULL)){
+      node->_channels[node->rx_channel].handler(node, node->rx_data, node->rx_data_index); // channels option: channel message handler
     }
     else{
-      if(!sdp_send_response(node, node->rx_data, node->rx_data_index)){ // send NACK with received payload
-        
-        sdp_debug(node, 120);
-        return;
-      }
+      sdp_user_handle_message(node, node->rx_data, node->rx_data_index); // call user message handler in sdp_user.c
+    }
+  }
+  else if(node->ack == SDP_CTRL){
+    handle_control_frame(node); // link control frames are handled internally
+  }
+  else if(node->ack == SDP_BATCH){
+    receive_batch(node);  // aggregation: each message is passed to message handler
+  }
+  else if(node->ack == SDP_BOND){
+    receive_bond_frame(node); // link bonding: payload is passed to message handler of bond in sequence order
+  }
+  else{
+    if(!send_nack(node, SDP_NACK_CRC)){ // compact NACK: reason code instead of received (corrupted) payload
+      
+      sdp_debug(node, 120);
+      return;
     }
-    
   }
 }
 
 /**
 * @brief Transmits data and waits for response.
+*        node->tx_qos == SDP_QOS_DATAGRAM: frame is transmitted once and function returns without waiting for 
+*        response - other node passes datagram to message handler and does not respond, corrupted datagram is 
+*        dropped (counted in rx_dropped of other node). Use it for streams where fresh data replaces lost one.
+*        Credits option: request waits until other node has rx buffer space for it, datagram without credits is 
+*        sent as request (waits for response).
+*        Request ID option: latency-critical frame can be sent redundantly - node->tx_copies copies back to back 
+*        and/or duplicate after node->hedge_delay if it is not acknowledged yet. Other node answers duplicates from 
+*        response cache, this node takes first response, so one lost frame costs hedge delay (or nothing) instead of 
+*        response timeout. Both nodes must enable response cache (sdp_set_response_cache()), otherwise frame is sent 
+*        once (debug code 107).
+*        node->tx_deadline != 0: request is not (re)transmitted after this time (stale data), function returns 
+*        false and node->tx_expired is incremented.
 * @param payload_size >= 1
 * @note Response is parsed normally while handled with node->expect_response flag
+*        Without request ID option link is half-duplex - each frame received while waiting is taken as response, so 
+*        only one node may initiate transmission (or use token ring).
+*        Request ID option (full-duplex): requests of other node that arrive while waiting are handled normally - 
+*        message handler is called from here. It can respond, send datagrams or sdp_send_request() requests, but 
+*        not blocking sdp_send_data() (returns false). Time spent in message handler is not counted into timeouts.
+*        Addressing mode: frame to group address (or SDP_BROADCAST_ADDRESS) is sent as group frame - transmitted 
+*        once without waiting, accepted by all group members without response. Its sequence number (node->group_seq) 
+*        can be polled later with sdp_poll_group(). payload_size of group frame is max rx_tx_max_payload - 1.
+* @retval Returns true if response is received (datagram, group frame: if it was transmitted), false otherwise
 */
 bool sdp_send_data(SDP_data_t *node, uint8_t *payload, uint8_t payload_size){
+  bool status;
+  
+  if((node->_address_size != 0) && (node->tx_address >= SDP_GROUP_ADDRESS)){
+    return send_group_frame(node, payload, payload_size);
+  }
+  if((node->tx_qos == SDP_QOS_DATAGRAM) && has_credit(node, node->tx_address, payload_size, false)){
+    return send_datagram(node, payload, payload_size);
+  } // credits option: datagram without credits is sent as request, its response grants new credits
+  if(node->_sending){
+    sdp_debug(node, 67); // called from message handler while waiting for response, use sdp_send_request()
+    return false;
+  }
+  node->_request_deadline = get_deadline(node);  // waiting for token and credits counts too
+  if(!wait_for_token(node)){
+    return false;
+  }
+  if(!wait_for_credit(node, node->tx_address, payload_size)){
+    node->_token_wanted = false;
+    return false;
+  }
+  status = send_frame(node, node->tx_address, SDP_ACK, payload, payload_size);
+  node->_token_wanted = false;
+  
+  return status;
+}
+
+/**
+* @brief Transmit data larger than one frame: data is split into fragments of node->tx_payload bytes (adaptive 
+*        payload, otherwise rx_tx_max_payload) and each fragment is sent with sdp_send_data(). Other node must 
+*        respond to each fragment, response payload is ignored.
+*        With adaptive payload, fragment that is not acknowledged is split again with (shrunk) tx_payload and sent 
+*        again, up to SDP_RETRANSMIT times in a row.
+* @note Fragment boundaries are not marked - if other node must reassemble data, put offset into data (application layer).
+* @retval Returns false if fragment is not acknowledged (following fragments are not sent)
+*/
+bool sdp_send_fragments(SDP_data_t *node, uint8_t *data, uint16_t size){
+  uint16_t sent = 0;
+  uint8_t fragment_size;
+  uint8_t failed = 0;
+  
+  while(sent < size){
+    fragment_size = (node->min_payload != 0) ? node->tx_payload : node->rx_tx_max_payload;
+    if(fragment_size > node->rx_tx_max_payload){
+      fragment_size = node->rx_tx_max_payload;
+    }
+    if(fragment_size > (size - sent)){
+      fragment_size = (uint8_t)(size - sent);
+    }
+    if(sdp_send_data(node, &data[sent], fragment_size)){
+      sent = sent + fragment_size;
+      failed = 0;
+      continue;
+    }
+    failed++;
+    if((node->min_payload == 0) || (failed >= SDP_RETRANSMIT)){
+      sdp_debug(node, 65);
+      return false;
+    }
+  }
+  
+  return true;
+}
+
+/**
+* @brief Transmits frame with given ACK field value and waits for response (with the same ACK field value).
+* @param dst - addressing mode: destination address
+* @note Response is parsed normally while handled with node->expect_response flag
+*/
+static bool send_frame(SDP_data_t *node, uint8_t dst, uint8_t ack, uint8_t *payload, uint8_t payload_size){
   uint8_t retransmit_count;
   uint32_t response_timeout;
+  uint32_t ack_timeout;
+  uint32_t tx_time;
+  uint32_t hedge_time;
+  bool hedged;
+  uint32_t now;
   
+  if(node->_sending){
+    sdp_debug(node, 67); // blocking transmission from message handler would overwrite state of waiting one
+    return false;
+  }
+  node->_sending = true;
+  node->_request_id = new_request_id(node); // request ID option: retransmitted frames keep the same ID
+  node->_request_dst = dst;
   for(retransmit_count = 0; retransmit_count < SDP_RETRANSMIT; retransmit_count++){
-    if(compose_frame(node, SDP_ACK, payload, payload_size)){ // compose frame and store it in tx_data array
+    if((ack == SDP_ACK) && is_expired(node->_request_deadline)){
+      sdp_debug(node, 104); // stale request is not (re)transmitted
+      node->tx_expired++;
+      break;
+    }
+    node->_tx_dst = dst;
+    node->_tx_id = node->_request_id;
+    node->_tx_channel = node->tx_channel;
+    if(compose_frame(node, ack, payload, payload_size)){ // compose frame and store it in tx_data array
 
       if(sdp_transmit_data(node)){ // transmit tx_data array
         // transmission OK, poll for response
-        response_timeout = HAL_GetTick() + node-> response_timeout; // note that node->rx_start_time is updated on SOF
-        node->_rx_state = SDP_RX_IDLE;
-        node->ack = SDP_NACK; // avoid reporting ACK if no response. If there is response, ack is updated
+        transmit_copies(node, get_copies(node, ack));
+        node->_credit_mark = node->_tx_credit_used;
+        tx_time = HAL_GetTick();
+        hedge_time = ((get_copies(node, ack) != 0) && (node->hedge_delay != 0)) ? (tx_time + node->hedge_delay) : 0;
+        hedged = (get_copies(node, ack) > 1);
+        response_timeout = tx_time + get_timeout(node, true); // note that node->rx_start_time is updated on SOF
+        ack_timeout = tx_time + get_timeout(node, false);
+        if(node->_rx_state == SDP_RX_IDLE){ // frame that is being received (notification) is not discarded
+          node->ack = SDP_NACK; // avoid reporting ACK if no response. If there is response, ack is updated
+        }
+        node->_link_acked = ((node->options & SDP_OPTION_LINK_ACK) == 0);  // set by parser on SDP_LINK_ACK
+        node->_handler_time = 0;
         
         node->_expect_response = true;
         while(node->_expect_response){ // wait until parser clears flag or timeout          
           sdp_parse_rx_data(node);  // parse all incoming rx buffer data
+          now = HAL_GetTick() - node->_handler_time; // requests of other node handled meanwhile don't count
           
-          if(HAL_GetTick() > response_timeout){
+          if((hedge_time != 0) && (now > hedge_time) && node->_expect_response){
+            hedge_time = 0;
+            if(!node->_link_acked || ((node->options & SDP_OPTION_LINK_ACK) == 0)){ // neither link ACK nor response arrived
+              hedged = transmit_hedge(node, dst, node->_request_id, node->tx_channel, ack, payload, payload_size) || hedged;
+            }
+          }
+          if(!node->_link_acked && (now > ack_timeout)){
+            sdp_debug(node, 64);
+            rto_backoff(node);
+            payload_error(node);
+            break; // frame was not acknowledged, retransmit without waiting for response
+          }
+          if(now > response_timeout){
             sdp_debug(node, 60);
+            if((node->options & SDP_OPTION_LINK_ACK) == 0){ // with link ACK, response timeout covers message handler
+              rto_backoff(node);
+              payload_error(node);
+            }
             break; // data didn't arrive in time, break out of loop
           }
         }
         
         if(node->_expect_response == false){ // parser cleared flag, response received
-          if(node->ack != SDP_ACK){
+          if(node->ack != ack){
             // response received -> NACK received, data failure (CRC)
             sdp_debug(node, 63);
+            payload_error(node);
             
-            // failure, retry
-            
-            // TODO
-            // delay? - to avoid receiver overrun?
+            if(!((node->ack == SDP_LINK_NACK) || ((node->ack == SDP_NACK) && (node->nack_reason != SDP_NACK_UNKNOWN)))){
+              wait_parsing(node, get_retransmit_delay(node)); // avoid receiver overrun (compact/link NACK: receiver is ready, retransmit immediately)
+            }
           }
           else{ // ACK OK
+            if((retransmit_count == 0) && !hedged && (node->_handler_time == 0)){  // Karn's rule: RTT of retransmitted, duplicated (or delayed) frame is ambiguous
+              rtt_sample(node, ((node->options & SDP_OPTION_LINK_ACK) ? node->_link_ack_time : HAL_GetTick()) - tx_time);
+            }
+            payload_success(node);
+            node->_sending = false;
             return true; // success, read rx_data for response payload
           }
         } // expect_response flag not cleared, timeout
@@ -248,16 +1165,21 @@ bool sdp_send_data(SDP_data_t *node, uint8_t *payload, uint8_t payload_size){
       }
       else{ // transmition unsuccessfull, retry
         sdp_debug(node, 61);
+        wait_parsing(node, get_retransmit_delay(node));
       }
       
     } // end of for loop reached - retransmit if error
     else{ // frame can't be composed - larger than SDP_MAX_FRAME_SIZE
       sdp_debug(node, 62);
+      node->_sending = false;
       
       return false;
     }
   }// end of for loop (retransmission)
-  
+  if(get_id_size(node) != 0){
+    node->_expect_response = false; // request ID option: late response is matched by ID and ignored
+  }
+  node->_sending = false;
   
   return false; // loop didn't return while executing, error occured
 }
@@ -268,13 +1190,22 @@ bool sdp_send_data(SDP_data_t *node, uint8_t *payload, uint8_t payload_size){
 * @note Response is not send accordingly to retransmit - try once and return
 */
 bool sdp_send_response(SDP_data_t *node, uint8_t *payload, uint8_t payload_size){
-  
+  if(node->_suppress_response){
+    return true;  // aggregation: parser acknowledges whole batch, datagram: no response
+  }
+  node->_tx_dst = node->rx_address; // response goes to sender of received frame
+  node->_tx_id = node->rx_id | SDP_ID_RESPONSE; // request ID option: response carries ID of request
+  node->_tx_channel = node->rx_channel; // channels option: response is sent on channel of request
   if(!compose_frame(node, node->ack, payload, payload_size)){ // compose frame and store it in tx_data array
     sdp_debug(node, 70);
     return false;
   }
   
-  if(sdp_transmit_data(node)){ // transmit tx_data array
+  if(node->ack == SDP_ACK){
+    cache_response(node, node->rx_address, node->rx_id, payload, payload_size); // cached even if transmission fails
+  }
+  
+  if(sdp_transmit_data(node)){ // transmit tx_data array
     return true;
   }
   else{ // transmit error
@@ -290,13 +1221,12 @@ bool sdp_send_response(SDP_data_t *node, uint8_t *payload, uint8_t payload_size)
 * @note Response is not send accordingly to retransmit - try once and return
 */
 bool sdp_send_dummy_response(SDP_data_t *node){
+  if(node->_suppress_response){
+    return true;  // aggregation: parser acknowledges whole batch, datagram: no response
+  }
   node->ack = SDP_ACK;
-  node->_tx_data[0] = SDP_SOF;  // first byte of message is always SOF
-  node->_tx_data[1] = SDP_ACK;  // second byte of message is always ack
-  node->_tx_data[2] = SDP_EOF;  // third, last byte of message is EOF
-  node->_tx_data_size = 3;
-  
-  if(sdp_transmit_data(node)){ // transmit tx_data array
+  cache_response(node, node->rx_address, node->rx_id, NULL, 0);
+  if(send_empty_frame(node, SDP_ACK)){
     return true;
   }
   else{ // transmit error
@@ -305,6 +1235,445 @@ bool sdp_send_dummy_response(SDP_data_t *node){
   }
 }
 
+/**
+* @brief Compose and transmit frame without payload (and CRC) to sender of received frame: dummy response or link ACK/NACK.
+*/
+static bool send_empty_frame(SDP_data_t *node, uint8_t ack){
+  node->_tx_dst = node->rx_address; // response goes to sender of received frame
+  if(get_prefix_size(node) != 0){ // request ID/channels option: ID and channel are the only payload bytes
+    node->_tx_id = node->rx_id | SDP_ID_RESPONSE;
+    node->_tx_channel = node->rx_channel;
+    if(!compose_frame(node, ack, NULL, 0)){
+      return false;
+    }
+  }
+  else if(node->framing == SDP_FRAMING_COBS){
+    compose_cobs_frame(node, ack, NULL, 0, false); // frame without payload and CRC
+  }
+  else if(node->framing == SDP_FRAMING_LENGTH){
+    compose_length_frame(node, ack, NULL, 0); // header only, LEN = 0
+  }
+  else{
+    node->_tx_data[0] = SDP_SOF;  // first byte of message is always SOF
+    if(node->_address_size != 0){
+      node->_tx_data[1] = node->_tx_dst;
+      node->_tx_data[2] = node->id;
+    }
+    node->_tx_data[1 + node->_address_size] = ack;  // followed by ack
+    node->_tx_data[2 + node->_address_size] = SDP_EOF;  // last byte of message is EOF
+    node->_tx_data_size = 3 + node->_address_size;
+  }
+  
+  return sdp_transmit_data(node);
+}
+
+/**
+* @brief Send compact NACK to sender of received frame: request ID/channel prefix and reason code (SDP_NACK_xxx), 
+*        received payload is not echoed. Sender retransmits frame immediately.
+*/
+static bool send_nack(SDP_data_t *node, uint8_t reason){
+  node->ack = SDP_NACK;
+  
+  return sdp_send_response(node, &reason, 1);
+}
+
+/**
+* @brief Framing error (or rx frame timeout) after ack field was received: send compact NACK immediately, so sender 
+*        retransmits frame without waiting for response timeout. Only requests are NACK-ed (with request ID option, 
+*        ID byte must be received) and at most one NACK is sent in SDP_FAST_NACK_INTERVAL.
+*/
+static void send_fast_nack(SDP_data_t *node, uint8_t reason){
+  if((node->ack != SDP_ACK) && (node->ack != SDP_BATCH) && (node->ack != SDP_BOND)){
+    return; // response, notification or control frame
+  }
+  if((node->_address_size != 0) && (node->_rx_dst >= SDP_GROUP_ADDRESS)){
+    return; // frame addressed to group is never answered
+  }
+  if(get_id_size(node) == 0){
+    if(node->_expect_response){
+      return; // frame is probably response, this node retransmits request on timeout
+    }
+  }
+  else{
+    if((node->rx_data_index < get_prefix_size(node)) || ((node->rx_data[0] & SDP_ID_RESPONSE) != 0)){
+      return; // request ID not received or frame is response
+    }
+    node->rx_id = node->rx_data[0];
+    if(get_channel_size(node) != 0){
+      node->rx_channel = node->rx_data[get_id_size(node)];
+    }
+  }
+  if((HAL_GetTick() - node->_nack_time) < SDP_FAST_NACK_INTERVAL){
+    return;
+  }
+  
+  node->_nack_time = HAL_GetTick();
+  if(!send_nack(node, reason)){
+    sdp_debug(node, 250);
+  }
+}
+
+/**
+* @brief Transmit datagram (sdp_send_data() with SDP_QOS_DATAGRAM) once to node->tx_address, without waiting for response.
+* @retval Returns true if datagram was transmitted, false otherwise (datagram is counted in tx_dropped)
+*/
+static bool send_datagram(SDP_data_t *node, uint8_t *payload, uint8_t payload_size){
+  bool status = false;
+  
+  if(wait_for_token(node)){
+    node->_tx_dst = node->tx_address;
+    node->_tx_id = 0; // request ID option: datagram is not a response
+    node->_tx_channel = node->tx_channel;
+    status = compose_frame(node, SDP_DATAGRAM, payload, payload_size) && sdp_transmit_data(node);
+    node->_token_wanted = false;
+  }
+  if(!status){
+    node->tx_dropped++;
+    sdp_debug(node, 92);
+  }
+  
+  return status;
+}
+
+/**
+* @brief Addressing mode: transmit group frame once to node->tx_address (group or broadcast address), without 
+*        waiting for response. Group sequence number is incremented and stored in node->group_seq.
+* @retval Returns true if frame was transmitted, false otherwise (frame is counted in tx_dropped)
+*/
+static bool send_group_frame(SDP_data_t *node, uint8_t *payload, uint8_t payload_size){
+  bool status = false;
+  uint8_t index = node->tx_address - SDP_GROUP_ADDRESS;
+  
+  if((payload_size + SDP_GROUP_SEQ_SIZE) <= node->rx_tx_max_payload){
+    if(wait_for_token(node)){
+      node->_group_tx_seq[index]++;
+      node->group_seq = node->_group_tx_seq[index];
+      node->_tx_dst = node->tx_address;
+      node->_tx_id = 0; // request ID option: group frame is not a response
+      node->_tx_channel = node->tx_channel;
+      status = compose_frame(node, SDP_GROUP, payload, payload_size) && sdp_transmit_data(node);
+      node->_token_wanted = false;
+    }
+  }
+  if(!status){
+    node->tx_dropped++;
+    sdp_debug(node, 94);
+  }
+  
+  return status;
+}
+
+/**
+* @brief Returns reason code of received NACK, SDP_NACK_UNKNOWN if NACK echoes payload (older nodes)
+*/
+static uint8_t get_nack_reason(SDP_data_t *node){
+  if(node->rx_data_index != 1){
+    return SDP_NACK_UNKNOWN;
+  }
+  
+  return node->rx_data[0];
+}
+
+/**
+* @brief Request ID option: transmit request without waiting for response (more requests can be in flight). 
+*        Response is matched by request ID and passed to callback from sdp_parse_rx_data() - responses can arrive 
+*        in any order. Request is retransmitted on timeout (ack_timeout/response_timeout) or NACK, callback is 
+*        called with status = false if all SDP_RETRANSMIT transmissions fail.
+*        node->tx_deadline != 0: request is not retransmitted after this time, callback is called with status = 
+*        false and node->tx_expired is incremented before callback.
+* @param callback - can be NULL. Do not call blocking SDP functions (sdp_send_data()) from callback.
+* @param id - if not NULL, request ID is stored here (also passed to callback)
+* @note Number of requests in flight is limited to SDP_MAX_REQUESTS (or negotiated link window).
+* @retval Returns true if request was transmitted, false otherwise
+*/
+bool sdp_send_request(SDP_data_t *node, uint8_t *payload, uint8_t payload_size, SDP_response_callback_t callback, uint8_t *id){
+  SDP_request_t *request;
+  bool status;
+  
+  request = get_free_request(node);
+  if((request == NULL) || (payload_size > node->rx_tx_max_payload)){
+    sdp_debug(node, 221);
+    return false;
+  }
+  if(!has_credit(node, node->tx_address, payload_size, true)){
+    sdp_debug(node, 101); // credits option: other node has no rx buffer space, retry when response arrives
+    node->credit_stalls++;
+    return false;
+  }
+  if(!wait_for_token(node)){
+    return false;
+  }
+  
+  request->ack = SDP_ACK;
+  request->copies = get_copies(node, SDP_ACK);
+  request->hedge_time = ((request->copies != 0) && (node->hedge_delay != 0)) ? (HAL_GetTick() + node->hedge_delay) : 0;
+  request->redundant = (request->copies > 1);
+  request->deadline = get_deadline(node);
+  status = open_request(node, request, node->tx_channel, node->tx_address, payload, payload_size, callback);
+  node->_token_wanted = false;  // token ring: token is not passed until all requests are closed
+  if(!status){
+    return false;
+  }
+  if(id != NULL){
+    *id = request->id;
+  }
+  
+  return true;
+}
+
+/**
+* @brief Request ID option: send response to request that was received earlier. Save node->rx_address and node->rx_id 
+*        in message handler and return without response - requests can so be completed in any order.
+* @note If link ACK option is not used, response must be sent before sender's response_timeout.
+*/
+bool sdp_send_deferred_response(SDP_data_t *node, uint8_t address, uint8_t id, uint8_t *payload, uint8_t payload_size){
+  node->_tx_dst = address;
+  node->_tx_id = id | SDP_ID_RESPONSE;
+  node->_tx_channel = node->tx_channel;
+  if(!compose_frame(node, SDP_ACK, payload, payload_size)){
+    sdp_debug(node, 70);
+    return false;
+  }
+  cache_response(node, address, id, payload, payload_size);
+  if(!sdp_transmit_data(node)){
+    sdp_debug(node, 71);
+    return false;
+  }
+  
+  return true;
+}
+
+/**
+* @brief Transmit notification - unsolicited frame that is passed to notify_handler of other node without response, 
+*        so device can push events (new data available) instead of being polled. Notification is transmitted once 
+*        (not acknowledged or retransmitted) to node->tx_address. Notifications carry sequence number, so other 
+*        node counts lost ones (node->notify_lost) and can poll device state instead of waiting for lost event.
+* @param payload_size >= 1, <= rx_tx_max_payload - SDP_NOTIFY_SEQ_SIZE
+* @note On shared half-duplex bus, use token passing (notification waits for token).
+* @retval Returns true if notification was transmitted, false otherwise
+*/
+bool sdp_send_notification(SDP_data_t *node, uint8_t *payload, uint8_t payload_size){
+  bool status = true;
+  
+  if((payload_size + SDP_NOTIFY_SEQ_SIZE) > node->rx_tx_max_payload){
+    sdp_debug(node, 242);
+    return false;
+  }
+  if(!wait_for_token(node)){
+    return false;
+  }
+  node->_notify_tx_seq++;
+  node->_tx_dst = node->tx_address;
+  node->_tx_id = 0; // request ID option: notification is not a response
+  node->_tx_channel = node->tx_channel;
+  if(!compose_frame(node, SDP_NOTIFY, payload, payload_size) || !sdp_transmit_data(node)){
+    sdp_debug(node, 242);
+    status = false;
+  }
+  node->_token_wanted = false;
+  
+  return status;
+}
+
+/**
+* @brief Aggregation: append message to batch (sent to node->tx_address) and return. Batch is sent (blocking, like 
+*        sdp_send_data()) when it reaches batch_threshold, when message does not fit into batch frame or when 
+*        tx_address changes, otherwise from sdp_parse_rx_data() after batch_delay or with sdp_flush_messages(). 
+*        Other node passes message to its message handler, there is no response payload.
+* @param payload_size >= 1, max rx_tx_max_payload - SDP_BATCH_LENGTH_SIZE
+* @note Batch is retransmitted as a whole - all its messages are lost if it is not acknowledged after SDP_RETRANSMIT retries.
+* @retval Returns false if aggregation is disabled, message is too long or batch transmission (triggered by this message) failed
+*/
+bool sdp_post_message(SDP_data_t *node, uint8_t *payload, uint8_t payload_size){
+  bool status = true;
+  
+  if((node->batch_threshold == 0) || (payload_size == 0) || 
+     ((payload_size + SDP_BATCH_LENGTH_SIZE) > node->rx_tx_max_payload) || node->_batch_sending){
+    sdp_debug(node, 252);
+    return false;
+  }
+  if((node->_batch_size != 0) && 
+     (((node->_batch_size + SDP_BATCH_LENGTH_SIZE + payload_size) > node->rx_tx_max_payload) || (node->_batch_dst != node->tx_address))){
+    status = sdp_flush_messages(node);  // message does not fit into batch frame (or goes to other node)
+  }
+  if(node->_batch_size == 0){
+    node->_batch_dst = node->tx_address;
+    node->_batch_time = HAL_GetTick();
+  }
+  node->_batch[node->_batch_size] = payload_size;
+  memcpy(&node->_batch[node->_batch_size + SDP_BATCH_LENGTH_SIZE], payload, payload_size);
+  node->_batch_size = node->_batch_size + SDP_BATCH_LENGTH_SIZE + payload_size;
+  if(node->_batch_size >= node->batch_threshold){
+    if(!sdp_flush_messages(node)){
+      status = false;
+    }
+  }
+  
+  return status;
+}
+
+/**
+* @brief Aggregation: transmit posted messages now and wait for acknowledge (with retransmissions, like sdp_send_data()).
+*        Batch is cleared even if transmission fails.
+* @retval Returns true if batch is acknowledged (or empty), false otherwise
+*/
+bool sdp_flush_messages(SDP_data_t *node){
+  bool status;
+  
+  if((node->_batch_size == 0) || node->_batch_sending){
+    return true;
+  }
+  node->_batch_sending = true;  // message handlers called while waiting for acknowledge can't post into this batch
+  status = wait_for_token(node);
+  if(status){
+    status = wait_for_credit(node, node->_batch_dst, node->_batch_size) && 
+             send_frame(node, node->_batch_dst, SDP_BATCH, node->_batch, node->_batch_size);
+    node->_token_wanted = false;
+  }
+  if(!status){
+    sdp_debug(node, 253);
+  }
+  node->_batch_size = 0;
+  node->_batch_sending = false;
+  
+  return status;
+}
+
+/**
+* @brief Addressing mode: ask node (address) which of last SDP_GROUP_HISTORY frames this node sent to group it 
+*        received - group frames are not acknowledged, sender collects acknowledges later with one poll per node. 
+*        Frames of other senders to the same group are not reported.
+* @param seq - sequence number of group frame (node->group_seq after sdp_send_data())
+* @param received - bit i is set if node received group frame with sequence number seq - i
+* @retval Returns false if node did not respond, true otherwise
+*/
+bool sdp_poll_group(SDP_data_t *node, uint8_t address, uint8_t group, uint8_t seq, uint16_t *received){
+  uint8_t payload[2];
+  uint8_t last_seq;
+  uint16_t bitmap;
+  bool status;
+  
+  *received = 0;
+  if((node->_address_size == 0) || (group < SDP_GROUP_ADDRESS)){
+    sdp_debug(node, 97);
+    return false;
+  }
+  payload[0] = SDP_CTRL_GROUP_POLL;
+  payload[1] = group;
+  if(!wait_for_token(node)){
+    return false;
+  }
+  status = send_frame(node, address, SDP_CTRL, payload, 2);
+  node->_token_wanted = false;
+  if(!status || (node->rx_data_index != SDP_CTRL_GROUP_POLL_SIZE) || (node->rx_data[0] != SDP_CTRL_GROUP_POLL) || (node->rx_data[1] != group)){
+    sdp_debug(node, 97);
+    return false;
+  }
+  
+  last_seq = node->rx_data[2];  // newest group frame that node received
+  bitmap = (uint16_t)(node->rx_data[3] | (node->rx_data[4] << 8));
+  if((uint8_t)(last_seq - seq) < SDP_GROUP_HISTORY){  // node received newer frames
+    *received = bitmap >> (uint8_t)(last_seq - seq);
+  }
+  else if((uint8_t)(seq - last_seq) < SDP_GROUP_HISTORY){ // node missed frames after last_seq
+    *received = (uint16_t)(bitmap << (uint8_t)(seq - last_seq));
+  }
+  
+  return true;
+}
+
+/**
+* @brief Link bonding: transmit frame on one of bonded links (sdp_set_bond()) without waiting for response, like 
+*        sdp_send_request(). Frames are striped across links round robin (link without free request slot or credits 
+*        is skipped) and carry sequence number of bond - receiver passes them to message handler in sequence order. 
+*        Each frame is retransmitted on its link until it is acknowledged, frame that fails on all retries is 
+*        skipped by receiver after reorder timeout. Frame that arrives after it was skipped fails (callback status 
+*        = false) without retransmission.
+* @param payload_size - max rx_tx_max_payload - 1 (sequence number byte is first byte of frame payload)
+* @param callback - can be NULL, called with link node (and request ID on that link) when frame is acknowledged or fails
+* @retval Returns true if frame was transmitted, false if node is not bonded or all links are busy - call 
+*         sdp_parse_rx_data() for each link and retry
+*/
+bool sdp_send_bonded(SDP_data_t *node, uint8_t *payload, uint8_t payload_size, SDP_response_callback_t callback){
+  SDP_data_t *link;
+  SDP_request_t *request;
+  uint8_t index;
+  uint8_t i;
+  
+  if((node->_bond_count == 0) || (payload_size == 0) || (payload_size >= node->rx_tx_max_payload)){
+    sdp_debug(node, 152);
+    return false;
+  }
+  if(is_bond_window_full(node)){
+    sdp_debug(node, 153); // receiver can't reorder more frames, retry when oldest frame is acknowledged
+    return false;
+  }
+  
+  node->_bond_tx[0] = node->_bond_tx_seq;
+  memcpy(&node->_bond_tx[SDP_BOND_SEQ_SIZE], payload, payload_size);
+  for(i = 0; i < node->_bond_count; i++){
+    index = (node->_bond_next + i) % node->_bond_count;
+    link = node->_bond_links[index];
+    request = get_free_request(link);
+    if((request == NULL) || (get_id_size(link) == 0) || !has_credit(link, link->tx_address, payload_size + SDP_BOND_SEQ_SIZE, true)){
+      continue; // link is busy, try next one
+    }
+    request->ack = SDP_BOND;
+    request->copies = 0;
+    request->hedge_time = 0;
+    request->redundant = false;
+    request->deadline = get_deadline(node);
+    if(!open_request(link, request, link->tx_channel, link->tx_address, node->_bond_tx, payload_size + SDP_BOND_SEQ_SIZE, callback)){
+      continue; // transmission failure, try next link
+    }
+    node->_bond_next = (index + 1) % node->_bond_count;
+    node->_bond_tx_seq++;
+    return true;
+  }
+  sdp_debug(node, 153);
+  
+  return false;
+}
+
+/**
+* @brief Channels option: put request into TX queue of logical channel (set up with sdp_set_channel()) and return. 
+*        Queued frames are transmitted as sdp_send_request() requests (to node->tx_address) by channel priority, 
+*        from sdp_parse_rx_data() - token ring: only while this node holds token.
+*        node->tx_deadline != 0: frames of the same priority are transmitted earliest deadline first, frame whose 
+*        deadline passed is dropped from queue (or not retransmitted) - callback is called with status = false 
+*        and node->tx_expired is incremented before callback.
+* @param callback - can be NULL, called when response arrives or request fails (see sdp_send_request())
+* @note Request ID option must be enabled.
+* @retval Returns true if request was queued, false if queue is full or request can't be queued
+*/
+bool sdp_queue_request(SDP_data_t *node, uint8_t channel, uint8_t *payload, uint8_t payload_size, SDP_response_callback_t callback){
+  SDP_channel_t *ch;
+  SDP_queued_frame_t *frame;
+  
+  if((channel >= SDP_MAX_CHANNELS) || ((node->options & SDP_OPTION_REQUEST_ID) == 0) || (payload_size > node->rx_tx_max_payload)){
+    sdp_debug(node, 231);
+    return false;
+  }
+  ch = &node->_channels[channel];
+  if((ch->count >= SDP_CHANNEL_QUEUE_SIZE) || (ch->queue[0].payload == NULL)){
+    sdp_debug(node, 232); // queue is full or channel is not set up
+    return false;
+  }
+  
+  frame = &ch->queue[(ch->head + ch->count) % SDP_CHANNEL_QUEUE_SIZE];
+  frame->dst = node->tx_address;
+  frame->size = payload_size;
+  frame->deadline = get_deadline(node);
+  frame->callback = callback;
+  memcpy(frame->payload, payload, payload_size);
+  ch->count++;
+  node->_queued_count++;
+  
+  channel_service(node);  // transmit now if request slot is free
+  
+  return true;
+}
+
 /**
 * @brief Get pointer to rx data buffer. Same as directly reading node->rx_data.
 */
@@ -328,10 +1697,31 @@ static void search_for_sof(SDP_data_t *node){
   uint8_t data;
 
   while(ring_buffer_get(&(node->_rx_buff), &data, 1) == RB_OK){
-    if(data == SDP_SOF){  // check if byte is SOF
+    if((node->framing == SDP_FRAMING_COBS) && (data == SDP_COBS_DELIMITER)){ // COBS frame starts with delimiter
+      node->_rx_state = SDP_RX_COBS_ACK;
+      node->ack = SDP_ACK;
+      node->rx_data_index = 0;
+      node->_cobs_code = 0; // no code byte received yet
+      node->_cobs_remaining = 0;
+      node->_rx_header_index = 0; // addressing mode: address bytes are decoded before ack
+      node->_rx_start_time = HAL_GetTick();
+      
+      return; // delimiter found, start decoding frame
+    }
+    else if((node->framing == SDP_FRAMING_LENGTH) && (data == SDP_SOF)){  // length frame starts with SOF
+      node->_rx_state = SDP_RX_HEADER;
+      node->ack = SDP_ACK;
+      node->rx_data_index = 0;
+      node->_rx_header_index = 0;
+      node->_rx_start_time = HAL_GetTick();
+      
+      return; // SOF found, start reading header
+    }
+    else if((node->framing == SDP_FRAMING_DLE) && (data == SDP_SOF)){  // check if byte is SOF
       // byte is SOF, update rx state
-      node->_rx_state = SDP_RX_ACK;
+      node->_rx_state = (node->_address_size != 0) ? SDP_RX_ADDRESS : SDP_RX_ACK;
       node->ack = SDP_ACK;      
+      node->_rx_header_index = 0;
       node->_rx_start_time = HAL_GetTick();
             
       return; // SOF found, start reading ack data
@@ -372,37 +1762,25 @@ static void append_new_data(SDP_data_t *node){
     else if(data == SDP_EOF){ // end of payload
       node->_rx_state = SDP_RX_IDLE; // update rx state
       
-      if(node->rx_data_index == 0){ // no payload, dummy response or faulty data (lost byte/s)
-        // do not check CRC or handle message
-        if(node->_expect_response == true){  // check if this node is waiting for response
-          node->_expect_response = false; // reset flag to let sdp_send_data() function continue
-          // node->ack field is than checked in sdp_send_data()
-        }
-        else{ // node is not expecting response, so this frame is corrupted or other error occured.
-          sdp_debug(node, 82);
-        }
-        
-        return;
-      }
-            
-      // check payload CRC value
-      if(!check_rx_message(node)){
-        node->ack = SDP_NACK;
-        
-        sdp_debug(node, 81);
-      }
-      node->rx_data_index = node->rx_data_index - SDP_CRC_SIZE; // update payload index (discarding received CRC data)
-      //node->rx_data_index == received data size
-     
-      sdp_handle_message(node); // CRC check OK handle payload
+      handle_rx_frame(node);
 
       return; // even if bytes are still in rx buffer, start with searching for SOF
     }
+    else if(data == SDP_SOF){ // SOF is escaped inside of frame - previous frame is incomplete, receive new frame
+      node->_rx_state = (node->_address_size != 0) ? SDP_RX_ADDRESS : SDP_RX_ACK;
+      node->ack = SDP_ACK;
+      node->_rx_header_index = 0;
+      node->_rx_start_time = HAL_GetTick();
+      
+      sdp_debug(node, 83);
+      return;
+    }
     else{ // pure data
       if(!rx_data_put(node, data)){
         node->_rx_state = SDP_RX_IDLE; // discard data, payload size out of range before EOF
                 
         sdp_debug(node, 80);
+        send_fast_nack(node, SDP_NACK_OVERSIZE);
         return;
       }
         
@@ -427,6 +1805,7 @@ static void check_if_eof(SDP_data_t *node){
         node->_rx_state = SDP_RX_IDLE; // discard data, payload size out of range before EOF
         
         sdp_debug(node, 90);
+        send_fast_nack(node, SDP_NACK_OVERSIZE);
         return;
       }
       
@@ -435,58 +1814,580 @@ static void check_if_eof(SDP_data_t *node){
       node->_rx_state = SDP_RX_IDLE;
       
       sdp_debug(node, 91);
+      send_fast_nack(node, SDP_NACK_FRAMING);
     }
   }
 }
 
 /**
-* @brief Check for message timeout
-* @retval Returns false if timeout occured, resets state and index
+* @brief Complete frame (ack and payload + CRC) is received. Check CRC and handle message.
+* @note This function is called on EOF (or COBS delimiter), rx state is already set to SDP_RX_IDLE
 */
-static bool rx_frame_timeout(SDP_data_t *node){
-  if(node->_rx_state != SDP_RX_IDLE){
-    if(HAL_GetTick() > (node->_rx_start_time + node->rx_msg_timeout)){
-      node->_rx_state = SDP_RX_IDLE;
-      
-      ring_buffer_flush(&node->_rx_buff);
-      
-      sdp_debug(node, 100);
-      return false;
+static void handle_rx_frame(SDP_data_t *node){
+  if(node->ack == SDP_NOTIFY){
+    receive_notification(node); // notification is never a response, even while this node is waiting for one
+    return;
+  }
+  if(node->ack == SDP_DATAGRAM){
+    receive_datagram(node); // datagram is never a response, corrupted datagram is not NACK-ed
+    return;
+  }
+  if(node->ack == SDP_GROUP){
+    receive_group_frame(node);  // group members never respond
+    return;
+  }
+  if((node->_address_size != 0) && (node->_rx_dst >= SDP_GROUP_ADDRESS)){
+    sdp_debug(node, 95); // only group frames are addressed to group, responses of members would collide
+    return;
+  }
+  if(node->_expect_response && (node->_address_size != 0) && (node->rx_address != node->_tx_dst) && (get_id_size(node) == 0)){
+    sdp_debug(node, 191); // frame from other node while waiting for response, ignore it
+    return;
+  }
+  if((node->ack == SDP_NACK) && !node->_expect_response && (get_id_size(node) == 0)){
+    sdp_debug(node, 251); // late NACK (request already timed out) is not answered - no NACK ping-pong
+    return;
+  }
+  
+  if(node->rx_data_index == 0){ // no payload, dummy response or faulty data (lost byte/s)
+    // do not check CRC or handle message
+    if(node->_expect_response && (get_id_size(node) == 0)){  // check if this node is waiting for response (with request ID option, frames always carry ID)
+      if(node->ack == SDP_LINK_ACK){
+        node->_link_acked = true; // frame received by other node, keep waiting for response
+        node->_link_ack_time = HAL_GetTick();
+        return;
+      }
+      node->_expect_response = false; // reset flag to let sdp_send_data() function continue
+      // node->ack field is than checked in sdp_send_data()
     }
-    else{
-      return true;
+    else{ // node is not expecting response, so this frame is corrupted or other error occured.
+      sdp_debug(node, 82);
     }
+    
+    return;
   }
-  else{
-    return true;
+  
+  // check payload CRC value
+  if(!check_rx_message(node) && !fec_correct(node)){
+    node->ack = SDP_NACK;
+    node->rx_crc_errors++;
+    
+    sdp_debug(node, 81);
+  }
+  node->rx_data_index = node->rx_data_index - SDP_CRC_SIZE; // update payload index (discarding received CRC data)
+  //node->rx_data_index == received data size
+  if((get_fec_size(node) != 0) && !receive_parity(node)){
+    node->ack = SDP_NACK;
+  }
+  
+  if((get_prefix_size(node) != 0) && !receive_prefix(node)){
+    return; // request ID option: response to sdp_send_request() is already handled
   }
   
+  if((node->options & SDP_OPTION_LINK_ACK) && !is_response(node)){
+    // acknowledge request before it is handled, response follows when message handler is done
+    if(!send_empty_frame(node, (node->ack == SDP_NACK) ? SDP_LINK_NACK : SDP_LINK_ACK)){
+      sdp_debug(node, 210);
+    }
+    if(node->ack == SDP_NACK){
+      return; // sender retransmits frame on link NACK
+    }
+  }
+ 
+  sdp_handle_message(node); // CRC check OK handle payload
 }
 
 /**
-* @brief Get data from rx_data and calculate CRC value, if CRC check = 0, data is OK
-* @retval Returns false if values does not match, true otherwise
+* @brief Notification frame is received. Check CRC and pass payload to node->notify_handler - no response is sent.
 */
-static bool check_rx_message(SDP_data_t *node){
-  uint16_t crc_value;
-  crc_value = sdp_user_calculate_crc(node, node->rx_data, node->rx_data_index); // index points to first free aray field
-  
-  if(crc_value == 0){
-    
-    return true; //success, no errors detected with CRC
+static void receive_notification(SDP_data_t *node){
+  if((node->rx_data_index == 0) || (!check_rx_message(node) && !fec_correct(node))){
+    sdp_debug(node, 240); // corrupted notification can't be retransmitted, drop it
+    return;
+  }
+  node->rx_data_index = node->rx_data_index - SDP_CRC_SIZE;
+  if((get_fec_size(node) != 0) && !receive_parity(node)){
+    sdp_debug(node, 240);
+    return;
+  }
+  if((get_prefix_size(node) != 0) && !receive_prefix(node)){
+    return;
+  }
+  if(node->rx_data_index < SDP_NOTIFY_SEQ_SIZE){
+    sdp_debug(node, 240);
+    return;
+  }
+  notify_record(node, node->rx_data[0]);
+  if(node->token){
+    sdp_debug(node, 202); // notifying node holds token - duplicated token, drop it
+    node->token = false;
+  }
+  if(node->notify_handler == NULL){
+    sdp_debug(node, 241);
+    return;
   }
   
-  return false;
+  node->notify_handler(node, &node->rx_data[SDP_NOTIFY_SEQ_SIZE], node->rx_data_index - SDP_NOTIFY_SEQ_SIZE);
 }
 
 /**
-* @brief Put byte into rx_data buffer
-* @note node->rx_data_index always points at first free element of array
-* @retval Returns false if buffer is full, true otherwise
+* @brief Store sequence number of received notification in node->notify_seq and count notifications that were 
+*        skipped since newest one (node->notify_lost). Addressing mode: sequence is checked per last notifying node.
 */
-static bool rx_data_put(SDP_data_t *node, uint8_t data){
-  if(node->rx_data_index >= (node->rx_tx_max_payload + SDP_CRC_SIZE)){
-    // index already out of range, no free place in array
+static void notify_record(SDP_data_t *node, uint8_t seq){
+  uint8_t missed = (uint8_t)(seq - node->_notify_rx_seq - 1);
+  
+  node->notify_seq = seq;
+  if(!node->_notify_synced || (node->_notify_src != node->rx_address)){ // first notification of this node
+    node->_notify_synced = true;
+    node->_notify_src = node->rx_address;
+  }
+  else if(missed >= 0x80){ // late (reordered) notification, it was counted as lost
+    return;
+  }
+  else if(missed != 0){
+    node->notify_lost += missed;
+    sdp_debug(node, 243);
+  }
+  node->_notify_rx_seq = seq;
+}
+
+/**
+* @brief Datagram is received. Check CRC and pass payload to message handler - responses are not transmitted, 
+*        corrupted datagram is dropped (counted in node->rx_dropped).
+*/
+static void receive_datagram(SDP_data_t *node){
+  if((node->rx_data_index == 0) || (!check_rx_message(node) && !fec_correct(node))){
+    node->rx_dropped++;
+    sdp_debug(node, 93);
+    return;
+  }
+  node->rx_data_index = node->rx_data_index - SDP_CRC_SIZE;
+  if(((get_fec_size(node) != 0) && !receive_parity(node)) || ((get_prefix_size(node) != 0) && !receive_prefix(node))){
+    node->rx_dropped++;
+    sdp_debug(node, 93);
+    return;
+  }
+  if(node->token){
+    sdp_debug(node, 202); // sending node holds token - duplicated token, drop it
+    node->token = false;
+  }
+  
+  node->_suppress_response = true;
+  node->ack = SDP_ACK;  // datagram is handled as correctly received frame
+  if((get_channel_size(node) != 0) && (node->rx_channel < SDP_MAX_CHANNELS) && (node->_channels[node->rx_channel].handler != NULL)){
+    node->_channels[node->rx_channel].handler(node, node->rx_data, node->rx_data_index); // channels option: channel message handler
+  }
+  else{
+    sdp_user_handle_message(node, node->rx_data, node->rx_data_index);
+  }
+  node->_suppress_response = false;
+}
+
+/**
+* @brief Decode COBS encoded bytes from rx buffer until delimiter is received.
+* @note This function is only called if rx state is SDP_RX_COBS_ACK or SDP_RX_COBS. 
+*       Each code byte holds number of following data bytes + 1. If code < 0xFF, zero byte is appended after data bytes.
+*/
+static void append_cobs_data(SDP_data_t *node){
+  uint8_t data;
+  
+  while(ring_buffer_get(&(node->_rx_buff), &data, 1) == RB_OK){
+    if(data == SDP_COBS_DELIMITER){
+      if(node->_cobs_code == 0){ // back to back delimiters, frame has not started yet
+        node->_rx_start_time = HAL_GetTick();
+        continue;
+      }
+      if((node->_cobs_remaining != 0) || (node->_rx_state == SDP_RX_COBS_ACK)){ 
+        // delimiter inside of block or no ack - framing error
+        sdp_debug(node, 162);
+        if(node->_rx_state == SDP_RX_COBS){ // ack field was received
+          send_fast_nack(node, SDP_NACK_FRAMING);
+        }
+        node->_rx_state = SDP_RX_IDLE;
+        
+        return;
+      }
+      node->_rx_state = SDP_RX_IDLE;  // end of frame, next delimiter starts new frame
+      
+      // last (implicit) zero is not part of frame
+      handle_rx_frame(node);
+      
+      return; // even if bytes are still in rx buffer, start with searching for delimiter
+    }
+    
+    if(node->_cobs_remaining == 0){ // code byte
+      if((node->_cobs_code != 0) && (node->_cobs_code != 0xFF)){  // previous block ended with zero
+        if(!cobs_rx_put(node, 0)){
+          return;
+        }
+      }
+      node->_cobs_code = data;
+      node->_cobs_remaining = data -1;
+    }
+    else{ // data byte
+      node->_cobs_remaining--;
+      if(!cobs_rx_put(node, data)){
+        return;
+      }
+    }
+  }// end of ring buffer data
+}
+
+/**
+* @brief Store decoded COBS byte. First byte of frame is ack (after address), others are payload and CRC.
+* @retval Returns false if payload size is out of range, true otherwise
+*/
+static bool cobs_rx_put(SDP_data_t *node, uint8_t data){
+  if((node->_rx_state == SDP_RX_COBS_ACK) && (node->_rx_header_index < node->_address_size)){ // address before ack
+    node->_rx_header[node->_rx_header_index] = data;
+    node->_rx_header_index++;
+    if((node->_rx_header_index == node->_address_size) && !check_rx_address(node, node->_rx_header)){
+      node->_rx_state = SDP_RX_IDLE;
+      return false;
+    }
+    
+    return true;
+  }
+  if(node->_rx_state == SDP_RX_COBS_ACK){
+    node->ack = data; // ACK or NACK received, continue with receiving payload
+    node->_rx_state = SDP_RX_COBS;
+    node->rx_data_index = 0;
+    
+    return true;
+  }
+  
+  if(!rx_data_put(node, data)){
+    node->_rx_state = SDP_RX_IDLE; // discard data, payload size out of range before delimiter
+    
+    sdp_debug(node, 161);
+    send_fast_nack(node, SDP_NACK_OVERSIZE);
+    return false;
+  }
+  
+  return true;
+}
+
+/**
+* @brief Receive fixed size header ([DST, SRC], ACK, FLAGS, LEN) and header CRC. If header is valid, exactly LEN payload 
+*        bytes + CRC follows. If header is corrupted, frame is discarded and receiver searches for next SOF (also 
+*        inside of received header).
+* @note This function is only called if rx state is SDP_RX_HEADER
+*/
+static void receive_header(SDP_data_t *node){
+  uint8_t data;
+  uint8_t i;
+  uint8_t *header = &node->_rx_header[node->_address_size]; // ACK, FLAGS, LEN
+  
+  while(ring_buffer_get(&(node->_rx_buff), &data, 1) == RB_OK){
+    node->_rx_header[node->_rx_header_index] = data;
+    node->_rx_header_index++;
+    if(node->_rx_header_index < (node->_address_size + SDP_LENGTH_HEADER_SIZE + SDP_LENGTH_HCRC_SIZE)){
+      continue;
+    }
+    
+    if(sdp_user_calculate_crc(node, node->_rx_header, node->_address_size + SDP_LENGTH_HEADER_SIZE + SDP_LENGTH_HCRC_SIZE) != 0){
+      sdp_debug(node, 170); // header CRC error, LEN can't be trusted
+      // SOF was false (inside of payload) or header is corrupted: next frame can start inside of received header
+      for(i = 0; i < node->_rx_header_index; i++){
+        if(node->_rx_header[i] == SDP_SOF){
+          break;
+        }
+      }
+      if(i == node->_rx_header_index){
+        node->_rx_state = SDP_RX_IDLE;
+        return;
+      }
+      i++;
+      memmove(node->_rx_header, &node->_rx_header[i], node->_rx_header_index - i);
+      node->_rx_header_index -= i;
+      continue;
+    }
+    node->_rx_state = SDP_RX_IDLE;
+    if(header[2] > (node->rx_tx_max_payload + get_prefix_size(node) + get_fec_size(node))){
+      sdp_debug(node, 171);
+      if((node->_address_size == 0) || check_rx_address(node, node->_rx_header)){
+        node->ack = header[0];
+        node->rx_data_index = 0;
+        send_fast_nack(node, SDP_NACK_OVERSIZE);
+      }
+      return;
+    }
+    if((node->_address_size != 0) && !check_rx_address(node, node->_rx_header)){
+      return;
+    }
+    
+    node->ack = header[0];
+    node->_rx_flags = header[1];
+    node->rx_data_index = 0;
+    if(header[2] == 0){ // header only - no payload and no CRC (dummy response)
+      handle_rx_frame(node);
+      return;
+    }
+    node->_rx_frame_size = header[2] + SDP_CRC_SIZE;
+    node->_rx_state = SDP_RX_LENGTH;
+    
+    return; // header OK, start receiving payload
+  }
+}
+
+/**
+* @brief Copy payload and CRC bytes from rx buffer to rx_data array (in blocks, no byte inspection)
+* @note This function is only called if rx state is SDP_RX_LENGTH
+*/
+static void receive_length_data(SDP_data_t *node){
+  uint16_t num;
+  
+  num = node->_rx_frame_size - node->rx_data_index; // remaining bytes of this frame
+  if(num > ring_buffer_size(&node->_rx_buff)){
+    num = ring_buffer_size(&node->_rx_buff);
+  }
+  if(ring_buffer_get(&(node->_rx_buff), &node->rx_data[node->rx_data_index], num) != RB_OK){
+    return;
+  }
+  node->rx_data_index = node->rx_data_index + num;
+  
+  if(node->rx_data_index == node->_rx_frame_size){ // payload and CRC received
+    node->_rx_state = SDP_RX_IDLE;
+    
+    handle_rx_frame(node);
+  }
+}
+
+/**
+* @brief Addressing mode, DLE framing: receive DST and SRC address bytes (not escaped) after SOF
+* @note This function is only called if rx state is SDP_RX_ADDRESS
+*/
+static void receive_address(SDP_data_t *node){
+  uint8_t data;
+  
+  while(ring_buffer_get(&(node->_rx_buff), &data, 1) == RB_OK){
+    node->_rx_header[node->_rx_header_index] = data;
+    node->_rx_header_index++;
+    if(node->_rx_header_index < node->_address_size){
+      continue;
+    }
+    
+    if(check_rx_address(node, node->_rx_header)){
+      node->_rx_state = SDP_RX_ACK;
+    }
+    else{
+      node->_rx_state = SDP_RX_IDLE;
+    }
+    return;
+  }
+}
+
+/**
+* @brief Addressing mode: check received DST address and store SRC address
+* @note Frames addressed to other nodes are normally dropped in address_filter(), so this is only a safety check
+* @retval Returns true if frame is addressed to this node, false otherwise
+*/
+static bool check_rx_address(SDP_data_t *node, uint8_t *address){
+  if(!is_own_address(node, address[0])){
+    sdp_debug(node, 190);
+    return false;
+  }
+  node->_rx_dst = address[0];
+  node->rx_address = address[1];
+  
+  return true;
+}
+
+/**
+* @brief Addressing mode: filter received bytes before they are put into rx buffer (called from ISR).
+*        Start byte (and COBS code byte) is held until DST address is received. Bytes of frames addressed 
+*        to other nodes are dropped, so bus traffic of other nodes never reaches parser.
+* @note DLE/COBS framing: frame header is not checked here (parser checks address again). Length framing: frame end 
+*       is calculated from LEN field, since SOF can appear inside of payload - see filter_length_header().
+* @param data - data[0] holds received byte. Held bytes are inserted before it.
+* @retval Returns number of bytes in data that must be put into rx buffer
+*/
+static uint8_t address_filter(SDP_data_t *node, uint8_t *data){
+  bool pass = (node->_filter_state == SDP_FILTER_PASS);
+  
+  if((node->framing == SDP_FRAMING_LENGTH) && (node->_filter_count != 0)){ // length framing: payload + CRC of frame
+    node->_filter_count--;
+    if(node->_filter_count == 0){ // last byte of frame
+      node->_filter_state = SDP_FILTER_IDLE;
+    }
+    return pass ? 1 : 0;
+  }
+  
+  switch(node->_filter_state){
+    case SDP_FILTER_START:
+      if(node->framing == SDP_FRAMING_LENGTH){
+        return filter_length_header(node, data);  // SOF | DST | SRC | ACK | FLAGS | LEN | HCRC
+      }
+      if(node->framing != SDP_FRAMING_COBS){
+        return filter_dst(node, data, data[0], false);  // SOF | DST
+      }
+      if(data[0] == SDP_COBS_DELIMITER){  // back to back delimiters
+        return 0;
+      }
+      node->_filter_code = data[0];
+      if(data[0] == 1){ // first block is empty, DST == 0 and this is next code byte
+        return filter_dst(node, data, 0, false);
+      }
+      node->_filter_state = SDP_FILTER_COBS_DST;
+      return 0;
+    
+    case SDP_FILTER_COBS_DST:
+      if(data[0] == SDP_COBS_DELIMITER){  // frame without data
+        node->_filter_state = SDP_FILTER_START;
+        return 0;
+      }
+      return filter_dst(node, data, data[0], true);
+    
+    default: // SDP_FILTER_IDLE, SDP_FILTER_PASS or SDP_FILTER_DROP
+      if(data[0] != ((node->framing == SDP_FRAMING_COBS) ? SDP_COBS_DELIMITER : SDP_SOF)){
+        return pass ? 1 : 0;
+      }
+      node->_filter_state = SDP_FILTER_START;
+      node->_filter_header_index = 0;
+      node->_bus_activity_time = HAL_GetTick(); // token ring: bus is not idle
+      if(pass && (node->framing == SDP_FRAMING_COBS)){
+        return 1; // COBS delimiter also ends accepted frame
+      }
+      return 0; // start byte is held until DST is received
+  }
+}
+
+/**
+* @brief Addressing mode: accept or drop frame according to its DST address. If frame is accepted, held start 
+*        byte (and COBS code byte) is inserted before received byte.
+* @retval Returns number of bytes in data that must be put into rx buffer
+*/
+static uint8_t filter_dst(SDP_data_t *node, uint8_t *data, uint8_t dst, bool held_code){
+  uint8_t size = 0;
+  
+  if(!is_own_address(node, dst)){
+    node->_filter_state = SDP_FILTER_DROP;
+    return 0;
+  }
+  
+  node->_filter_state = SDP_FILTER_PASS;
+  data[2] = data[0];  // received byte
+  if(node->framing == SDP_FRAMING_COBS){
+    data[size++] = SDP_COBS_DELIMITER;
+    if(held_code){
+      data[size++] = node->_filter_code;
+    }
+  }
+  else{
+    data[size++] = SDP_SOF;
+  }
+  data[size++] = data[2];
+  
+  return size;
+}
+
+/**
+* @brief Addressing mode, length framing: hold frame header until header CRC is received. LEN field is trusted only if 
+*        header CRC matches (corrupted LEN would shift end of frame into next frame), otherwise filter searches for 
+*        next SOF, starting inside of held header. Header of frame addressed to this node is inserted before received 
+*        byte, payload of frame that doesn't fit rx frame buffer is dropped (parser NACKs oversized frame from header).
+* @retval Returns number of bytes in data that must be put into rx buffer
+*/
+static uint8_t filter_length_header(SDP_data_t *node, uint8_t *data){
+  uint8_t size = SDP_ADDRESS_SIZE + SDP_LENGTH_HEADER_SIZE; // header without header CRC
+  uint8_t *header = node->_filter_header;
+  uint16_t crc_value;
+  uint8_t i;
+  
+  header[node->_filter_header_index] = data[0];
+  node->_filter_header_index++;
+  if(node->_filter_header_index < (size + SDP_LENGTH_HCRC_SIZE)){
+    return 0;
+  }
+  
+  crc_value = fast_crc(header, size); // RX interrupt can't use sdp_user_calculate_crc()
+  if((header[size] != (crc_value >> 8)) || (header[size +1] != (crc_value & 0x00FF))){
+    sdp_debug(node, 192);
+    // SOF was false (inside of payload) or header is corrupted: real frame can start inside of held header
+    for(i = 0; i < node->_filter_header_index; i++){
+      if(header[i] == SDP_SOF){
+        break;
+      }
+    }
+    if(i < node->_filter_header_index){
+      i++;
+      memmove(header, &header[i], node->_filter_header_index - i);
+      node->_filter_header_index -= i;
+    }
+    else{
+      node->_filter_state = SDP_FILTER_IDLE;
+    }
+    return 0;
+  }
+  node->_filter_count = (header[size -1] != 0) ? (header[size -1] + SDP_CRC_SIZE) : 0;
+  node->_filter_state = (node->_filter_count != 0) ? SDP_FILTER_DROP : SDP_FILTER_IDLE;
+  if(!is_own_address(node, header[0])){
+    return 0;
+  }
+  
+  if((SDP_SOF_SIZE + size + SDP_LENGTH_HCRC_SIZE + node->_filter_count) <= node->_max_frame_size){
+    node->_filter_state = (node->_filter_count != 0) ? SDP_FILTER_PASS : SDP_FILTER_IDLE;
+  }
+  data[0] = SDP_SOF;
+  memcpy(&data[SDP_SOF_SIZE], header, size + SDP_LENGTH_HCRC_SIZE);
+  
+  return SDP_SOF_SIZE + size + SDP_LENGTH_HCRC_SIZE;
+}
+
+/**
+* @brief Check for message timeout
+* @retval Returns false if timeout occured, resets state and index
+*/
+static bool rx_frame_timeout(SDP_data_t *node){
+  SDP_rx_state_t state = node->_rx_state;
+  
+  if(node->_rx_state != SDP_RX_IDLE){
+    if(HAL_GetTick() > (node->_rx_start_time + node->rx_msg_timeout)){
+      node->_rx_state = SDP_RX_IDLE;
+      
+      ring_buffer_flush(&node->_rx_buff);
+      
+      sdp_debug(node, 100);
+      if((state == SDP_RX_RECEIVING) || (state == SDP_RX_DLE) || (state == SDP_RX_COBS) || (state == SDP_RX_LENGTH)){
+        send_fast_nack(node, SDP_NACK_TIMEOUT); // ack field was received
+      }
+      return false;
+    }
+    else{
+      return true;
+    }
+  }
+  else{
+    return true;
+  }
+  
+}
+
+/**
+* @brief Get data from rx_data and calculate CRC value, if CRC check = 0, data is OK
+* @retval Returns false if values does not match, true otherwise
+*/
+static bool check_rx_message(SDP_data_t *node){
+  uint16_t crc_value;
+  crc_value = sdp_user_calculate_crc(node, node->rx_data, node->rx_data_index); // index points to first free aray field
+  
+  if(crc_value == 0){
+    
+    return true; //success, no errors detected with CRC
+  }
+  
+  return false;
+}
+
+/**
+* @brief Put byte into rx_data buffer
+* @note node->rx_data_index always points at first free element of array
+* @retval Returns false if buffer is full, true otherwise
+*/
+static bool rx_data_put(SDP_data_t *node, uint8_t data){
+  if(node->rx_data_index >= (node->rx_tx_max_payload + get_prefix_size(node) + get_fec_size(node) + SDP_CRC_SIZE)){
+    // index already out of range, no free place in array
     return false;
   }
   node->rx_data[node->rx_data_index] = data;  // put data into array
@@ -495,6 +2396,17 @@ static bool rx_data_put(SDP_data_t *node, uint8_t data){
   return true;
 }
 
+/**
+* @brief Put received bytes into rx buffer (called from ISR), buffer is flushed if there is not enough space
+*/
+static void rx_buffer_put(SDP_data_t *node, uint8_t *data, uint8_t size){
+  if(ring_buffer_put(&node->_rx_buff, data, size) != RB_OK){
+    sdp_debug(node, 2); //ring buffer full or not enough space
+    
+    ring_buffer_flush(&node->_rx_buff); // discard all data in buffer
+  }
+}
+
 /* Private TX ------------------------------------------------------------------*/
 /**
 * @brief Compose frame from data, SOF, DLE and EOF
@@ -507,17 +2419,62 @@ static bool compose_frame(SDP_data_t *node, uint8_t ack, uint8_t *data, uint8_t
   uint16_t tmp_index; // points to first available element of tx_data array
   uint8_t temp_data;
   uint32_t crc_value;
+  uint8_t prefix_size = get_prefix_size(node) + ((ack == SDP_GROUP) ? SDP_GROUP_SEQ_SIZE : 0) + 
+                        ((ack == SDP_NOTIFY) ? SDP_NOTIFY_SEQ_SIZE : 0);
   
   if(size > node->rx_tx_max_payload){
     sdp_debug(node, 110);
     return false;
   }
+  if((prefix_size + get_fec_size(node)) != 0){ // request ID/channels option: ID and channel byte are first payload bytes
+    if(size > (0xFF - prefix_size - get_fec_size(node))){ // LEN field is one byte (also max Reed-Solomon codeword size)
+      sdp_debug(node, 110);
+      return false;
+    }
+    if(get_id_size(node) != 0){
+      node->_tx_payload[0] = node->_tx_id;
+    }
+    if(get_channel_size(node) != 0){
+      node->_tx_payload[get_id_size(node)] = node->_tx_channel;
+    }
+    if(get_credit_size(node) != 0){
+      node->_tx_payload[get_id_size(node) + get_channel_size(node)] = get_rx_credit(node);
+    }
+    if(ack == SDP_GROUP){ // group frame: sequence number follows prefix
+      node->_tx_payload[get_prefix_size(node)] = node->_group_tx_seq[node->_tx_dst - SDP_GROUP_ADDRESS];
+    }
+    if(ack == SDP_NOTIFY){ // notification: sequence number follows prefix
+      node->_tx_payload[get_prefix_size(node)] = node->_notify_tx_seq;
+    }
+    if(size != 0){
+      memcpy(&node->_tx_payload[prefix_size], data, size);
+    }
+    data = node->_tx_payload;
+    size = size + prefix_size;
+    if((get_fec_size(node) != 0) && (size != 0)){ // FEC option: parity bytes follow payload (frame without payload stays empty)
+      fec_encode(data, size, &node->_tx_payload[size]);
+      size = size + get_fec_size(node);
+    }
+  }
+  
+  if(node->framing == SDP_FRAMING_COBS){
+    return compose_cobs_frame(node, ack, data, size, true);
+  }
+  if(node->framing == SDP_FRAMING_LENGTH){
+    return compose_length_frame(node, ack, data, size);
+  }
     
   crc_value = sdp_user_calculate_crc(node, data, size);
   
   node->_tx_data[0] = SDP_SOF;  // first byte of message is always SOF
-  node->_tx_data[1] = ack;  // second byte of message is always ack
-  tmp_index = 2;
+  tmp_index = 1;
+  if(node->_address_size != 0){ // addressing mode: DST | SRC
+    node->_tx_data[1] = node->_tx_dst;
+    node->_tx_data[2] = node->id;
+    tmp_index = 3;
+  }
+  node->_tx_data[tmp_index] = ack;  // followed by ack
+  tmp_index++;
   
   for(data_index = 0;  data_index < size; data_index++){
     temp_data = *data;
@@ -617,6 +2574,2279 @@ static bool append_crc_bytes(SDP_data_t *node, uint16_t crc_value){
   return true;  // success
 }
 
+/**
+* @brief Compose COBS encoded frame: DELIMITER | COBS([DST | SRC] | ACK | PAYLOAD + CRC) | DELIMITER
+* @param append_crc - false if frame without payload and CRC is composed (dummy response)
+* @note frame & size are stored in node's tx_data array and tx_data_size
+* @retval Returns false if frame size is exceded, true otherwise
+*/
+static bool compose_cobs_frame(SDP_data_t *node, uint8_t ack, uint8_t *data, uint8_t size, bool append_crc){
+  uint8_t data_index;
+  uint16_t crc_value;
+  
+  node->_tx_data[0] = SDP_COBS_DELIMITER;  // first byte of message is always delimiter
+  node->_cobs_code_index = 1; // placeholder for first code byte
+  node->_cobs_code = 1;
+  node->_tx_data_size = 2;
+  
+  if(node->_address_size != 0){ // addressing mode: DST | SRC
+    if(!cobs_put_byte(node, node->_tx_dst) || !cobs_put_byte(node, node->id)){
+      sdp_debug(node, 163);
+      return false;
+    }
+  }
+  if(!cobs_put_byte(node, ack)){
+    sdp_debug(node, 163);
+    return false;
+  }
+  for(data_index = 0;  data_index < size; data_index++){
+    if(!cobs_put_byte(node, data[data_index])){
+      sdp_debug(node, 163);
+      return false;
+    }
+  }
+  if(append_crc){
+    crc_value = sdp_user_calculate_crc(node, data, size);
+    if(!cobs_put_byte(node, (crc_value >> 8)) || !cobs_put_byte(node, (crc_value & 0x00FF))){
+      sdp_debug(node, 163);
+      return false;
+    }
+  }
+  
+  node->_tx_data[node->_cobs_code_index] = node->_cobs_code; // close last block
+  node->_tx_data[node->_tx_data_size] = SDP_COBS_DELIMITER; // last byte of message is always delimiter
+  node->_tx_data_size++;
+  
+  return true;
+}
+
+/**
+* @brief Append one byte to COBS encoded frame. Zero bytes (and full blocks) close current block and
+*        reserve place for the next code byte.
+* @retval Returns false if frame size is exceded, true otherwise
+*/
+static bool cobs_put_byte(SDP_data_t *node, uint8_t data){
+  if(node->_tx_data_size >= node->_max_frame_size){
+    return false;
+  }
+  
+  if(data != SDP_COBS_DELIMITER){
+    node->_tx_data[node->_tx_data_size] = data;
+    node->_tx_data_size++;
+    node->_cobs_code++;
+    if(node->_cobs_code != 0xFF){
+      return true;
+    }
+    // else - block is full (SDP_COBS_BLOCK_SIZE bytes), close it
+    if(node->_tx_data_size >= node->_max_frame_size){
+      return false;
+    }
+  }
+  node->_tx_data[node->_cobs_code_index] = node->_cobs_code;
+  node->_cobs_code_index = node->_tx_data_size;  // reserve place for next code byte
+  node->_cobs_code = 1;
+  node->_tx_data_size++;
+  
+  return true;
+}
+
+/**
+* @brief Compose length prefixed frame: SOF | [DST | SRC] | ACK | FLAGS | LEN | HCRC | PAYLOAD | CRC
+* @note Payload is copied as is (no escaping). If size == 0, frame ends with header CRC (dummy response).
+* @retval Returns false if frame size is exceded, true otherwise
+*/
+static bool compose_length_frame(SDP_data_t *node, uint8_t ack, uint8_t *data, uint8_t size){
+  uint16_t crc_value;
+  uint8_t i = SDP_SOF_SIZE; // tx_data index
+  
+  if((SDP_SOF_SIZE + node->_address_size + SDP_LENGTH_HEADER_SIZE + SDP_LENGTH_HCRC_SIZE + size + SDP_CRC_SIZE) > node->_max_frame_size){
+    sdp_debug(node, 172);
+    return false;
+  }
+  
+  node->_tx_data[0] = SDP_SOF;  // first byte of message is always SOF
+  if(node->_address_size != 0){ // addressing mode: DST | SRC (protected with header CRC)
+    node->_tx_data[i++] = node->_tx_dst;
+    node->_tx_data[i++] = node->id;
+  }
+  node->_tx_data[i++] = ack;
+  node->_tx_data[i++] = SDP_FLAGS_NONE;
+  node->_tx_data[i++] = size;
+  crc_value = sdp_user_calculate_crc(node, &node->_tx_data[SDP_SOF_SIZE], i - SDP_SOF_SIZE);
+  node->_tx_data[i++] = (crc_value >> 8); // msb
+  node->_tx_data[i++] = (crc_value & 0x00FF); //lsb
+  node->_tx_data_size = i;
+  if(size == 0){
+    return true;
+  }
+  
+  memcpy(&node->_tx_data[node->_tx_data_size], data, size);
+  node->_tx_data_size = node->_tx_data_size + size;
+  crc_value = sdp_user_calculate_crc(node, data, size);
+  node->_tx_data[node->_tx_data_size] = (crc_value >> 8); // msb
+  node->_tx_data[node->_tx_data_size +1] = (crc_value & 0x00FF); //lsb
+  node->_tx_data_size = node->_tx_data_size + SDP_CRC_SIZE;
+  
+  return true;
+}
+
+/* Link negotiation ------------------------------------------------------------------*/
+/**
+* @brief Exchange capabilities with other node and switch both nodes to the best common settings 
+*        (max payload, window, options, framing and baud rate).
+* @note Blocking call (as sdp_send_data()). Other node answers from sdp_parse_rx_data().
+*       New settings are confirmed with the first frame sent with them. If confirmation fails, both nodes
+*       fall back to initial settings (this node immediately, other node after SDP_LINK_FALLBACK_TIMEOUT).
+* @note rx_tx_max_payload must be at least SDP_CTRL_HELLO_SIZE (8) bytes.
+* @retval Returns true if link is up with negotiated settings, false otherwise
+*/
+bool sdp_negotiate(SDP_data_t *node){
+  bool status;
+  
+  if(!wait_for_token(node)){
+    return false;
+  }
+  status = negotiate_link(node);
+  node->_token_wanted = false;
+  
+  return status;
+}
+
+/**
+* @brief Link negotiation sequence: HELLO, SWITCH and CONFIRM (see sdp_negotiate())
+*/
+static bool negotiate_link(SDP_data_t *node){
+  uint8_t payload[SDP_CTRL_HELLO_SIZE];
+  uint8_t settings[SDP_CTRL_SWITCH_SIZE];
+  
+  compose_hello(node, payload);
+  if(!send_frame(node, node->tx_address, SDP_CTRL, payload, SDP_CTRL_HELLO_SIZE)){
+    if(node->link_state == SDP_LINK_INIT){
+      sdp_debug(node, 180);
+      return false;
+    }
+    // other node might be reset, retry with initial settings
+    link_fallback(node);
+    compose_hello(node, payload);
+    if(!send_frame(node, node->tx_address, SDP_CTRL, payload, SDP_CTRL_HELLO_SIZE)){
+      sdp_debug(node, 180);
+      return false;
+    }
+  }
+  if((node->rx_data_index != SDP_CTRL_HELLO_SIZE) || (node->rx_data[0] != SDP_CTRL_HELLO)){
+    sdp_debug(node, 181);
+    return false;
+  }
+  
+  select_link_settings(node, node->rx_data, settings);
+  if(!send_frame(node, node->tx_address, SDP_CTRL, settings, SDP_CTRL_SWITCH_SIZE)){
+    sdp_debug(node, 182);
+    return false;
+  }
+  if((node->rx_data_index != 2) || (node->rx_data[0] != SDP_CTRL_SWITCH) || (node->rx_data[1] != 0)){
+    sdp_debug(node, 183); // settings rejected
+    return false;
+  }
+  
+  wait_parsing(node, SDP_LINK_SWITCH_DELAY); // other node applies new settings after its response is transmitted
+  if(!apply_link_settings(node, settings)){
+    link_fallback(node);
+    return false;
+  }
+  
+  payload[0] = SDP_CTRL_CONFIRM;
+  if(!send_frame(node, node->tx_address, SDP_CTRL, payload, 1)){
+    sdp_debug(node, 184); // new settings don't work, other node will fall back after SDP_LINK_FALLBACK_TIMEOUT
+    link_fallback(node);
+    return false;
+  }
+  node->link_state = SDP_LINK_UP;
+  
+  return true;
+}
+
+/**
+* @brief Handle link control frame (HELLO, SWITCH, CONFIRM or TOKEN) from other node and send response
+*/
+static void handle_control_frame(SDP_data_t *node){
+  uint8_t payload[SDP_CTRL_HELLO_SIZE];
+  SDP_group_rx_t *group_rx;
+  
+  if(node->rx_data_index == 0){
+    sdp_debug(node, 187);
+    return;
+  }
+  switch(node->rx_data[0]){
+    case SDP_CTRL_HELLO:
+      clear_cached_responses(node, node->rx_address); // new link session of other node
+      if(node->_notify_src == node->rx_address){
+        node->_notify_synced = false; // notification sequence of other node starts again
+      }
+      compose_hello(node, payload);
+      sdp_send_response(node, payload, SDP_CTRL_HELLO_SIZE);
+      break;
+    
+    case SDP_CTRL_SWITCH:
+      payload[0] = SDP_CTRL_SWITCH;
+      payload[1] = 0; // status OK
+      if((node->rx_data_index != SDP_CTRL_SWITCH_SIZE) || !check_link_settings(node, node->rx_data)){
+        payload[1] = 1; // settings rejected
+        sdp_send_response(node, payload, 2);
+        sdp_debug(node, 188);
+        break;
+      }
+      memcpy(&payload[2], node->rx_data, SDP_CTRL_SWITCH_SIZE); // rx_data is reset when settings are applied
+      if(!sdp_send_response(node, payload, 2)){ // response is sent with current settings
+        break;
+      }
+      if(!apply_link_settings(node, &payload[2])){
+        link_fallback(node);
+        break;
+      }
+      node->link_state = SDP_LINK_SWITCHED;
+      node->_link_fallback_time = HAL_GetTick() + SDP_LINK_FALLBACK_TIMEOUT;
+      break;
+    
+    case SDP_CTRL_CONFIRM:
+      payload[0] = SDP_CTRL_CONFIRM;
+      if(sdp_send_response(node, payload, 1)){
+        node->link_state = SDP_LINK_UP;
+      }
+      break;
+    
+    case SDP_CTRL_GROUP_POLL:
+      if((node->rx_data_index != 2) || (node->rx_data[1] < SDP_GROUP_ADDRESS)){
+        sdp_debug(node, 187);
+        break;
+      }
+      group_rx = find_group_rx(node, node->rx_data[1], node->rx_address); // frames that polling node sent to group
+      payload[0] = SDP_CTRL_GROUP_POLL;
+      payload[1] = node->rx_data[1];
+      payload[2] = (group_rx != NULL) ? group_rx->seq : 0;
+      payload[3] = (group_rx != NULL) ? (uint8_t)group_rx->received : 0;
+      payload[4] = (group_rx != NULL) ? (uint8_t)(group_rx->received >> 8) : 0;
+      sdp_send_response(node, payload, SDP_CTRL_GROUP_POLL_SIZE);
+      break;
+    
+    case SDP_CTRL_TOKEN:
+      if(node->_token_ring_size == 0){ // token passing is not enabled, no response - sender skips this node
+        sdp_debug(node, 187);
+        break;
+      }
+      payload[0] = SDP_CTRL_TOKEN;
+      if(sdp_send_response(node, payload, 1)){
+        node->token = true;
+        node->_token_time = HAL_GetTick();
+      }
+      break;
+    
+    default:
+      sdp_debug(node, 187);
+      break;
+  }
+}
+
+/**
+* @brief Compose HELLO control payload from node capabilities
+*/
+static void compose_hello(SDP_data_t *node, uint8_t *payload){
+  payload[0] = SDP_CTRL_HELLO;
+  payload[1] = SDP_LINK_VERSION;
+  payload[2] = (node->caps.max_payload < node->_base_max_payload) ? node->caps.max_payload : node->_base_max_payload;
+  payload[3] = node->caps.window;
+  payload[4] = node->caps.framings;
+  payload[5] = node->caps.options;
+  payload[6] = (node->caps.baudrates >> 8); // msb
+  payload[7] = (node->caps.baudrates & 0x00FF); //lsb
+}
+
+/**
+* @brief Select best common settings of this node capabilities and other node HELLO payload
+* @param settings - SWITCH control payload: SWITCH | FRAMING | MAX_PAYLOAD | WINDOW | OPTIONS | BAUD_INDEX
+*/
+static void select_link_settings(SDP_data_t *node, uint8_t *peer_hello, uint8_t *settings){
+  uint8_t i;
+  uint16_t baudrates;
+  uint8_t framings;
+  
+  settings[0] = SDP_CTRL_SWITCH;
+  settings[2] = (node->caps.max_payload < node->_base_max_payload) ? node->caps.max_payload : node->_base_max_payload;
+  if(peer_hello[2] < settings[2]){
+    settings[2] = peer_hello[2];
+  }
+  settings[3] = (node->caps.window < peer_hello[3]) ? node->caps.window : peer_hello[3];
+  settings[4] = node->caps.options & peer_hello[5];
+  
+  settings[1] = node->framing;  // if there is no better common framing, keep current one
+  framings = node->caps.framings & peer_hello[4];
+  for(i = 0; i < sizeof(sdp_framing_preference); i++){
+    if((framings & (1 << sdp_framing_preference[i])) && 
+       (get_max_frame_size(sdp_framing_preference[i], settings[2], node->_address_size) <= node->_alloc_frame_size)){
+      settings[1] = sdp_framing_preference[i];
+      break;
+    }
+  }
+  
+  settings[5] = SDP_BAUD_KEEP;
+  baudrates = node->caps.baudrates & ((peer_hello[6] << 8) | peer_hello[7]);
+  for(i = SDP_BAUDRATE_COUNT; i > 0; i--){ // highest common baud rate
+    if(baudrates & (1 << (i-1))){
+      if(sdp_baudrates[i-1] != node->baudrate){
+        settings[5] = i-1;
+      }
+      break;
+    }
+  }
+}
+
+/**
+* @brief Check if requested (SWITCH) settings are supported by this node
+*/
+static bool check_link_settings(SDP_data_t *node, uint8_t *settings){
+  if((settings[1] > SDP_FRAMING_LENGTH) || !(node->caps.framings & (1 << settings[1]))){
+    return false;
+  }
+  if((settings[2] > node->caps.max_payload) || (settings[2] > node->_base_max_payload) || 
+     (get_max_frame_size((SDP_framing_t)settings[1], settings[2], node->_address_size) > node->_alloc_frame_size)){
+    return false;
+  }
+  if((settings[3] > node->caps.window) || (settings[4] & ~node->caps.options)){
+    return false;
+  }
+  if((settings[5] != SDP_BAUD_KEEP) && ((settings[5] >= SDP_BAUDRATE_COUNT) || !(node->caps.baudrates & (1 << settings[5])))){
+    return false;
+  }
+  
+  return true;
+}
+
+/**
+* @brief Switch node to given (SWITCH payload) settings. Rx buffer is flushed.
+* @note Buffers are not re-allocated, settings must fit into initial worst case frame size
+*/
+static bool apply_link_settings(SDP_data_t *node, uint8_t *settings){
+  uint8_t i;
+  
+  if(settings[5] != SDP_BAUD_KEEP){
+    if(!sdp_user_set_baudrate(node, sdp_baudrates[settings[5]])){
+      sdp_debug(node, 185);
+      return false;
+    }
+    node->baudrate = sdp_baudrates[settings[5]];
+  }
+  node->framing = (SDP_framing_t)settings[1];
+  node->rx_tx_max_payload = settings[2];
+  node->_max_frame_size = get_max_frame_size(node->framing, node->rx_tx_max_payload, node->_address_size);
+  
+  node->link.max_payload = settings[2];
+  node->link.window = settings[3];
+  node->link.framings = (1 << settings[1]);
+  node->link.options = settings[4];
+  node->options = settings[4];
+  node->link.baudrates = 0;
+  for(i = 0; i < SDP_BAUDRATE_COUNT; i++){
+    if(sdp_baudrates[i] == node->baudrate){
+      node->link.baudrates = (1 << i);
+    }
+  }
+  sdp_reset_node(node); // discard data received with old settings
+  rtt_reset(node);  // adaptive timeout: new baud rate and framing change round trip time
+  node->tx_payload = node->rx_tx_max_payload; // adaptive payload: error rate of new link is not known yet
+  
+  return true;
+}
+
+/**
+* @brief Restore initial settings (framing, max payload, options, baud rate)
+*/
+static void link_fallback(SDP_data_t *node){
+  if(node->link_state == SDP_LINK_INIT){
+    return;
+  }
+  if(node->baudrate != node->uart.baudrate){
+    sdp_user_set_baudrate(node, node->uart.baudrate);
+    node->baudrate = node->uart.baudrate;
+  }
+  node->framing = node->_base_framing;
+  node->rx_tx_max_payload = node->_base_max_payload;
+  node->options = node->_base_options;
+  node->_max_frame_size = get_max_frame_size(node->framing, node->rx_tx_max_payload, node->_address_size);
+  node->link_state = SDP_LINK_INIT;
+  
+  sdp_reset_node(node);
+  rtt_reset(node);
+  node->tx_payload = node->rx_tx_max_payload;
+}
+
+/* Token ring ------------------------------------------------------------------*/
+/**
+* @brief If token passing is enabled, wait (and handle incoming data) until this node holds token. 
+*        Token is not passed until caller clears node->_token_wanted.
+* @retval Returns true if node can initiate transmission, false on SDP_TOKEN_WAIT_TIMEOUT
+*/
+static bool wait_for_token(SDP_data_t *node){
+  uint32_t timeout = HAL_GetTick() + SDP_TOKEN_WAIT_TIMEOUT;
+  
+  if(node->_token_ring_size == 0){
+    return true;
+  }
+  node->_token_wanted = true;
+  while(!node->token){
+    sdp_parse_rx_data(node);  // handle incoming frames, token is regenerated here if lost
+    
+    if(HAL_GetTick() > timeout){
+      sdp_debug(node, 200);
+      node->_token_wanted = false;
+      return false;
+    }
+  }
+  
+  return true;
+}
+
+/**
+* @brief Pass token after token_hold_time or regenerate lost token. Called from sdp_parse_rx_data().
+*        Token is passed without blocking: TOKEN frame is sent and its response is checked on next calls. Nodes in 
+*        ring that don't respond (SDP_RETRANSMIT times) are skipped, if no other node accepts token, this node keeps it.
+*/
+static void token_service(SDP_data_t *node){
+  uint32_t now = HAL_GetTick();
+  
+  if(node->_token_next != 0){ // token is being passed
+    if(node->_expect_response){
+      if(now < node->_token_response_time){
+        return; // wait for TOKEN response
+      }
+      node->_expect_response = false;
+    }
+    else if((node->ack == SDP_CTRL) && (node->rx_data_index != 0) && (node->rx_data[0] == SDP_CTRL_TOKEN)){
+      node->_token_next = 0;  // token passed
+      return;
+    }
+    
+    node->_token_retry++;
+    if(node->_token_retry >= SDP_RETRANSMIT){
+      sdp_debug(node, 203); // node in ring does not respond, skip it
+      node->_token_next++;
+      node->_token_retry = 0;
+      if(node->_token_next >= node->_token_ring_size){
+        // no other node accepted token
+        node->_token_next = 0;
+        node->token = true;
+        node->_token_time = now;
+        return;
+      }
+    }
+    send_token(node);
+  }
+  else if(node->token){
+    if(!node->_token_wanted && (node->_request_count == 0) && (now >= (node->_token_time + node->token_hold_time))){
+      node->token = false;
+      node->_token_next = 1;
+      node->_token_retry = 0;
+      send_token(node);
+    }
+  }
+  else if(now > (node->_bus_activity_time + node->token_timeout + (SDP_TOKEN_SLOT_TIME * node->_token_position))){
+    sdp_debug(node, 201); // bus is idle, token is lost - regenerate it
+    node->token = true;
+    node->_token_time = now;
+  }
+}
+
+/**
+* @brief Transmit TOKEN frame to ring member that token is being passed to, response is checked in token_service()
+*/
+static void send_token(SDP_data_t *node){
+  uint8_t payload = SDP_CTRL_TOKEN;
+  
+  node->_request_id = new_request_id(node);
+  node->_request_dst = node->_token_ring[(node->_token_position + node->_token_next) % node->_token_ring_size];
+  node->_tx_dst = node->_request_dst;
+  node->_tx_id = node->_request_id;
+  node->_tx_channel = node->tx_channel;
+  node->_token_response_time = HAL_GetTick() + get_timeout(node, true);
+  if(!compose_frame(node, SDP_CTRL, &payload, 1)){
+    sdp_debug(node, 62);
+    return; // retried on next call
+  }
+  if(node->_rx_state == SDP_RX_IDLE){
+    node->ack = SDP_NACK; // response updates it
+  }
+  node->_link_acked = ((node->options & SDP_OPTION_LINK_ACK) == 0);
+  node->_expect_response = true;
+  if(!sdp_transmit_data(node)){
+    sdp_debug(node, 61);
+    node->_expect_response = false;
+  }
+}
+
+/* Request ID ------------------------------------------------------------------*/
+/**
+* @brief Returns SDP_REQUEST_ID_SIZE if request ID option is enabled, 0 otherwise
+*/
+static uint8_t get_id_size(SDP_data_t *node){
+  return (node->options & SDP_OPTION_REQUEST_ID) ? SDP_REQUEST_ID_SIZE : 0;
+}
+
+/**
+* @brief Returns true if received frame is response (to blocking sdp_send_data() request), false if it is request
+* @note Without request ID option, each frame received while waiting for response is response.
+*/
+static bool is_response(SDP_data_t *node){
+  if(get_id_size(node) == 0){
+    return node->_expect_response;
+  }
+  
+  return ((node->rx_id & SDP_ID_RESPONSE) != 0);
+}
+
+/**
+* @brief Remove ID and channel byte from received payload (node->rx_id, node->rx_channel) and match responses by ID: 
+*        response to blocking sdp_send_data() request is handled normally, responses to sdp_send_request() are passed 
+*        to its callback.
+* @retval Returns true if frame must be handled (request or sdp_send_data() response), false otherwise
+*/
+static bool receive_prefix(SDP_data_t *node){
+  SDP_request_t *request;
+  uint8_t id;
+  
+  if(node->rx_data_index < get_prefix_size(node)){
+    sdp_debug(node, 82);
+    return false;
+  }
+  if(get_id_size(node) != 0){
+    node->rx_id = node->rx_data[0];
+  }
+  if(get_channel_size(node) != 0){
+    node->rx_channel = node->rx_data[get_id_size(node)];
+  }
+  if(get_credit_size(node) != 0){
+    node->_rx_credit = node->rx_data[get_id_size(node) + get_channel_size(node)];
+  }
+  node->rx_data_index = node->rx_data_index - get_prefix_size(node);
+  memmove(node->rx_data, &node->rx_data[get_prefix_size(node)], node->rx_data_index);
+  
+  if(get_id_size(node) == 0){ // channels/credits option only: link ACK carries channel and credit byte
+    if(node->_expect_response){
+      update_credits(node, node->_credit_mark);
+    }
+    if(node->_expect_response && (node->ack == SDP_LINK_ACK)){
+      node->_link_acked = true; // frame received by other node, keep waiting for response
+      node->_link_ack_time = HAL_GetTick();
+      return false;
+    }
+    return true;
+  }
+  if((node->rx_id & SDP_ID_RESPONSE) == 0){
+    return true; // request - handled even while this node is waiting for response
+  }
+  id = node->rx_id & (uint8_t)~SDP_ID_RESPONSE;
+  if(node->_expect_response && (id == node->_request_id) && ((node->_address_size == 0) || (node->rx_address == node->_request_dst))){
+    update_credits(node, node->_credit_mark);
+    if(node->ack == SDP_LINK_ACK){
+      node->_link_acked = true; // frame received by other node, keep waiting for response
+      node->_link_ack_time = HAL_GetTick();
+      return false;
+    }
+    return true;
+  }
+  
+  request = find_request(node, id);
+  if((request != NULL) && ((node->_address_size == 0) || (node->rx_address == request->dst))){
+    update_credits(node, request->credit_mark);
+    handle_request_response(node, request);
+  }
+  else{
+    sdp_debug(node, 220); // late response to closed request (or duplicate), ignore it
+  }
+  
+  return false;
+}
+
+/**
+* @brief Returns number of requests that can be in flight: SDP_MAX_REQUESTS or negotiated link window
+*/
+static uint8_t get_request_window(SDP_data_t *node){
+  if((node->link_state == SDP_LINK_UP) && (node->link.window < SDP_MAX_REQUESTS)){
+    return node->link.window;
+  }
+  
+  return SDP_MAX_REQUESTS;
+}
+
+/**
+* @brief Returns free request slot, NULL if request ID option is disabled, request window is full or payload buffer 
+*        of slot can't be allocated
+* @note Payload buffer (initial max payload bytes, negotiated payload can't be larger) is allocated when slot is used 
+*       first time, so nodes without request ID option don't allocate SDP_MAX_REQUESTS buffers. Slots are reused from 
+*       the first one, so only as many buffers are allocated as requests were in flight at once.
+*/
+static SDP_request_t * get_free_request(SDP_data_t *node){
+  uint8_t i;
+  
+  if(((node->options & SDP_OPTION_REQUEST_ID) == 0) || (node->_request_count >= get_request_window(node))){
+    return NULL;
+  }
+  for(i = 0; i < SDP_MAX_REQUESTS; i++){
+    if(!node->_requests[i].active){
+      if(node->_requests[i].payload == NULL){
+        node->_requests[i].payload = calloc(node->_base_max_payload, sizeof(uint8_t));
+        if(node->_requests[i].payload == NULL){
+          sdp_debug(node, 43);
+          return NULL;
+        }
+      }
+      return &node->_requests[i];
+    }
+  }
+  
+  return NULL;
+}
+
+/**
+* @brief Activate free request slot and transmit request
+* @retval Returns true on success, false otherwise (slot is released)
+*/
+static bool open_request(SDP_data_t *node, SDP_request_t *request, uint8_t channel, uint8_t dst, uint8_t *payload, uint8_t payload_size, SDP_response_callback_t callback){
+  request->id = new_request_id(node);
+  request->dst = dst;
+  request->channel = channel;
+  request->retransmit_count = 0;
+  request->callback = callback;
+  request->size = payload_size;
+  memcpy(request->payload, payload, payload_size);
+  request->active = true;
+  node->_request_count++;
+  
+  if(!transmit_request(node, request)){
+    request->active = false;
+    node->_request_count--;
+    return false;
+  }
+  
+  return true;
+}
+
+/**
+* @brief Returns next request ID (0 - 127) that is not used by any request in flight
+*/
+static uint8_t new_request_id(SDP_data_t *node){
+  do{
+    node->_next_id = (node->_next_id + 1) & (uint8_t)~SDP_ID_RESPONSE;
+  }while(find_request(node, node->_next_id) != NULL);
+  
+  return node->_next_id;
+}
+
+/**
+* @brief Returns request in flight with given ID, NULL if there is no such request
+*/
+static SDP_request_t * find_request(SDP_data_t *node, uint8_t id){
+  uint8_t i;
+  
+  for(i = 0; i < SDP_MAX_REQUESTS; i++){
+    if(node->_requests[i].active && (node->_requests[i].id == id)){
+      return &node->_requests[i];
+    }
+  }
+  
+  return NULL;
+}
+
+/**
+* @brief Handle response (or link ACK/NACK) to sdp_send_request() request
+*/
+static void handle_request_response(SDP_data_t *node, SDP_request_t *request){
+  if(node->ack == SDP_LINK_ACK){
+    if(!request->acked && (request->retransmit_count == 0) && !request->redundant){
+      rtt_sample(node, HAL_GetTick() - request->tx_time);
+    }
+    request->acked = true;  // keep waiting for response
+    return;
+  }
+  if(node->ack == SDP_ACK){
+    if(((node->options & SDP_OPTION_LINK_ACK) == 0) && (request->retransmit_count == 0) && !request->redundant){
+      rtt_sample(node, HAL_GetTick() - request->tx_time);
+    }
+    payload_success(node);
+    close_request(node, request, true);
+    return;
+  }
+  if(node->ack == SDP_NACK){
+    node->nack_reason = get_nack_reason(node);
+    if((request->ack == SDP_BOND) && (node->nack_reason == SDP_NACK_SKIPPED)){
+      sdp_debug(node, 144); // receiver already skipped bonded frame, retransmission would be NACK-ed too
+      close_request(node, request, false);
+      return;
+    }
+  }
+  sdp_debug(node, 224); // NACK or link NACK
+  payload_error(node);
+  retry_request(node, request);
+}
+
+/**
+* @brief Compose and transmit sdp_send_request() request frame (first transmission or retransmission)
+* @retval Returns true on success, false otherwise
+*/
+static bool transmit_request(SDP_data_t *node, SDP_request_t *request){
+  node->_tx_dst = request->dst;
+  node->_tx_id = request->id;
+  node->_tx_channel = request->channel;
+  request->acked = ((node->options & SDP_OPTION_LINK_ACK) == 0);
+  request->tx_time = HAL_GetTick();
+  if(!compose_frame(node, request->ack, request->payload, request->size) || !sdp_transmit_data(node)){
+    sdp_debug(node, 222);
+    return false;
+  }
+  transmit_copies(node, request->copies);
+  request->credit_mark = node->_tx_credit_used;
+  
+  return true;
+}
+
+/**
+* @brief Retransmit request or close it (callback status = false) if all SDP_RETRANSMIT transmissions failed
+*/
+static void retry_request(SDP_data_t *node, SDP_request_t *request){
+  request->retransmit_count++;
+  if(is_expired(request->deadline)){
+    sdp_debug(node, 105); // stale request is not retransmitted
+    node->tx_expired++;
+    close_request(node, request, false);
+    return;
+  }
+  if((request->retransmit_count >= SDP_RETRANSMIT) || !transmit_request(node, request)){
+    close_request(node, request, false);
+  }
+}
+
+/**
+* @brief Release request slot and call its callback. On success, response payload is in node->rx_data.
+*/
+static void close_request(SDP_data_t *node, SDP_request_t *request, bool status){
+  request->active = false;  // slot is free before callback, so callback can send new request
+  node->_request_count--;
+  if(request->callback == NULL){
+    return;
+  }
+  if(status){
+    request->callback(node, request->id, true, node->rx_data, node->rx_data_index);
+  }
+  else{
+    request->callback(node, request->id, false, NULL, 0);
+  }
+}
+
+/**
+* @brief Retransmit requests that were not acknowledged in ack_timeout (link ACK option) or 
+*        answered in response_timeout. Called from sdp_parse_rx_data().
+*/
+static void request_service(SDP_data_t *node){
+  SDP_request_t *request;
+  uint32_t timeout;
+  uint8_t i;
+  
+  for(i = 0; i < SDP_MAX_REQUESTS; i++){
+    request = &node->_requests[i];
+    if(!request->active){
+      continue;
+    }
+    if((request->hedge_time != 0) && (HAL_GetTick() > request->hedge_time)){
+      request->hedge_time = 0;
+      if(!request->acked || ((node->options & SDP_OPTION_LINK_ACK) == 0)){ // neither link ACK nor response arrived
+        request->redundant = transmit_hedge(node, request->dst, request->id, request->channel, request->ack, request->payload, request->size) || request->redundant;
+      }
+    }
+    timeout = get_timeout(node, request->acked);
+    if(HAL_GetTick() > (request->tx_time + timeout)){
+      sdp_debug(node, 223);
+      if(!request->acked || ((node->options & SDP_OPTION_LINK_ACK) == 0)){
+        rto_backoff(node);
+        payload_error(node);
+      }
+      retry_request(node, request);
+    }
+  }
+}
+
+/* Channels ------------------------------------------------------------------*/
+/**
+* @brief Returns SDP_CHANNEL_SIZE if channels option is enabled, 0 otherwise
+*/
+static uint8_t get_channel_size(SDP_data_t *node){
+  return (node->options & SDP_OPTION_CHANNELS) ? SDP_CHANNEL_SIZE : 0;
+}
+
+/**
+* @brief Returns number of protocol bytes before user payload (request ID, channel and credit byte)
+*/
+static uint8_t get_prefix_size(SDP_data_t *node){
+  return get_id_size(node) + get_channel_size(node) + get_credit_size(node);
+}
+
+/**
+* @brief Returns waiting channel with highest priority that has not used its share, SDP_MAX_CHANNELS if all queues are empty.
+*        If all waiting channels used their share, channel with highest priority is returned anyway. 
+*        Channel with earliest deadline (tx_deadline) wins between channels of equal priority.
+*/
+static uint8_t select_channel(SDP_data_t *node){
+  SDP_channel_t *ch;
+  uint8_t selected = SDP_MAX_CHANNELS;
+  uint8_t fallback = SDP_MAX_CHANNELS;
+  uint8_t i;
+  
+  for(i = 0; i < SDP_MAX_CHANNELS; i++){
+    ch = &node->_channels[i];
+    if(ch->count == 0){
+      continue;
+    }
+    if((fallback == SDP_MAX_CHANNELS) || (ch->priority > node->_channels[fallback].priority)){
+      fallback = i;
+    }
+    if((ch->share != 0) && (ch->budget == 0)){
+      continue; // share used, other waiting channels go first
+    }
+    if((selected == SDP_MAX_CHANNELS) || (ch->priority > node->_channels[selected].priority)){
+      selected = i;
+    }
+    else if((ch->priority == node->_channels[selected].priority) && is_earlier(get_queued_deadline(ch), get_queued_deadline(&node->_channels[selected]))){
+      selected = i; // equal priority: earliest deadline first
+    }
+  }
+  
+  return (selected != SDP_MAX_CHANNELS) ? selected : fallback;
+}
+
+/**
+* @brief Transmit queued frames by channel priority while request slots are free. Last free slot is reserved for 
+*        channel with highest priority. Called from sdp_parse_rx_data() and sdp_queue_request().
+*/
+static void channel_service(SDP_data_t *node){
+  SDP_channel_t *ch;
+  SDP_queued_frame_t *frame;
+  SDP_request_t *request;
+  uint8_t top_priority = 0;
+  uint8_t selected;
+  uint8_t i;
+  
+  if((node->_token_ring_size != 0) && !node->token){
+    return; // token ring: queued frames wait for token
+  }
+  for(i = 0; i < SDP_MAX_CHANNELS; i++){
+    if(node->_channels[i].priority > top_priority){
+      top_priority = node->_channels[i].priority;
+    }
+  }
+  
+  expire_queued(node);
+  while(node->_queued_count != 0){
+    selected = select_channel(node);
+    ch = &node->_channels[selected];
+    move_queued(ch, earliest_queued(ch), 0); // earliest deadline first, frames without deadline keep FIFO order
+    if((ch->priority < top_priority) && ((node->_request_count + 1) >= get_request_window(node)) && (get_request_window(node) > 1)){
+      return; // last request slot is reserved for urgent messages
+    }
+    request = get_free_request(node);
+    if(request == NULL){
+      return; // window is full, retry when response arrives
+    }
+    if(!has_credit(node, ch->queue[ch->head].dst, ch->queue[ch->head].size, true)){
+      return; // credits option: other node has no rx buffer space, retry when response arrives
+    }
+    
+    for(i = 0; i < SDP_MAX_CHANNELS; i++){ // other channels get their full share after this frame
+      if(i != selected){
+        node->_channels[i].budget = node->_channels[i].share;
+      }
+    }
+    if(ch->budget != 0){
+      ch->budget--;
+    }
+    frame = &ch->queue[ch->head];
+    request->ack = SDP_ACK;
+    request->copies = 0;  // queued requests are not sent redundantly
+    request->hedge_time = 0;
+    request->redundant = false;
+    request->deadline = frame->deadline;
+    ch->head = (ch->head + 1) % SDP_CHANNEL_QUEUE_SIZE;
+    ch->count--;
+    node->_queued_count--;
+    if(!open_request(node, request, selected, frame->dst, frame->payload, frame->size, frame->callback)){
+      sdp_debug(node, 233);
+      if(frame->callback != NULL){
+        frame->callback(node, 0, false, NULL, 0);
+      }
+    }
+  }
+}
+
+/* Response cache ------------------------------------------------------------------*/
+/**
+* @brief Returns cache entry of request with given source address and ID, NULL if request is not cached
+*/
+static SDP_cached_response_t * find_cached_response(SDP_data_t *node, uint8_t address, uint8_t id){
+  uint8_t i;
+  
+  for(i = 0; i < node->_cache_size; i++){
+    if(node->_cache[i].used && (node->_cache[i].id == id) && (node->_cache[i].address == address)){
+      return &node->_cache[i];
+    }
+  }
+  
+  return NULL;
+}
+
+/**
+* @brief Check received request against response cache. Retransmitted request is answered with cached response (or 
+*        ignored if its response was not sent yet), new request is stored in cache (oldest entry is replaced).
+* @retval Returns true if request was retransmitted (message handler must not be called), false otherwise
+*/
+static bool replay_response(SDP_data_t *node){
+  SDP_cached_response_t *entry;
+  uint16_t crc;
+  
+  if((node->_cache_size == 0) || (get_id_size(node) == 0)){
+    return false;
+  }
+  crc = sdp_user_calculate_crc(node, node->rx_data, node->rx_data_index);
+  entry = find_cached_response(node, node->rx_address, node->rx_id);
+  if((entry != NULL) && (entry->crc == crc)){
+    sdp_debug(node, 141); // retransmitted request, response was lost
+    if(entry->answered){
+      if(entry->size == 0){
+        send_empty_frame(node, SDP_ACK);
+      }
+      else{
+        sdp_send_response(node, entry->payload, entry->size);
+      }
+    }
+    return true;
+  }
+  
+  if(entry == NULL){ // new request, replace oldest entry (same ID with other payload - sender restarted, reuse entry)
+    entry = &node->_cache[node->_cache_next];
+    node->_cache_next = (node->_cache_next + 1) % node->_cache_size;
+  }
+  entry->used = true;
+  entry->answered = false;
+  entry->address = node->rx_address;
+  entry->id = node->rx_id;
+  entry->crc = crc;
+  
+  return false;
+}
+
+/**
+* @brief Store response of cached request (sent from message handler or deferred)
+*/
+static void cache_response(SDP_data_t *node, uint8_t address, uint8_t id, uint8_t *payload, uint8_t payload_size){
+  SDP_cached_response_t *entry;
+  
+  if((node->_cache_size == 0) || (get_id_size(node) == 0)){
+    return;
+  }
+  entry = find_cached_response(node, address, id);
+  if((entry == NULL) || (payload_size > node->rx_tx_max_payload)){
+    return; // request was already replaced in cache (or response does not fit)
+  }
+  if((payload_size != 0) && (payload != entry->payload)){ // replayed response is already in cache
+    memcpy(entry->payload, payload, payload_size);
+  }
+  entry->size = payload_size;
+  entry->answered = true;
+}
+
+/**
+* @brief Drop cached responses of requests from given source address - other node (re)started link with HELLO, its 
+*        request IDs start again, so its new request with same ID and payload must not be answered from cache
+*/
+static void clear_cached_responses(SDP_data_t *node, uint8_t address){
+  uint8_t i;
+  
+  for(i = 0; i < node->_cache_size; i++){
+    if(node->_cache[i].used && (node->_cache[i].address == address)){
+      node->_cache[i].used = false;
+      sdp_debug(node, 142);
+    }
+  }
+}
+
+/* Adaptive timeout ------------------------------------------------------------------*/
+/**
+* @brief Returns time to wait for first acknowledgement (link ACK, or response if link ACK option is disabled) of 
+*        transmitted frame or, if frame was acknowledged with link ACK, time to wait for response.
+*/
+static uint32_t get_timeout(SDP_data_t *node, bool link_acked){
+  if((node->options & SDP_OPTION_LINK_ACK) && link_acked){
+    return node->response_timeout;  // response follows when message handler is done
+  }
+  if((node->rto_max != 0) && (node->rto != 0) && (get_id_size(node) != 0)){
+    return node->rto; // request ID option: late response to retransmitted frame is discarded by ID
+  }
+  
+  return (node->options & SDP_OPTION_LINK_ACK) ? node->ack_timeout : node->response_timeout;
+}
+
+/**
+* @brief Returns wait time before retransmission after NACK or transmission failure
+*/
+static uint32_t get_retransmit_delay(SDP_data_t *node){
+  if((node->rto_max != 0) && (node->rto != 0) && (get_id_size(node) != 0)){
+    return node->srtt; // adaptive timeout: one round trip time
+  }
+  
+  return SDP_DEFAULT_RETRANSMIT_DELAY;
+}
+
+/**
+* @brief Update smoothed RTT and RTT variation with new sample, recalculate retransmission timeout (Jacobson)
+*/
+static void rtt_sample(SDP_data_t *node, uint32_t rtt){
+  uint32_t delta;
+  
+  if(node->rto_max == 0){
+    return;
+  }
+  if(node->rto == 0){ // first sample
+    node->srtt = rtt;
+    node->rttvar = rtt / 2;
+  }
+  else{
+    delta = (node->srtt > rtt) ? (node->srtt - rtt) : (rtt - node->srtt);
+    node->rttvar = (3 * node->rttvar + delta) / 4;
+    node->srtt = (7 * node->srtt + rtt) / 8;
+  }
+  node->rto = node->srtt + ((node->rttvar != 0) ? (4 * node->rttvar) : 1);
+  if(node->rto < node->rto_min){
+    node->rto = node->rto_min;
+  }
+  if(node->rto > node->rto_max){
+    node->rto = node->rto_max;
+  }
+}
+
+/**
+* @brief Double retransmission timeout after timeout (exponential backoff), up to rto_max
+*/
+static void rto_backoff(SDP_data_t *node){
+  if((node->rto_max == 0) || (node->rto == 0)){
+    return; // fixed timeouts (no RTT sample yet)
+  }
+  node->rto = node->rto * 2;
+  if(node->rto > node->rto_max){
+    node->rto = node->rto_max;
+  }
+}
+
+/**
+* @brief Discard RTT estimation (adaptive timeout is enabled or link settings are changed)
+*/
+static void rtt_reset(SDP_data_t *node){
+  node->srtt = 0;
+  node->rttvar = 0;
+  node->rto = 0;
+}
+
+/* Adaptive payload ------------------------------------------------------------------*/
+/**
+* @brief Transmitted frame was acknowledged: grow tx_payload by 1/4 of frame overhead (additive increase)
+*/
+static void payload_success(SDP_data_t *node){
+  uint16_t size;
+  
+  if(node->min_payload == 0){
+    return;
+  }
+  node->_payload_growth = node->_payload_growth + (uint8_t)get_max_frame_size(node->framing, 0, node->_address_size);
+  size = node->tx_payload + (node->_payload_growth / 4);
+  node->_payload_growth = node->_payload_growth % 4;
+  node->tx_payload = (size > node->rx_tx_max_payload) ? node->rx_tx_max_payload : (uint8_t)size;
+}
+
+/**
+* @brief Transmitted frame was NACK-ed or lost: shrink tx_payload by 1/4 (multiplicative decrease)
+*/
+static void payload_error(SDP_data_t *node){
+  node->tx_errors++;
+  if(node->min_payload == 0){
+    return;
+  }
+  if(node->tx_payload > node->rx_tx_max_payload){
+    node->tx_payload = node->rx_tx_max_payload;
+  }
+  node->tx_payload = node->tx_payload - (node->tx_payload / 4);
+  if(node->tx_payload < node->min_payload){
+    node->tx_payload = node->min_payload;
+  }
+  node->_payload_growth = 0;
+}
+
+/* Aggregation ------------------------------------------------------------------*/
+/**
+* @brief Batch frame is received: check message lengths, pass each message to message handler (responses are not 
+*        transmitted) and acknowledge whole batch with empty SDP_BATCH frame.
+*/
+static void receive_batch(SDP_data_t *node){
+  uint8_t *data = node->rx_data;
+  uint16_t size = node->rx_data_index;
+  uint16_t index = 0;
+  SDP_message_handler_t handler = NULL;
+  
+  while(index < size){ // LEN field of last message must not point past end of frame
+    if((data[index] == 0) || ((index + SDP_BATCH_LENGTH_SIZE + data[index]) > size)){
+      sdp_debug(node, 254);
+      send_nack(node, SDP_NACK_OVERSIZE);
+      return;
+    }
+    index = index + SDP_BATCH_LENGTH_SIZE + data[index];
+  }
+  if((get_channel_size(node) != 0) && (node->rx_channel < SDP_MAX_CHANNELS)){
+    handler = node->_channels[node->rx_channel].handler;  // channels option: channel message handler
+  }
+  
+  node->_suppress_response = true;
+  node->ack = SDP_ACK;  // each message is handled as correctly received frame
+  for(index = 0; index < size; index = index + SDP_BATCH_LENGTH_SIZE + data[index]){
+    if(handler != NULL){
+      handler(node, &data[index + SDP_BATCH_LENGTH_SIZE], data[index]);
+    }
+    else{
+      sdp_user_handle_message(node, &data[index + SDP_BATCH_LENGTH_SIZE], data[index]);
+    }
+  }
+  node->_suppress_response = false;
+  
+  if(!send_empty_frame(node, SDP_BATCH)){
+    sdp_debug(node, 255);
+  }
+}
+
+/**
+* @brief Aggregation: transmit batch when its oldest message waited batch_delay. Called from sdp_parse_rx_data().
+*/
+static void batch_service(SDP_data_t *node){
+  if(node->_expect_response || node->_batch_sending){
+    return; // blocking transmission in progress, batch is sent when it is done
+  }
+  if((HAL_GetTick() - node->_batch_time) >= node->batch_delay){
+    sdp_flush_messages(node);
+  }
+}
+
+/* Groups ------------------------------------------------------------------*/
+/**
+* @brief Addressing mode: returns true if frame with this DST address is accepted (own ID, broadcast or joined group)
+* @note This function is called from ISR (address_filter())
+*/
+static bool is_own_address(SDP_data_t *node, uint8_t address){
+  if(address == node->id){
+    return true;
+  }
+  
+  return (address >= SDP_GROUP_ADDRESS) && ((node->_groups & (1 << (address - SDP_GROUP_ADDRESS))) != 0);
+}
+
+/**
+* @brief Group frame is received. Check CRC, record sequence number (sdp_poll_group()) and pass payload to 
+*        message handler - responses are not transmitted, corrupted frame is dropped (counted in node->rx_dropped).
+*/
+static void receive_group_frame(SDP_data_t *node){
+  SDP_message_handler_t handler = NULL;
+  
+  if((node->rx_data_index == 0) || (!check_rx_message(node) && !fec_correct(node))){
+    node->rx_dropped++;
+    sdp_debug(node, 96);
+    return;
+  }
+  node->rx_data_index = node->rx_data_index - SDP_CRC_SIZE;
+  if(((get_fec_size(node) != 0) && !receive_parity(node)) || ((get_prefix_size(node) != 0) && !receive_prefix(node)) || 
+     (node->rx_data_index < SDP_GROUP_SEQ_SIZE) || (node->_address_size == 0) || (node->_rx_dst < SDP_GROUP_ADDRESS)){
+    node->rx_dropped++;
+    sdp_debug(node, 96);
+    return;
+  }
+  group_record(node, node->_rx_dst, node->rx_address, node->rx_data[0]);
+  if(node->token){
+    sdp_debug(node, 202); // sending node holds token - duplicated token, drop it
+    node->token = false;
+  }
+  if((get_channel_size(node) != 0) && (node->rx_channel < SDP_MAX_CHANNELS)){
+    handler = node->_channels[node->rx_channel].handler;  // channels option: channel message handler
+  }
+  
+  node->_suppress_response = true;
+  node->ack = SDP_ACK;  // group frame is handled as correctly received frame
+  if(handler != NULL){
+    handler(node, &node->rx_data[SDP_GROUP_SEQ_SIZE], node->rx_data_index - SDP_GROUP_SEQ_SIZE);
+  }
+  else{
+    sdp_user_handle_message(node, &node->rx_data[SDP_GROUP_SEQ_SIZE], node->rx_data_index - SDP_GROUP_SEQ_SIZE);
+  }
+  node->_suppress_response = false;
+}
+
+/**
+* @brief Mark group frame with sequence number seq, sent by node with given address to group, as received. Each 
+*        sender numbers its group frames, so bitmap (last SDP_GROUP_HISTORY frames, bit 0 is newest frame) is kept 
+*        per (group, sender) pair - new pair replaces oldest entry.
+*/
+static void group_record(SDP_data_t *node, uint8_t group, uint8_t address, uint8_t seq){
+  SDP_group_rx_t *entry = find_group_rx(node, group, address);
+  uint8_t ahead;
+  uint8_t behind;
+  
+  if(entry == NULL){
+    entry = &node->_group_rx[node->_group_rx_next];
+    node->_group_rx_next = (node->_group_rx_next + 1) % SDP_GROUP_SENDERS;
+    entry->group = group;
+    entry->address = address;
+    entry->received = 0;
+  }
+  ahead = (uint8_t)(seq - entry->seq);
+  behind = (uint8_t)(entry->seq - seq);
+  if((entry->received == 0) || ((ahead != 0) && (ahead < 0x80))){ // first or newer frame
+    entry->received = (ahead < SDP_GROUP_HISTORY) ? (uint16_t)((entry->received << ahead) | 1) : 1;
+    entry->seq = seq;
+  }
+  else if(behind < SDP_GROUP_HISTORY){  // late (reordered) frame
+    entry->received |= (uint16_t)(1 << behind);
+  }
+}
+
+/**
+* @brief Returns entry of group frames that node with given address sent to group, NULL if none was received
+*/
+static SDP_group_rx_t * find_group_rx(SDP_data_t *node, uint8_t group, uint8_t address){
+  uint8_t i;
+  
+  for(i = 0; i < SDP_GROUP_SENDERS; i++){
+    if((node->_group_rx[i].received != 0) && (node->_group_rx[i].group == group) && (node->_group_rx[i].address == address)){
+      return &node->_group_rx[i];
+    }
+  }
+  
+  return NULL;
+}
+
+/* Credits ------------------------------------------------------------------*/
+/**
+* @brief Returns SDP_CREDIT_SIZE if credits option is enabled, 0 otherwise
+*/
+static uint8_t get_credit_size(SDP_data_t *node){
+  return (node->options & SDP_OPTION_CREDITS) ? SDP_CREDIT_SIZE : 0;
+}
+
+/**
+* @brief Returns free rx buffer space in credits (SDP_CREDIT_UNIT bytes, max 255) - advertised in each transmitted frame
+*/
+static uint8_t get_rx_credit(SDP_data_t *node){
+  uint32_t credit = ring_buffer_free_elements(&node->_rx_buff) / SDP_CREDIT_UNIT;
+  
+  return (credit > 0xFF) ? 0xFF : (uint8_t)credit;
+}
+
+/**
+* @brief Returns number of credits (started SDP_CREDIT_UNIT blocks) that frame with given payload size takes in rx 
+*        buffer of other node - worst case size of active framing (DLE escapes can double it), so rx buffer can't 
+*        overflow whatever payload bytes are.
+*/
+static uint8_t get_frame_credits(SDP_data_t *node, uint8_t payload_size){
+  uint16_t frame_size = get_max_frame_size(node->framing, payload_size, node->_address_size);
+  
+  return (uint8_t)((frame_size + SDP_CREDIT_UNIT - 1) / SDP_CREDIT_UNIT);
+}
+
+/**
+* @brief Returns true if frame with given payload size can be transmitted to dst: credits option is disabled or other 
+*        node granted enough credits. Credits of one max sized frame are reserved for probe - request that is sent 
+*        when nothing is in flight (its response grants new credits), so it fits even if frames without response 
+*        (datagrams) used all other credits.
+* @param probe - frame waits for response (request, batch) and can be sent as probe
+*/
+static bool has_credit(SDP_data_t *node, uint8_t dst, uint8_t payload_size, bool probe){
+  // without request ID option, _expect_response stays set after failed sdp_send_data() (late response is not taken 
+  // as request), but nothing is retransmitted anymore
+  bool in_flight = (node->_request_count != 0) || node->_sending;
+  
+  if(get_credit_size(node) == 0){
+    return true;
+  }
+  if((node->_address_size != 0) && (dst != node->_credit_dst)){
+    if(in_flight){
+      return false; // credits belong to other node, wait until its frames are answered
+    }
+    node->_credit_dst = dst;
+    node->_tx_credit_limit = node->_tx_credit_used;
+  }
+  if(probe && !in_flight){
+    return true;
+  }
+  
+  return ((int32_t)(node->_tx_credit_limit - node->_tx_credit_used) >= 
+          (get_frame_credits(node, payload_size) + get_frame_credits(node, node->rx_tx_max_payload)));
+}
+
+/**
+* @brief Wait until frame with given payload size can be transmitted to dst (has_credit()) - incoming frames are 
+*        parsed, responses grant new credits and requests in flight time out if other node doesn't respond.
+* @retval Returns false if credits were not granted in SDP_RETRANSMIT response timeouts
+*/
+static bool wait_for_credit(SDP_data_t *node, uint8_t dst, uint8_t payload_size){
+  uint32_t timeout;
+  
+  if(has_credit(node, dst, payload_size, true)){
+    return true;
+  }
+  node->credit_stalls++;
+  timeout = HAL_GetTick() + (get_timeout(node, true) * SDP_RETRANSMIT);
+  while(!has_credit(node, dst, payload_size, true)){
+    sdp_parse_rx_data(node);  // handle incoming frames, responses carry credits of other node
+    
+    if(HAL_GetTick() > timeout){
+      sdp_debug(node, 102);
+      return false;
+    }
+  }
+  
+  return true;
+}
+
+/**
+* @brief Response from other node is received: its credit byte is free rx buffer space when response was sent, 
+*        all frames transmitted after request (mark) may still take that space.
+* @param mark - node->_tx_credit_used after last transmission of request that is answered
+*/
+static void update_credits(SDP_data_t *node, uint32_t mark){
+  if((get_credit_size(node) == 0) || ((node->_address_size != 0) && (node->rx_address != node->_credit_dst))){
+    return;
+  }
+  node->_tx_credit_limit = mark + node->_rx_credit;
+}
+
+/* Redundancy ------------------------------------------------------------------*/
+/**
+* @brief Returns number of copies of each transmission of frame with given ACK field value: node->tx_copies (at least 
+*        1) for requests with request ID option - other node drops duplicates by ID, 0 if redundancy can't be used.
+* @note Duplicates are dropped only by response cache, so redundancy is refused (frame is sent once) while response 
+*        cache of this node is disabled - nodes that use redundancy must both enable it (sdp_set_response_cache()).
+*/
+static uint8_t get_copies(SDP_data_t *node, uint8_t ack){
+  if((ack != SDP_ACK) || (get_id_size(node) == 0)){
+    return 0; // without request ID, response to copy would be taken as response to next request
+  }
+  if(node->_cache_size == 0){
+    if((node->tx_copies > 1) || (node->hedge_delay != 0)){
+      sdp_debug(node, 107);  // each copy would call (possibly non-idempotent) message handler of other node
+    }
+    return 0;
+  }
+  
+  return (node->tx_copies > 1) ? node->tx_copies : 1;
+}
+
+/**
+* @brief Transmit already composed frame (tx_data array) again, so copies are sent back to back
+*/
+static void transmit_copies(SDP_data_t *node, uint8_t copies){
+  uint8_t i;
+  
+  for(i = 1; i < copies; i++){
+    if(!sdp_transmit_data(node)){
+      sdp_debug(node, 103);
+      return;
+    }
+    node->tx_redundant++;
+  }
+}
+
+/**
+* @brief Compose and transmit duplicate of request that was not acknowledged in node->hedge_delay (tx_data array may 
+*        hold other frame meanwhile). Retransmission timeout still runs from original transmission.
+* @retval Returns true if duplicate was transmitted, false otherwise
+*/
+static bool transmit_hedge(SDP_data_t *node, uint8_t dst, uint8_t id, uint8_t channel, uint8_t ack, uint8_t *payload, uint8_t payload_size){
+  node->_tx_dst = dst;
+  node->_tx_id = id;
+  node->_tx_channel = channel;
+  if(!compose_frame(node, ack, payload, payload_size) || !sdp_transmit_data(node)){
+    sdp_debug(node, 103);
+    return false;
+  }
+  node->tx_redundant++;
+  
+  return true;
+}
+
+/* Deadlines ------------------------------------------------------------------*/
+/**
+* @brief Returns deadline timestamp of message that is sent now (node->tx_deadline), 0 - no deadline
+*/
+static uint32_t get_deadline(SDP_data_t *node){
+  return (node->tx_deadline != 0) ? (HAL_GetTick() + node->tx_deadline) : 0;
+}
+
+/**
+* @brief Returns true if given deadline timestamp passed (message is stale), false if there is no deadline (0)
+*/
+static bool is_expired(uint32_t deadline){
+  return (deadline != 0) && (HAL_GetTick() > deadline);
+}
+
+/**
+* @brief Returns true if deadline is earlier than other deadline (0 - no deadline, later than any deadline)
+*/
+static bool is_earlier(uint32_t deadline, uint32_t other){
+  return (deadline != 0) && ((other == 0) || (deadline < other));
+}
+
+/**
+* @brief Returns position (0 - head) of queued frame with earliest deadline, oldest frame if deadlines are equal
+*/
+static uint8_t earliest_queued(SDP_channel_t *ch){
+  uint8_t earliest = 0;
+  uint8_t i;
+  
+  for(i = 1; i < ch->count; i++){
+    if(is_earlier(ch->queue[(ch->head + i) % SDP_CHANNEL_QUEUE_SIZE].deadline, ch->queue[(ch->head + earliest) % SDP_CHANNEL_QUEUE_SIZE].deadline)){
+      earliest = i;
+    }
+  }
+  
+  return earliest;
+}
+
+/**
+* @brief Returns earliest deadline of queued frames (0 - no deadline)
+*/
+static uint32_t get_queued_deadline(SDP_channel_t *ch){
+  return ch->queue[(ch->head + earliest_queued(ch)) % SDP_CHANNEL_QUEUE_SIZE].deadline;
+}
+
+/**
+* @brief Move queued frame from one queue position (0 - head) to another, frames between keep their order. 
+*        Frames are swapped (with their payload buffers), payload is not copied.
+*/
+static void move_queued(SDP_channel_t *ch, uint8_t from, uint8_t to){
+  SDP_queued_frame_t tmp;
+  uint8_t a;
+  uint8_t b;
+  
+  while(from != to){
+    a = (ch->head + from) % SDP_CHANNEL_QUEUE_SIZE;
+    from = (from > to) ? (from - 1) : (from + 1);
+    b = (ch->head + from) % SDP_CHANNEL_QUEUE_SIZE;
+    tmp = ch->queue[a];
+    ch->queue[a] = ch->queue[b];
+    ch->queue[b] = tmp;
+  }
+}
+
+/**
+* @brief Drop queued frames whose deadline passed, their callbacks are called with status = false. 
+*        Frame is removed from queue before callback, so callback can queue new frame.
+*/
+static void expire_queued(SDP_data_t *node){
+  SDP_channel_t *ch;
+  SDP_response_callback_t callback;
+  uint8_t i;
+  uint8_t k;
+  
+  for(i = 0; i < SDP_MAX_CHANNELS; i++){
+    ch = &node->_channels[i];
+    k = 0;
+    while(k < ch->count){
+      if(!is_expired(ch->queue[(ch->head + k) % SDP_CHANNEL_QUEUE_SIZE].deadline)){
+        k++;
+        continue;
+      }
+      move_queued(ch, k, ch->count - 1);  // move stale frame to tail and drop it
+      callback = ch->queue[(ch->head + ch->count - 1) % SDP_CHANNEL_QUEUE_SIZE].callback;
+      ch->count--;
+      node->_queued_count--;
+      sdp_debug(node, 106);
+      node->tx_expired++;
+      if(callback != NULL){
+        callback(node, 0, false, NULL, 0);
+      }
+    }
+  }
+}
+
+/* Link bonding ------------------------------------------------------------------*/
+/**
+* @brief Bonded frame is received (and acknowledged on link that received it): store it in reorder buffer of bond 
+*        and pass frames to message handler of bond in sequence order. Duplicates (retransmitted frame whose 
+*        response was lost) are acknowledged again, but not passed to message handler. Sender never transmits 
+*        frame SDP_BOND_WINDOW frames ahead of its oldest unacknowledged frame, so missing frames that far behind 
+*        received frame failed on their links and are skipped. Skipped frame that arrives late is NACK-ed with 
+*        SDP_NACK_SKIPPED, so sender reports it as lost instead of delivered.
+*/
+static void receive_bond_frame(SDP_data_t *node){
+  SDP_data_t *bond = node->_bond;
+  uint8_t offset;
+  uint8_t index;
+  
+  if((bond == NULL) || (node->rx_data_index <= SDP_BOND_SEQ_SIZE)){
+    sdp_debug(node, 154);
+    return;
+  }
+  offset = (uint8_t)(node->rx_data[0] - bond->_bond_rx_seq);
+  while((offset >= SDP_BOND_WINDOW) && (offset < 0x80)){
+    skip_bonded(bond);
+    offset = (uint8_t)(node->rx_data[0] - bond->_bond_rx_seq);
+  }
+  if((offset >= (uint8_t)(0x100 - SDP_BOND_WINDOW)) && bond->_bond_skipped[node->rx_data[0] % SDP_BOND_WINDOW]){
+    sdp_debug(node, 143); // frame was skipped (sender retried it longer than this node waited), it is lost
+    if(!send_nack(node, SDP_NACK_SKIPPED)){
+      sdp_debug(node, 156);
+    }
+    return;
+  }
+  node->ack = SDP_ACK;
+  if(!send_empty_frame(node, SDP_ACK)){
+    sdp_debug(node, 156);
+  }
+  if(offset >= 0x80){
+    return; // older than next expected frame - already passed to message handler
+  }
+  
+  index = node->rx_data[0] % SDP_BOND_WINDOW;
+  if(bond->_bond_rx_size[index] == 0){
+    bond->_bond_rx_size[index] = (uint8_t)(node->rx_data_index - SDP_BOND_SEQ_SIZE);
+    memcpy(bond->_bond_rx[index], &node->rx_data[SDP_BOND_SEQ_SIZE], bond->_bond_rx_size[index]);
+    bond->_bond_rx_count++;
+    if(bond->_bond_gap_time == 0){
+      bond->_bond_gap_time = HAL_GetTick();
+    }
+  }
+  deliver_bonded(bond);
+}
+
+/**
+* @brief Pass received bonded frames to message handler of bond (primary node) while next expected frame is received
+*/
+static void deliver_bonded(SDP_data_t *node){
+  uint8_t index = node->_bond_rx_seq % SDP_BOND_WINDOW;
+  
+  while(node->_bond_rx_size[index] != 0){
+    node->_suppress_response = true;
+    node->ack = SDP_ACK;  // bonded frame is handled as correctly received frame
+    sdp_user_handle_message(node, node->_bond_rx[index], node->_bond_rx_size[index]);
+    node->_suppress_response = false;
+    node->_bond_rx_size[index] = 0;
+    node->_bond_skipped[index] = false;
+    node->_bond_rx_count--;
+    node->_bond_rx_seq++;
+    node->_bond_gap_time = HAL_GetTick(); // waiting frames wait for missing one from now on
+    index = node->_bond_rx_seq % SDP_BOND_WINDOW;
+  }
+  if(node->_bond_rx_count == 0){
+    node->_bond_gap_time = 0;
+  }
+}
+
+/**
+* @brief Skip missing bonded frame (next expected frame) and pass frames that waited for it to message handler
+*/
+static void skip_bonded(SDP_data_t *node){
+  sdp_debug(node, 155);
+  node->rx_dropped++;
+  node->_bond_skipped[node->_bond_rx_seq % SDP_BOND_WINDOW] = true; // late frame is NACK-ed
+  node->_bond_rx_seq++;
+  node->_bond_gap_time = HAL_GetTick();
+  deliver_bonded(node);
+}
+
+/**
+* @brief Skip missing bonded frame if frames after it wait longer than sender retries it (frame failed on its link), 
+*        so stream continues. Called from sdp_parse_rx_data() of each link.
+*/
+static void bond_service(SDP_data_t *node){
+  if(HAL_GetTick() > (node->_bond_gap_time + get_timeout(node, true) * (SDP_RETRANSMIT + 1))){
+    skip_bonded(node);
+  }
+}
+
+/**
+* @brief Returns true if next bonded frame would be SDP_BOND_WINDOW frames ahead of oldest unacknowledged frame, 
+*        receiver could not reorder it
+*/
+static bool is_bond_window_full(SDP_data_t *node){
+  SDP_request_t *request;
+  uint8_t i;
+  uint8_t k;
+  
+  for(i = 0; i < node->_bond_count; i++){
+    for(k = 0; k < SDP_MAX_REQUESTS; k++){
+      request = &node->_bond_links[i]->_requests[k];
+      if(request->active && (request->ack == SDP_BOND) && ((uint8_t)(node->_bond_tx_seq - request->payload[0]) >= SDP_BOND_WINDOW)){
+        return true;
+      }
+    }
+  }
+  
+  return false;
+}
+
+/* Fast path ------------------------------------------------------------------*/
+/**
+* @brief Fast path rx filter (called from sdp_receive_data(), ISR): bytes of each frame are held until end of frame, 
+*        so short requests with registered opcode can be answered in interrupt. Other frames (and frames longer 
+*        than SDP_FAST_FRAME_SIZE) are put into rx buffer in original order.
+* @note Length framing: end of frame is calculated from LEN field, since SOF can appear inside of payload. LEN is 
+*       trusted only if header CRC matches, otherwise held bytes up to next held SOF are passed to parser.
+*/
+static void fast_receive(SDP_data_t *node, uint8_t data){
+  uint8_t start = (node->framing == SDP_FRAMING_COBS) ? SDP_COBS_DELIMITER : SDP_SOF;
+  uint8_t header_size = node->_address_size + SDP_LENGTH_HEADER_SIZE; // length framing: header without header CRC
+  uint16_t crc_value;
+  uint8_t i;
+  bool end = false;
+  
+  node->_fast_rx_time = HAL_GetTick();
+  switch(node->_fast_state){
+    case SDP_FAST_SKIP: // rest of long frame (length framing: counted, COBS framing: until delimiter)
+      if(node->framing == SDP_FRAMING_LENGTH){
+        node->_fast_remaining--;
+        end = (node->_fast_remaining == 0);
+      }
+      else{
+        end = (data == SDP_COBS_DELIMITER);
+      }
+      if(end){
+        node->_fast_state = SDP_FAST_IDLE;
+      }
+      rx_buffer_put(node, &data, 1);
+      return;
+    
+    case SDP_FAST_HOLD:
+      if((node->framing != SDP_FRAMING_LENGTH) && (data == start) && ((node->framing == SDP_FRAMING_DLE) || (node->_fast_rx_size == 1))){
+        // DLE framing: SOF of next frame (held frame is incomplete), COBS framing: back to back delimiters
+        rx_buffer_put(node, node->_fast_rx, node->_fast_rx_size);
+        node->_fast_rx_size = 0;
+      }
+      break;
+    
+    default: // SDP_FAST_IDLE
+      if(data != start){
+        rx_buffer_put(node, &data, 1);
+        return;
+      }
+      node->_fast_state = SDP_FAST_HOLD;
+      node->_fast_rx_size = 0;
+      node->_fast_remaining = 0;
+      break;
+  }
+  
+  node->_fast_rx[node->_fast_rx_size] = data;
+  node->_fast_rx_size++;
+  if(node->framing == SDP_FRAMING_LENGTH){
+    if(node->_fast_remaining != 0){
+      node->_fast_remaining--;
+      end = (node->_fast_remaining == 0);
+    }
+    else if(node->_fast_rx_size == (SDP_SOF_SIZE + header_size + SDP_LENGTH_HCRC_SIZE)){ // header CRC, payload + CRC follow
+      crc_value = fast_crc(&node->_fast_rx[SDP_SOF_SIZE], header_size);
+      if((node->_fast_rx[SDP_SOF_SIZE + header_size] != (crc_value >> 8)) || (data != (crc_value & 0x00FF))){
+        // false SOF or corrupted header, LEN can't be trusted: real frame can start inside of held header
+        for(i = 1; i < node->_fast_rx_size; i++){
+          if(node->_fast_rx[i] == SDP_SOF){
+            break;
+          }
+        }
+        rx_buffer_put(node, node->_fast_rx, i);
+        node->_fast_rx_size -= i;
+        memmove(node->_fast_rx, &node->_fast_rx[i], node->_fast_rx_size);
+        if(node->_fast_rx_size == 0){
+          node->_fast_state = SDP_FAST_IDLE;
+        }
+        return;
+      }
+      data = node->_fast_rx[SDP_SOF_SIZE + header_size -1]; // LEN
+      node->_fast_remaining = (data != 0) ? (data + SDP_CRC_SIZE) : 0;
+      end = (node->_fast_remaining == 0); // header only
+    }
+  }
+  else if(node->framing == SDP_FRAMING_COBS){
+    end = (data == SDP_COBS_DELIMITER) && (node->_fast_rx_size > 1);
+  }
+  else{ // address and ACK bytes are not escaped
+    end = (data == SDP_EOF) && (node->_fast_rx_size > (SDP_SOF_SIZE + node->_address_size + SDP_ACK_SIZE));
+  }
+  
+  if(end){
+    node->_fast_state = SDP_FAST_IDLE;
+    if(!fast_handle_frame(node)){
+      rx_buffer_put(node, node->_fast_rx, node->_fast_rx_size);
+    }
+  }
+  else if((node->_fast_rx_size >= SDP_FAST_FRAME_SIZE) || ((node->_fast_rx_size + node->_fast_remaining) > SDP_FAST_FRAME_SIZE)){
+    rx_buffer_put(node, node->_fast_rx, node->_fast_rx_size); // frame is too long, pass it to parser
+    node->_fast_state = (node->framing == SDP_FRAMING_DLE) ? SDP_FAST_IDLE : SDP_FAST_SKIP;
+  }
+}
+
+/**
+* @brief Fast path: decode held frame and pass request with registered opcode to its handler, then compose response 
+*        (to SRC of request, with its ID and channel) and transmit it from RX interrupt.
+* @retval Returns true if request was handled, false if frame must be put into rx buffer
+*/
+static bool fast_handle_frame(SDP_data_t *node){
+  uint8_t frame[SDP_FAST_FRAME_SIZE]; // decoded [DST | SRC] | ACK | [FLAGS | LEN | HCRC] | ID | CHANNEL | PAYLOAD | CRC
+  uint8_t response[SDP_FAST_FRAME_SIZE];
+  uint8_t prefix_size = get_prefix_size(node);
+  uint8_t capacity; // max response payload size that fits decoded response frame
+  uint8_t size;
+  uint8_t i;
+  uint8_t id;
+  uint8_t channel;
+  uint16_t crc_value;
+  SDP_fast_handler_t handler;
+  
+  if(node->_tx_busy || node->_fast_tx_busy || (get_fec_size(node) != 0) || (get_credit_size(node) != 0)){ // FEC/credits: parity and credit bytes are handled by parser
+    return false;
+  }
+  size = fast_decode(node, frame);
+  i = node->_address_size + SDP_ACK_SIZE + ((node->framing == SDP_FRAMING_LENGTH) ? (SDP_LENGTH_HEADER_SIZE - SDP_ACK_SIZE + SDP_LENGTH_HCRC_SIZE) : 0);
+  if((size <= (i + prefix_size + SDP_CRC_SIZE)) || (frame[node->_address_size] != SDP_ACK)){ // opcode is required
+    return false;
+  }
+  if((node->_address_size != 0) && (frame[0] != node->id)){ // group or broadcast frame
+    return false;
+  }
+  if(node->framing == SDP_FRAMING_LENGTH){
+    crc_value = fast_crc(frame, i - SDP_LENGTH_HCRC_SIZE);
+    if((frame[i -2] != (crc_value >> 8)) || (frame[i -1] != (crc_value & 0x00FF)) || (frame[i -3] != (size - i - SDP_CRC_SIZE))){
+      return false;
+    }
+  }
+  size = size - i - SDP_CRC_SIZE; // ID + channel + payload
+  crc_value = fast_crc(&frame[i], size);
+  if((frame[i + size] != (crc_value >> 8)) || (frame[i + size +1] != (crc_value & 0x00FF))){
+    return false;
+  }
+  
+  id = (get_id_size(node) != 0) ? frame[i] : 0;
+  channel = (get_channel_size(node) != 0) ? frame[i + get_id_size(node)] : 0;
+  if(((id & SDP_ID_RESPONSE) != 0) || ((get_id_size(node) == 0) && node->_expect_response)){ // response to this node
+    return false;
+  }
+  handler = find_fast_handler(node, frame[i + prefix_size]);
+  if(handler == NULL){
+    return false;
+  }
+  capacity = SDP_FAST_FRAME_SIZE - i - prefix_size - SDP_CRC_SIZE; // response has the same header as request
+  size = handler(node, &frame[i + prefix_size], size - prefix_size, response, capacity);
+  if(size == 0){
+    return false;
+  }
+  if(size > capacity){
+    sdp_debug(node, 158);
+    return false;
+  }
+  
+  i = 0;
+  if(node->_address_size != 0){ // response is sent to SRC of request
+    frame[0] = frame[1];
+    frame[1] = node->id;
+    i = SDP_ADDRESS_SIZE;
+  }
+  frame[i++] = SDP_ACK;
+  if(node->framing == SDP_FRAMING_LENGTH){
+    frame[i++] = SDP_FLAGS_NONE;
+    frame[i++] = prefix_size + size;
+    crc_value = fast_crc(frame, i);
+    frame[i++] = (crc_value >> 8); // msb
+    frame[i++] = (crc_value & 0x00FF); //lsb
+  }
+  if(get_id_size(node) != 0){
+    frame[i++] = id | SDP_ID_RESPONSE;
+  }
+  if(get_channel_size(node) != 0){
+    frame[i++] = channel;
+  }
+  memcpy(&frame[i], response, size);
+  crc_value = fast_crc(&frame[i - prefix_size], prefix_size + size);
+  i = i + size;
+  frame[i++] = (crc_value >> 8); // msb
+  frame[i++] = (crc_value & 0x00FF); //lsb
+  
+  size = fast_compose(node, frame, i);
+  if(size == 0){
+    sdp_debug(node, 158);
+    return false;
+  }
+  node->_fast_tx_busy = true;
+  if(!sdp_user_start_transmit(node, node->_fast_tx, size)){ // non-blocking, RX interrupt returns while response is sent
+    node->_fast_tx_busy = false;
+    sdp_debug(node, 159);
+    return false;
+  }
+  node->fast_responses++;
+  
+  return true;
+}
+
+/**
+* @brief Fast path: find handler of request opcode (first payload byte)
+* @retval Returns NULL if opcode is not handled in RX interrupt
+*/
+static SDP_fast_handler_t find_fast_handler(SDP_data_t *node, uint8_t opcode){
+  uint8_t i;
+  
+  for(i = 0; i < node->_fast_count; i++){
+    if(node->_fast_opcodes[i] == opcode){
+      return node->_fast_handlers[i];
+    }
+  }
+  
+  return NULL;
+}
+
+/**
+* @brief Fast path: decode held frame (without start and end byte) into frame buffer
+* @retval Returns number of decoded bytes, 0 on framing error
+*/
+static uint8_t fast_decode(SDP_data_t *node, uint8_t *frame){
+  uint8_t *rx = node->_fast_rx;
+  uint8_t end = node->_fast_rx_size - SDP_EOF_SIZE; // EOF or end delimiter
+  uint8_t i = SDP_SOF_SIZE;
+  uint8_t size = 0;
+  uint8_t code;
+  
+  if(node->framing == SDP_FRAMING_LENGTH){ // header and payload are not escaped, frame has no EOF
+    memcpy(frame, &rx[SDP_SOF_SIZE], node->_fast_rx_size - SDP_SOF_SIZE);
+    return node->_fast_rx_size - SDP_SOF_SIZE;
+  }
+  if(node->framing == SDP_FRAMING_COBS){
+    while(i < end){
+      code = rx[i];
+      i++;
+      if((code == SDP_COBS_DELIMITER) || ((i + code - 1) > end)){
+        return 0;
+      }
+      memcpy(&frame[size], &rx[i], code - 1);
+      size = size + code - 1;
+      i = i + code - 1;
+      if(i < end){  // blocks are shorter than SDP_FAST_FRAME_SIZE, each block except last one ends with zero
+        frame[size++] = SDP_COBS_DELIMITER;
+      }
+    }
+    return size;
+  }
+  
+  size = node->_address_size + SDP_ACK_SIZE; // DLE framing: address and ACK bytes are not escaped
+  memcpy(frame, &rx[SDP_SOF_SIZE], size);
+  for(i = SDP_SOF_SIZE + size; i < end; i++){
+    if(rx[i] == SDP_DLE){
+      i++;
+      if(i == end){
+        return 0;
+      }
+      frame[size++] = rx[i] ^ SDP_DLE_XOR;
+    }
+    else{
+      frame[size++] = rx[i];
+    }
+  }
+  
+  return size;
+}
+
+/**
+* @brief Fast path: encode decoded response frame ([DST | SRC] | ACK | ... | CRC) into node->_fast_tx
+* @retval Returns number of encoded bytes, 0 if frame doesn't fit SDP_FAST_FRAME_SIZE
+*/
+static uint8_t fast_compose(SDP_data_t *node, uint8_t *frame, uint8_t size){
+  uint8_t *tx = node->_fast_tx;
+  uint8_t n = SDP_SOF_SIZE;
+  uint8_t code_index = SDP_SOF_SIZE;
+  uint8_t i;
+  
+  if(node->framing == SDP_FRAMING_LENGTH){
+    if((SDP_SOF_SIZE + size) > SDP_FAST_FRAME_SIZE){
+      return 0;
+    }
+    tx[0] = SDP_SOF;
+    memcpy(&tx[SDP_SOF_SIZE], frame, size);
+    return SDP_SOF_SIZE + size;
+  }
+  if(node->framing == SDP_FRAMING_COBS){
+    tx[0] = SDP_COBS_DELIMITER;
+    n = code_index + 1; // placeholder for first code byte
+    for(i = 0; i < size; i++){
+      if(n >= (SDP_FAST_FRAME_SIZE - SDP_EOF_SIZE)){
+        return 0;
+      }
+      if(frame[i] == SDP_COBS_DELIMITER){ // close block, reserve place for next code byte
+        tx[code_index] = n - code_index;
+        code_index = n;
+        n++;
+      }
+      else{
+        tx[n++] = frame[i];
+      }
+    }
+    tx[code_index] = n - code_index;
+    tx[n++] = SDP_COBS_DELIMITER;
+    return n;
+  }
+  
+  tx[0] = SDP_SOF;
+  for(i = 0; i < size; i++){
+    if(n > (SDP_FAST_FRAME_SIZE - SDP_EOF_SIZE - 2)){ // escaped byte and EOF must fit
+      return 0;
+    }
+    if((i >= (node->_address_size + SDP_ACK_SIZE)) && ((frame[i] == SDP_SOF) || (frame[i] == SDP_DLE) || (frame[i] == SDP_EOF))){
+      tx[n++] = SDP_DLE;
+      tx[n++] = frame[i] ^ SDP_DLE_XOR;
+    }
+    else{
+      tx[n++] = frame[i];
+    }
+  }
+  tx[n++] = SDP_EOF;
+  
+  return n;
+}
+
+/**
+* @brief Fast path: frame that is held (or skipped) longer than rx_msg_timeout was truncated - put held bytes into 
+*        rx buffer, so parser handles it as any other incomplete frame (rx frame timeout, NACK). Called from 
+*        sdp_parse_rx_data(), RX interrupt is disabled while held bytes are released.
+*/
+static void fast_timeout(SDP_data_t *node){
+  uint32_t primask;
+  
+  if((HAL_GetTick() - node->_fast_rx_time) <= node->rx_msg_timeout){
+    return;
+  }
+  primask = __get_PRIMASK();
+  __disable_irq();
+  if((node->_fast_state != SDP_FAST_IDLE) && ((HAL_GetTick() - node->_fast_rx_time) > node->rx_msg_timeout)){ // frame was not completed in the meantime
+    if(node->_fast_state == SDP_FAST_HOLD){
+      rx_buffer_put(node, node->_fast_rx, node->_fast_rx_size);
+    }
+    node->_fast_state = SDP_FAST_IDLE;
+  }
+  __set_PRIMASK(primask);
+}
+
+/* Forward error correction ------------------------------------------------------------------*/
+/**
+* @brief Returns SDP_FEC_SIZE if FEC option is enabled, 0 otherwise
+*/
+static uint8_t get_fec_size(SDP_data_t *node){
+  return (node->options & SDP_OPTION_FEC) ? SDP_FEC_SIZE : 0;
+}
+
+/**
+* @brief FEC option: CRC check failed - correct received ID + channel + payload + parity bytes with Reed-Solomon decoder.
+*        Corrected data must match received CRC, unless decoder found no errors (only CRC bytes were corrupted).
+* @retval Returns true if frame is repaired, false if it must be NACK-ed (or dropped)
+*/
+static bool fec_correct(SDP_data_t *node){
+  uint16_t size;
+  int8_t corrected;
+  
+  if((get_fec_size(node) == 0) || (node->rx_data_index <= (get_fec_size(node) + SDP_CRC_SIZE))){
+    return false;
+  }
+  size = node->rx_data_index - SDP_CRC_SIZE;
+  if(size > 0xFF){
+    return false; // not a Reed-Solomon codeword
+  }
+  corrected = fec_decode(node->rx_data, (uint8_t)size);
+  if((corrected < 0) || ((corrected > 0) && !check_rx_message(node))){
+    sdp_debug(node, 85); // too many corrupted bytes
+    return false;
+  }
+  
+  node->fec_corrected++;
+  sdp_debug(node, 84);
+  return true;
+}
+
+/**
+* @brief FEC option: discard parity bytes after payload (CRC is already discarded)
+* @retval Returns false if frame is too short to hold parity bytes (other node does not use FEC option)
+*/
+static bool receive_parity(SDP_data_t *node){
+  if(node->rx_data_index < get_fec_size(node)){
+    sdp_debug(node, 86);
+    return false;
+  }
+  node->rx_data_index = node->rx_data_index - get_fec_size(node);
+  
+  return true;
+}
+
+/**
+* @brief Calculate SDP_FEC_SIZE Reed-Solomon parity bytes of data (systematic code, generator roots are a^0 .. a^(SDP_FEC_SIZE-1))
+* @note Generator polynomial is calculated on each call - no tables, only a few multiplications for small SDP_FEC_SIZE
+*/
+static void fec_encode(uint8_t *data, uint8_t size, uint8_t *parity){
+  uint8_t generator[SDP_FEC_SIZE + 1]; // generator[i] is coefficient of x^i
+  uint8_t root = 1;
+  uint8_t feedback;
+  uint8_t i;
+  uint8_t j;
+  
+  memset(generator, 0, sizeof(generator));
+  generator[0] = 1;
+  for(i = 0; i < SDP_FEC_SIZE; i++){ // multiply with (x + a^i)
+    for(j = i + 1; j > 0; j--){
+      generator[j] = generator[j - 1] ^ gf_mul(generator[j], root);
+    }
+    generator[0] = gf_mul(generator[0], root);
+    root = gf_mul(root, 2);
+  }
+  
+  // parity = data(x) * x^SDP_FEC_SIZE mod generator(x), parity[0] is highest degree coefficient
+  memset(parity, 0, SDP_FEC_SIZE);
+  for(i = 0; i < size; i++){
+    feedback = data[i] ^ parity[0];
+    memmove(parity, &parity[1], SDP_FEC_SIZE - 1);
+    parity[SDP_FEC_SIZE - 1] = 0;
+    if(feedback != 0){
+      for(j = 0; j < SDP_FEC_SIZE; j++){
+        parity[j] ^= gf_mul(feedback, generator[SDP_FEC_SIZE - 1 - j]);
+      }
+    }
+  }
+}
+
+/**
+* @brief Correct Reed-Solomon codeword (data + parity bytes) in place: syndromes, Berlekamp-Massey error locator, 
+*        Chien search for error positions and Forney algorithm for error values.
+* @retval Returns number of corrected bytes, -1 if codeword has more than SDP_FEC_SIZE/2 corrupted bytes (detected)
+*/
+static int8_t fec_decode(uint8_t *data, uint8_t size){
+  uint8_t syndromes[SDP_FEC_SIZE];
+  uint8_t locator[SDP_FEC_SIZE + 1];  // locator[i] is coefficient of x^i
+  uint8_t previous[SDP_FEC_SIZE + 1];
+  uint8_t temp[SDP_FEC_SIZE + 1];
+  uint8_t evaluator[SDP_FEC_SIZE];
+  uint8_t errors = 0;
+  uint8_t shift = 1;
+  uint8_t previous_discrepancy = 1;
+  uint8_t discrepancy;
+  uint8_t coefficient;
+  uint8_t root = 1;
+  uint8_t x_inv;
+  uint8_t x_inv2;
+  uint8_t term;
+  uint8_t numerator;
+  uint8_t denominator;
+  uint8_t found = 0;
+  bool corrupted = false;
+  uint8_t i;
+  uint8_t j;
+  uint8_t k;
+  
+  for(i = 0; i < SDP_FEC_SIZE; i++){ // syndrome i = codeword(a^i)
+    syndromes[i] = 0;
+    for(j = 0; j < size; j++){
+      syndromes[i] = gf_mul(syndromes[i], root) ^ data[j];
+    }
+    if(syndromes[i] != 0){
+      corrupted = true;
+    }
+    root = gf_mul(root, 2);
+  }
+  if(!corrupted){
+    return 0;
+  }
+  
+  // Berlekamp-Massey
+  memset(locator, 0, sizeof(locator));
+  memset(previous, 0, sizeof(previous));
+  locator[0] = 1;
+  previous[0] = 1;
+  for(k = 0; k < SDP_FEC_SIZE; k++){
+    discrepancy = syndromes[k];
+    for(i = 1; i <= errors; i++){
+      discrepancy ^= gf_mul(locator[i], syndromes[k - i]);
+    }
+    if(discrepancy == 0){
+      shift++;
+      continue;
+    }
+    coefficient = gf_mul(discrepancy, gf_pow(previous_discrepancy, 254)); // a^254 = 1/a
+    memcpy(temp, locator, sizeof(locator));
+    for(i = 0; (i + shift) <= SDP_FEC_SIZE; i++){
+      locator[i + shift] ^= gf_mul(coefficient, previous[i]);
+    }
+    if((2 * errors) <= k){
+      errors = k + 1 - errors;
+      memcpy(previous, temp, sizeof(previous));
+      previous_discrepancy = discrepancy;
+      shift = 1;
+    }
+    else{
+      shift++;
+    }
+  }
+  if((2 * errors) > SDP_FEC_SIZE){
+    return -1;
+  }
+  
+  // error evaluator = syndromes(x) * locator(x) mod x^SDP_FEC_SIZE
+  for(i = 0; i < SDP_FEC_SIZE; i++){
+    evaluator[i] = 0;
+    for(j = 0; j <= i; j++){
+      evaluator[i] ^= gf_mul(syndromes[j], locator[i - j]);
+    }
+  }
+  
+  // Chien search: data[i] is coefficient of x^(size-1-i), error position X is root of locator(1/X)
+  x_inv = gf_pow(2, (uint8_t)((256 - size) % 255));  // a^-(size-1)
+  for(i = 0; i < size; i++){
+    term = 0;
+    for(j = errors + 1; j > 0; j--){
+      term = gf_mul(term, x_inv) ^ locator[j - 1];
+    }
+    if(term == 0){
+      // Forney: error value = X * evaluator(1/X) / locator'(1/X)
+      numerator = 0;
+      for(j = SDP_FEC_SIZE; j > 0; j--){
+        numerator = gf_mul(numerator, x_inv) ^ evaluator[j - 1];
+      }
+      denominator = 0;
+      x_inv2 = gf_mul(x_inv, x_inv);
+      term = 1;
+      for(j = 1; j <= errors; j = j + 2){ // formal derivative: only odd terms remain
+        denominator ^= gf_mul(locator[j], term);
+        term = gf_mul(term, x_inv2);
+      }
+      if(denominator == 0){
+        return -1;
+      }
+      data[i] ^= gf_mul(gf_pow(x_inv, 254), gf_mul(numerator, gf_pow(denominator, 254)));
+      found++;
+    }
+    x_inv = gf_mul(x_inv, 2);
+  }
+  if(found != errors){
+    return -1;  // locator roots outside of codeword
+  }
+  
+  return (int8_t)found;
+}
+
+/**
+* @brief Multiply in GF(2^8) (shift and add, no log/exp tables)
+*/
+static uint8_t gf_mul(uint8_t a, uint8_t b){
+  uint8_t result = 0;
+  
+  while(b != 0){
+    if(b & 0x01){
+      result ^= a;
+    }
+    a = (a & 0x80) ? (uint8_t)((a << 1) ^ SDP_FEC_POLYNOME) : (uint8_t)(a << 1);
+    b = b >> 1;
+  }
+  
+  return result;
+}
+
+/**
+* @brief Returns a^n in GF(2^8), a^254 is multiplicative inverse of a
+*/
+static uint8_t gf_pow(uint8_t a, uint8_t n){
+  uint8_t result = 1;
+  
+  while(n != 0){
+    if(n & 0x01){
+      result = gf_mul(result, a);
+    }
+    a = gf_mul(a, a);
+    n = n >> 1;
+  }
+  
+  return result;
+}
+
+/* Other ------------------------------------------------------------------*/
+/**
+* @brief Calculate worst case frame size of given framing and payload size
+*/
+static uint16_t get_max_frame_size(SDP_framing_t framing, uint8_t payload_size, uint8_t address_size){
+  uint16_t data_size = payload_size + SDP_REQUEST_ID_SIZE + SDP_CHANNEL_SIZE + SDP_CREDIT_SIZE + SDP_FEC_SIZE; // worst case includes optional request ID, channel, credit and parity
+  uint16_t body_size = address_size + SDP_ACK_SIZE + data_size + SDP_CRC_SIZE;
+  
+  if(framing == SDP_FRAMING_COBS){
+    // delimiter + code byte for each (started) block of 254 bytes + delimiter
+    return (1 + body_size + (body_size / SDP_COBS_BLOCK_SIZE) +1 +1);
+  }
+  if(framing == SDP_FRAMING_LENGTH){
+    return (SDP_SOF_SIZE + address_size + SDP_LENGTH_HEADER_SIZE + SDP_LENGTH_HCRC_SIZE + data_size + SDP_CRC_SIZE);
+  }
+  // payload/crc worst case = *2 - if every byte is special character, escaped with DLE (address is not escaped)
+  return (SDP_SOF_SIZE + address_size + SDP_ACK_SIZE + data_size*2+ SDP_CRC_SIZE*2 + SDP_EOF_SIZE );
+}
+
+/**
+* @brief Re-allocate rx buffer and tx data array if worst case frame size of current settings has changed
+*/
+static bool resize_frame_buffers(SDP_data_t *node){
+  uint16_t rx_buff_size;
+  
+  if(get_max_frame_size(node->framing, node->rx_tx_max_payload, node->_address_size) == node->_max_frame_size){
+    return true;  // buffers already fit this framing
+  }
+  node->_max_frame_size = get_max_frame_size(node->framing, node->rx_tx_max_payload, node->_address_size);
+  node->_alloc_frame_size = node->_max_frame_size;
+  
+  free((uint8_t *)node->_rx_buff.buff);
+  rx_buff_size = (node->_max_frame_size * node->_rx_buff_count) +1;
+  if(ring_buffer_init(&node->_rx_buff, rx_buff_size) != RB_OK){
+    sdp_debug(node, 160);
+    return false;
+  }
+  
+  free(node->_tx_data);
+  node->_tx_data = calloc(node->_max_frame_size +1, sizeof(uint8_t));
+  if(node->_tx_data == NULL){
+    sdp_debug(node, 160);
+    return false;
+  }
+  node->_tx_data_size = 0;
+  
+  return true;
+}
+
+/**
+* @brief Wait delay ms (wrap-safe), received data is parsed meanwhile (responses, requests of other nodes, control frames)
+*/
+static void wait_parsing(SDP_data_t *node, uint32_t delay){
+  uint32_t end_time = HAL_GetTick() + delay;
+  
+  while((int32_t)(HAL_GetTick() - end_time) < 0){
+    sdp_parse_rx_data(node);
+  }
+}
+
+/**
+* @brief CRC-16 of data, calculated with nibble table (sdp_crc_nibbles). Reentrant - RX interrupt must not use 
+*        sdp_user_calculate_crc(), which can share CRC peripheral with CRC calculation in main loop.
+* @note Matches sdp_user_calculate_crc() of CRC-16 with SDP_CRC_POLYNOME (0x8005) and initial value 0.
+*/
+static uint16_t fast_crc(uint8_t *data, uint8_t size){
+  uint16_t crc_value = 0;
+  uint8_t i;
+  
+  for(i = 0; i < size; i++){
+    crc_value = (crc_value << 4) ^ sdp_crc_nibbles[(crc_value >> 12) ^ (data[i] >> 4)];
+    crc_value = (crc_value << 4) ^ sdp_crc_nibbles[(crc_value >> 12) ^ (data[i] & 0x0F)];
+  }
+  
+  return crc_value;
+}
+
 /**
 * @brief Resets/flush rx buffer, reset index and receiver state machine to default state
 * @note This function can be called on UART/interface error handler (like overrun, noise or frame error)
@@ -625,6 +4855,8 @@ void sdp_reset_node(SDP_data_t *node){
   ring_buffer_flush(&node->_rx_buff); // flush all buffer stored data
   node->rx_data_index = 0;  // reset payload data index/size
   node->_rx_state = SDP_RX_IDLE;
+  node->_filter_state = SDP_FILTER_IDLE;
+  node->_fast_state = SDP_FAST_IDLE;
   node->ack = SDP_ACK;
 }
 
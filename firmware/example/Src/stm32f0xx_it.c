@@ -41,6 +41,7 @@
 static void UART_ErrorCallback(USART_TypeDef *huart);
 
 extern SDP_data_t uc_node;
+extern void sdp_user_transmit_isr(SDP_data_t *node);
 
 /******************************************************************************/
 /*            Cortex-M0 Processor Interruption and Exception Handlers         */ 
@@ -151,6 +152,12 @@ void USART1_IRQHandler(void)
     sdp_receive_data(&uc_node); // receive byte and store it in internal buffer
   }
   
+  // SDP - transmit fast path response, one byte at a time
+  if(LL_USART_IsActiveFlag_TXE(USART1) && LL_USART_IsEnabledIT_TXE(USART1))
+  {
+    sdp_user_transmit_isr(&uc_node);
+  }
+  
   // check for raming, error, overrun error or noise flag (FE=1 or ORE=1 or NF=1
   if(LL_USART_IsEnabledIT_ERROR(USART1) && 
       (LL_USART_IsActiveFlag_FE(USART1) || LL_USART_IsActiveFlag_ORE(USART1) || LL_USART_IsActiveFlag_NE(USART1))){
@@ -37,70 +37,423 @@
 #define SDP_DEFAULT_RX_MSG_TIMEOUT 300  // [ms] 
 #define SDP_DEFAULT_TX_MSG_TIMEOUT 300  // [ms] 
 #define SDP_DEFAULT_RESPONSE_TIMEOUT  300 //[ms]
-#define SDP_CRC_POLYNOME  0x8005 // CRC-16 -> https://www.lammertbies.nl/comm/info/crc-calculation.html
+#define SDP_DEFAULT_ACK_TIMEOUT  20 //[ms] link ACK option: receiver acknowledges frame in this time (response can follow later)
+#define SDP_DEFAULT_RETRANSMIT_DELAY  100 //[ms] wait before retransmission after NACK or transmission failure (avoid receiver overrun)
+#define SDP_DEFAULT_RTO_MIN  5  // [ms] adaptive timeout: lower limit of retransmission timeout (covers HAL_GetTick() resolution)
+#define SDP_CRC_POLYNOME  0x8005 // CRC-16 -> https://www.lammertbies.nl/comm/info/crc-calculation.html (fast path calculates CRC with table of this polynome)
+#define SDP_DEFAULT_FRAMING SDP_FRAMING_DLE // framing of new nodes, change per node with sdp_set_framing()
+#define SDP_LINK_FALLBACK_TIMEOUT 1000  // [ms] after link settings are switched, confirmation must arrive in this time or node falls back to initial settings
+#define SDP_LINK_SWITCH_DELAY 5  // [ms] initiator waits this time after switch response, so other node can apply new settings
+#define SDP_DEFAULT_TOKEN_HOLD_TIME 2 // [ms] token ring: holder keeps token this time (for sdp_send_data() calls) before it is passed
+#define SDP_DEFAULT_TOKEN_TIMEOUT (SDP_DEFAULT_RESPONSE_TIMEOUT + 100)  // [ms] token ring: bus idle time before lost token is regenerated (must be > response_timeout)
+#define SDP_TOKEN_SLOT_TIME 10  // [ms] token ring: added to token timeout for each position in ring, so only one node regenerates token
+#define SDP_TOKEN_WAIT_TIMEOUT  2000  // [ms] token ring: sdp_send_data() waits this time for token
+#define SDP_MAX_REQUESTS  4 // request ID option: max number of sdp_send_request() requests in flight (< 128), payload buffer of each is allocated on first use
+#define SDP_MAX_CHANNELS  4 // channels option: number of logical channels with own handler and TX queue (0 .. SDP_MAX_CHANNELS-1)
+#define SDP_CHANNEL_QUEUE_SIZE  4 // channels option: number of frames each channel TX queue can hold (sdp_queue_request())
+#define SDP_RESPONSE_CACHE_SIZE 8 // request ID option: max number of responses kept for retransmitted requests (sdp_set_response_cache())
+#define SDP_FAST_NACK_INTERVAL  10  // [ms] receiver sends at most one NACK on framing error (or rx frame timeout) in this time
+#define SDP_DEFAULT_BATCH_DELAY 5  // [ms] aggregation: oldest posted message waits at most this time before batch is sent
+#define SDP_CREDIT_UNIT 16  // credits option: one credit is this number of bytes of free rx buffer space (advertised up to 255 credits)
+#define SDP_BOND_MAX_LINKS  4 // link bonding: max number of physical links (nodes) of one bond
+#define SDP_BOND_WINDOW 16  // link bonding: max number of bonded frames in flight, receiver reorders them (power of 2, <= 128)
+#define SDP_MAX_FAST_HANDLERS 4 // fast path: max number of opcodes with handler called from RX interrupt (sdp_set_fast_handler())
+#define SDP_FAST_FRAME_SIZE 32  // fast path: max size of encoded request/response frame handled in RX interrupt (longer frames are parsed in sdp_parse_rx_data())
+#define SDP_FEC_SIZE  4 // FEC option: number of Reed-Solomon parity bytes per frame, up to SDP_FEC_SIZE/2 corrupted bytes are corrected (even number)
 
 /* Private ------------------------------------------------------------------*/     
 #define SDP_SOF 0x7E  // start byte of each frame
 #define SDP_EOF 0x66  // END byte of each frame
 #define SDP_DLE 0x7D  // Data Link Escape - or Escape (avoid escaping of message if EOF shows up in the middle of data)
+#define SDP_COBS_DELIMITER 0x00 // COBS framing: start and end byte of each frame, never appears inside encoded frame
+#define SDP_LENGTH_HEADER_SIZE 3  // length framing: ACK, FLAGS and LEN header bytes (protected with header CRC)
+#define SDP_LENGTH_HCRC_SIZE 2  // length framing: number of header CRC bytes
+#define SDP_CTRL  0xC3  // ACK field value of link control frames (negotiation) - handled internally, not passed to user
+#define SDP_ADDRESS_SIZE  2 // addressing mode: DST and SRC address bytes after start byte
+#define SDP_LINK_ACK  0x3C  // link ACK option: ACK field value of frame without payload - frame received OK, response follows
+#define SDP_LINK_NACK 0xA5  // link ACK option: ACK field value of frame without payload - frame CRC error, retransmit
+#define SDP_REQUEST_ID_SIZE 1 // request ID option: ID byte is first byte of payload (before user payload, protected with CRC)
+#define SDP_ID_RESPONSE 0x80  // request ID option: ID byte flag - frame is response (or link ACK) to request with this ID
+#define SDP_NOTIFY  0x5A  // ACK field value of notification - unsolicited frame, SEQ byte follows prefix, passed to node->notify_handler without response
+#define SDP_NOTIFY_SEQ_SIZE 1 // sequence number byte of notification (after request ID/channel/credit prefix)
+#define SDP_DATAGRAM  0x96  // ACK field value of datagram - best-effort frame, passed to message handler without response
+#define SDP_GROUP 0xE1  // addressing mode: ACK field value of group frame - SEQ byte follows prefix, passed to message handler without response
+#define SDP_GROUP_SEQ_SIZE  1 // addressing mode: sequence number byte of group frame (after request ID/channel/credit prefix)
+#define SDP_GROUP_ADDRESS 0xF0  // addressing mode: group (multicast) addresses are 0xF0 - 0xFE, node IDs must be lower
+#define SDP_BROADCAST_ADDRESS 0xFF  // addressing mode: frames to this address are accepted by all nodes
+#define SDP_GROUP_COUNT 16  // number of group addresses, including broadcast address
+#define SDP_GROUP_HISTORY 16  // number of last group frames (per group and sender) that group poll reports (bits of uint16_t)
+#define SDP_GROUP_SENDERS 8 // addressing mode: number of (group, sender) pairs whose received frames are kept for group poll (oldest pair is replaced)
+#define SDP_BATCH 0x69  // aggregation: ACK field value of batch frame - payload is LEN | MESSAGE | LEN | MESSAGE ..., response is empty SDP_BATCH frame
+#define SDP_BATCH_LENGTH_SIZE 1 // aggregation: length byte before each message in batch frame
+#define SDP_CHANNEL_SIZE  1 // channels option: channel byte follows request ID (before user payload, protected with CRC)
+#define SDP_CREDIT_SIZE 1 // credits option: credit byte follows channel byte (before user payload, protected with CRC)
+#define SDP_BOND 0x1E // link bonding: ACK field value of bonded frame - SEQ byte follows prefix, response is empty ACK frame
+#define SDP_BOND_SEQ_SIZE 1 // link bonding: sequence number byte of bonded frame (after request ID/channel/credit prefix)
 
+// NACK reason codes - NACK frame payload (after request ID/channel/credit prefix) is one reason byte instead of received payload
+#define SDP_NACK_UNKNOWN  0x00  // NACK without reason code (older nodes echo received payload)
+#define SDP_NACK_CRC  0x01  // payload CRC error
+#define SDP_NACK_FRAMING  0x02  // framing error (standalone DLE, COBS delimiter inside of block)
+#define SDP_NACK_OVERSIZE 0x03  // payload size out of range
+#define SDP_NACK_TIMEOUT  0x04  // frame was not completed in rx_msg_timeout
+#define SDP_NACK_SKIPPED  0x05  // link bonding: bonded frame arrived after receiver skipped it - frame is lost, not retransmitted
+
+// protocol options (link negotiation), SDP_link_caps_t.options is bitmask of these values
+#define SDP_OPTION_LINK_ACK (1 << 0)  // each request is acknowledged by receiver parser, before application response
+#define SDP_OPTION_REQUEST_ID (1 << 1)  // each frame carries request ID, responses are matched by ID (multiple requests in flight, full-duplex)
+#define SDP_OPTION_CHANNELS (1 << 2)  // each frame carries logical channel number, messages are passed to channel handler
+#define SDP_OPTION_FEC  (1 << 3)  // each frame carries Reed-Solomon parity bytes, receiver corrects corrupted bytes instead of NACK
+#define SDP_OPTION_CREDITS  (1 << 4)  // each frame carries free rx buffer space (credits), sender doesn't transmit beyond credits of other node
+
+// supported baud rates (link negotiation), SDP_link_caps_t.baudrates is bitmask of these values
+#define SDP_BAUD_9600     (1 << 0)
+#define SDP_BAUD_19200    (1 << 1)
+#define SDP_BAUD_38400    (1 << 2)
+#define SDP_BAUD_57600    (1 << 3)
+#define SDP_BAUD_115200   (1 << 4)
+#define SDP_BAUD_230400   (1 << 5)
+#define SDP_BAUD_460800   (1 << 6)
+#define SDP_BAUD_921600   (1 << 7)
+#define SDP_BAUD_1000000  (1 << 8)
+#define SDP_BAUD_2000000  (1 << 9)
+
+typedef enum{
+  SDP_FRAMING_DLE = 0, // SOF | ACK | PAYLOAD + CRC (escaped with DLE) | EOF -> worst case frame is 2x payload size
+  SDP_FRAMING_COBS,  // DELIMITER | COBS(ACK | PAYLOAD + CRC) | DELIMITER -> 1 overhead byte per 254 bytes
+  SDP_FRAMING_LENGTH  // SOF | ACK | FLAGS | LEN | HCRC | PAYLOAD | CRC -> fixed overhead, payload is not escaped
+} SDP_framing_t;
 
 typedef enum{
   SDP_RX_IDLE = 0, // waiting for start flag
   SDP_RX_ACK, // waiting for ack field
   SDP_RX_RECEIVING,  //receiving data, waiting for end flag
-  SDP_RX_DLE  // end flag or DLE byte received
+  SDP_RX_DLE,  // end flag or DLE byte received
+  SDP_RX_COBS_ACK, // COBS framing: delimiter received, decoding until ack field is received
+  SDP_RX_COBS,  // COBS framing: decoding data, waiting for delimiter
+  SDP_RX_HEADER, // length framing: SOF received, receiving header and header CRC
+  SDP_RX_LENGTH,  // length framing: header valid, receiving exactly LEN payload + CRC bytes
+  SDP_RX_ADDRESS  // addressing mode, DLE framing: SOF received, receiving DST and SRC address
 } SDP_rx_state_t;
 
+// addressing mode: rx filter (sdp_receive_data(), ISR) state
+typedef enum{
+  SDP_FILTER_IDLE = 0, // between frames, drop bytes until start byte
+  SDP_FILTER_START, // start byte received (held), waiting for DST (COBS: code byte, length framing: whole header)
+  SDP_FILTER_COBS_DST,  // COBS framing: code byte received (held), waiting for DST
+  SDP_FILTER_PASS,  // frame is addressed to this node, bytes are put into rx buffer
+  SDP_FILTER_DROP // frame is addressed to other node, bytes are dropped
+} SDP_filter_state_t;
+
+// fast path: rx filter (sdp_receive_data(), ISR) state
+typedef enum{
+  SDP_FAST_IDLE = 0, // between frames (or rest of long frame), bytes are put into rx buffer
+  SDP_FAST_HOLD,  // start byte received, frame bytes are held until end of frame
+  SDP_FAST_SKIP // length and COBS framing: frame is too long for fast path, bytes are put into rx buffer until end of frame
+} SDP_fast_state_t;
+
+typedef enum{
+  SDP_LINK_INIT = 0, // initial settings (sdp_init_node(), sdp_set_framing()), not negotiated
+  SDP_LINK_SWITCHED, // new settings applied, waiting for confirmation frame (or fallback timeout)
+  SDP_LINK_UP // negotiated settings confirmed by both nodes
+} SDP_link_state_t;
+
+typedef enum{
+  SDP_QOS_RELIABLE = 0, // response is awaited, frame is retransmitted on error
+  SDP_QOS_DATAGRAM  // best effort: frame is sent once without waiting for response, dropped on error
+} SDP_qos_t;
+
+// link capabilities - exchanged on sdp_negotiate()
+typedef struct{
+  uint8_t max_payload;  // max payload bytes this node can receive/transmit
+  uint8_t window; // number of frames this node can have in flight
+  uint8_t framings; // bitmask of supported framings: (1 << SDP_framing_t)
+  uint8_t options;  // bitmask of supported protocol options (SDP_OPTION_xxx)
+  uint16_t baudrates; // bitmask of supported SDP_BAUD_xxx values (0 - only initial baud rate)
+} SDP_link_caps_t;
+
+struct SDP_data_s;
+// request ID option: called from sdp_parse_rx_data() when response to sdp_send_request() arrives (status = true) 
+// or request fails (status = false, no payload - response not received after SDP_RETRANSMIT retries)
+typedef void (*SDP_response_callback_t)(struct SDP_data_s *node, uint8_t id, bool status, uint8_t *payload, uint8_t size);
+
+// message handler of logical channel (sdp_set_channel(), node->rx_channel holds channel number) or notification handler
+typedef void (*SDP_message_handler_t)(struct SDP_data_s *node, uint8_t *payload, uint8_t size);
+
+// fast path: handler of latency-critical request, called from RX interrupt (sdp_receive_data()) - payload[0] is opcode.
+// Writes response payload (up to response_size bytes) into response buffer and returns its size, 
+// 0 - request is passed to sdp_parse_rx_data() instead
+typedef uint8_t (*SDP_fast_handler_t)(struct SDP_data_s *node, uint8_t *payload, uint8_t size, uint8_t *response, uint8_t response_size);
+
+// request ID option: request in flight (sdp_send_request())
+typedef struct{
+  bool active;  // slot is in use
+  uint8_t id; // request ID (without SDP_ID_RESPONSE flag)
+  uint8_t ack;  // ACK field value of request frame (SDP_ACK, link bonding: SDP_BOND)
+  uint8_t dst;  // addressing mode: destination address
+  uint8_t channel;  // channels option: logical channel
+  uint8_t retransmit_count;
+  bool acked; // link ACK option: request was acknowledged, waiting for response
+  uint32_t tx_time; // timestamp of last transmission
+  uint32_t credit_mark; // credits option: _tx_credit_used after last transmission
+  uint8_t copies; // redundancy: number of copies of each transmission (0 - redundancy not used)
+  uint32_t hedge_time;  // redundancy: timestamp when duplicate is sent if request is not acknowledged (0 - no duplicate)
+  bool redundant; // redundancy: copy or duplicate was transmitted, RTT sample is ambiguous
+  uint32_t deadline;  // timestamp after which request is not retransmitted (0 - no deadline)
+  uint8_t *payload; // copy of payload for retransmission (rx_tx_max_payload bytes)
+  uint8_t size; // payload size
+  SDP_response_callback_t callback;
+} SDP_request_t;
+
+// channels option: frame waiting in channel TX queue (sdp_queue_request())
+typedef struct{
+  uint8_t dst;  // addressing mode: destination address
+  uint8_t size; // payload size
+  uint8_t *payload; // copy of payload (rx_tx_max_payload bytes, allocated by sdp_set_channel())
+  uint32_t deadline;  // timestamp after which frame is dropped from queue (0 - no deadline)
+  SDP_response_callback_t callback;
+} SDP_queued_frame_t;
+
+// channels option: logical channel
+typedef struct{
+  uint8_t priority; // queued frames of channel with higher priority are transmitted first
+  uint8_t share;  // max number of consecutive frames while other channels are waiting (0 - unlimited)
+  SDP_message_handler_t handler;  // NULL - messages are passed to sdp_user_handle_message()
+  SDP_queued_frame_t queue[SDP_CHANNEL_QUEUE_SIZE];
+  uint8_t head; // index of oldest queued frame
+  uint8_t count;  // number of queued frames
+  uint8_t budget; // frames left until other waiting channels get their turn
+} SDP_channel_t;
+
+// request ID option: response kept for retransmitted request (sdp_set_response_cache())
+typedef struct{
+  bool used; // entry holds request (and its response, if answered)
+  bool answered;  // response was sent, false - message handler did not respond yet (deferred response)
+  uint8_t address;  // addressing mode: source address of request
+  uint8_t id; // request ID
+  uint16_t crc; // CRC of request payload - new request with reused ID (sender restart) is not answered from cache
+  uint8_t size; // response payload size
+  uint8_t *payload; // copy of response payload (rx_tx_max_payload bytes, allocated by sdp_set_response_cache())
+} SDP_cached_response_t;
+
+// addressing mode: group frames received from one sender to one group (sdp_poll_group() of that sender)
+typedef struct{
+  uint8_t group;  // group address
+  uint8_t address;  // source address of group frames
+  uint8_t seq;  // sequence number of newest received frame
+  uint16_t received;  // bit i - frame seq - i was received (0 - entry is unused)
+} SDP_group_rx_t;
+
 // LL UART layer - initialisation must be done with HAL CubeMX or other
 typedef struct{
   // user MUST SET this variables
   USART_TypeDef *handle;  // uart handle -> User must change this type definition if not using STM32 LL UART library
   uint32_t rx_timeout;    // [ms] RX timeout (for receiving 1 byte) - include interrupt times
   uint32_t tx_timeout;    // [ms] TX timeout (for transmiting 1 byte) - include interrupt times
+  // user CAN SET this variable (required only if baud rate is negotiated)
+  uint32_t baudrate;  // [bps] initial baud rate, restored when negotiated link fails
 } SDP_uart_t;
 
-typedef struct{
+typedef struct SDP_data_s{
   // user MUST SET this variables (set with sdp_init_node())
   SDP_uart_t uart;  // communicaton port
-  uint8_t id;       // node ID
+  uint8_t id;       // node ID (addressing mode: address of this node)
   uint8_t rx_tx_max_payload;  // each message/frame can contain max this number of payload bytes
+  SDP_framing_t framing;  // frame encoding, set with sdp_set_framing() (default: SDP_DEFAULT_FRAMING)
+  uint8_t options;  // protocol options (SDP_OPTION_xxx), set with sdp_set_options() or negotiated (default: 0)
   
   // user CAN SET this variables -> inn sdp.h or after init() function call
   uint32_t rx_msg_timeout;    // if EOF does not arrive in this time, message is discarded and set as invalid
   uint32_t tx_msg_timeout;    // if EOF does not arrive in this time, message is discarded and set as invalid
   uint32_t response_timeout;  // receiver must respond in this time 
+  uint32_t ack_timeout; // link ACK option: receiver must acknowledge frame in this time (covers its sdp_parse_rx_data() polling interval), otherwise frame is retransmitted
+  uint32_t rto_min; // [ms] adaptive timeout: lower limit of retransmission timeout, set with sdp_set_adaptive_timeout()
+  uint32_t rto_max; // [ms] adaptive timeout: upper limit (backoff cap) of retransmission timeout, 0 - adaptive timeout disabled
+  uint8_t min_payload;  // adaptive payload: lower limit of tx_payload, set with sdp_set_adaptive_payload(), 0 - adaptive payload disabled
+  uint32_t batch_delay; // [ms] aggregation: batch is sent when oldest posted message waits this time, set with sdp_set_aggregation()
+  uint8_t batch_threshold;  // aggregation: batch is sent when it holds this number of bytes, 0 - aggregation disabled
+  uint8_t tx_address; // addressing mode: destination (DST) address of sdp_send_data() frames
+  uint8_t tx_channel; // channels option: logical channel of sdp_send_data() and sdp_send_request() frames (default: 0)
+  SDP_qos_t tx_qos; // QoS of sdp_send_data() frames (default: SDP_QOS_RELIABLE), can be changed before each call
+  uint8_t tx_copies;  // request ID option: copies of sdp_send_data()/sdp_send_request() frame sent back to back (default: 1), can be changed before each call
+  uint32_t hedge_delay; // [ms] request ID option: duplicate of sdp_send_data()/sdp_send_request() frame is sent if it is not acknowledged in this time (0 - disabled)
+  uint32_t tx_deadline; // [ms] lifetime of sdp_send_data()/sdp_send_request()/sdp_queue_request() message, it is dropped instead of (re)transmitted after that (0 - no deadline), can be changed before each call
+  uint32_t token_hold_time; // token ring: holder keeps token this time before it is passed to next node
+  SDP_message_handler_t notify_handler; // handler of notifications from other node (sdp_send_notification()), NULL - notifications are dropped
+  uint32_t token_timeout; // token ring: bus idle time before lost token is regenerated (+ SDP_TOKEN_SLOT_TIME * position), must be > response_timeout
+  SDP_link_caps_t caps; // capabilities of this node - exchanged with sdp_negotiate() (default: payload_size, all framings)
   // user CAN READ this buffer when data is received (response)
   uint8_t *rx_data; // pointer to received data payload (used as array)
   uint16_t rx_data_index;   // buffer index (also size of received payload)
   uint8_t ack;  // if message is a response to transmited data, ack holds reception status value
+  SDP_link_state_t link_state;  // link negotiation status
+  SDP_link_caps_t link; // negotiated link settings (framings and baudrates hold only selected bit)
+  uint32_t baudrate;  // [bps] current (negotiated) baud rate
+  uint8_t rx_address; // addressing mode: source (SRC) address of last received frame - responses are sent to this node
+  bool token; // token ring: this node holds token and can initiate transmission
+  uint8_t rx_id;  // request ID option: ID byte of last received frame - save it with rx_address for sdp_send_deferred_response()
+  uint8_t rx_channel; // channels option: logical channel of last received frame
+  uint32_t srtt;  // [ms] adaptive timeout: smoothed round trip time (until link ACK or response)
+  uint32_t rttvar;  // [ms] adaptive timeout: round trip time variation
+  uint32_t rto; // [ms] adaptive timeout: current retransmission timeout (0 - no RTT sample yet, fixed timeouts are used)
+  uint8_t nack_reason; // reason code (SDP_NACK_xxx) of last received NACK
+  uint32_t fec_corrected; // FEC option: number of received frames with CRC error that were repaired with parity bytes
+  uint8_t tx_payload; // adaptive payload: current fragment size of sdp_send_fragments() (min_payload .. rx_tx_max_payload)
+  uint32_t rx_crc_errors; // number of received frames with CRC error (not repaired)
+  uint32_t tx_errors;  // number of transmitted frames that were NACK-ed or not answered in time
+  uint32_t tx_dropped;  // number of datagrams that could not be transmitted (token or transmission failure)
+  uint32_t rx_dropped;  // number of received datagrams and group frames that were dropped (CRC error or invalid prefix), skipped bonded frames
+  uint8_t group_seq;  // addressing mode: sequence number of last transmitted group frame, see sdp_poll_group()
+  uint8_t notify_seq; // sequence number of last received notification (other node numbers them from 1 after init)
+  uint32_t notify_lost; // number of notifications of other node that were lost or corrupted (gaps in sequence numbers)
+  uint32_t credit_stalls; // credits option: number of frames that waited for credits of other node
+  uint32_t tx_redundant;  // number of transmitted redundant copies and hedged duplicates (tx_copies, hedge_delay)
+  uint32_t tx_expired;  // number of messages that were dropped because their deadline passed (tx_deadline)
+  uint32_t fast_responses;  // fast path: number of requests answered from RX interrupt (sdp_set_fast_handler())
   
   // private variables
   bool _expect_response; // interval variable to expect response from receiver after transmiting data
+  bool _sending; // blocking sdp_send_data() transmission is in progress (nested blocking calls from message handler fail)
+  uint32_t _handler_time; // time spent in message handler of requests received while waiting for response (not counted into timeouts)
   SDP_rx_state_t _rx_state;  // internal state machine state
   rb_att_t _rx_buff; // uart stores all received characters in this buffer
   uint32_t _rx_start_time; // message SOF timestamp
   uint8_t *_tx_data; // pointer to outgoing framed data (used as array)
   uint16_t _tx_data_size;  // frame payload size
   uint16_t _max_frame_size; // framed payload maximum size
+  uint8_t _rx_buff_count; // number of max sized frames that rx buffer can store
+  uint8_t _cobs_code; // COBS framing: last code byte (rx) or current block code (tx)
+  uint8_t _cobs_remaining;  // COBS framing: number of data bytes until next code byte (rx)
+  uint16_t _cobs_code_index;  // COBS framing: tx_data index of current block code byte (tx)
+  uint8_t _rx_header[SDP_ADDRESS_SIZE + SDP_LENGTH_HEADER_SIZE + SDP_LENGTH_HCRC_SIZE]; // received address (+ length framing header + header CRC)
+  uint8_t _rx_header_index; // number of received _rx_header bytes
+  uint16_t _rx_frame_size;  // length framing: number of payload + CRC bytes that follow valid header
+  uint8_t _rx_flags;  // length framing: FLAGS field of last received header (reserved, 0)
+  uint16_t _alloc_frame_size; // frame size that rx buffer and tx_data are allocated for
+  SDP_framing_t _base_framing;  // initial framing, restored on link fallback
+  uint8_t _base_max_payload;  // initial max payload, restored on link fallback
+  uint8_t _base_options;  // initial protocol options, restored on link fallback
+  bool _link_acked; // link ACK option: sent frame was acknowledged (or link ACK is not used), waiting for response
+  uint32_t _link_ack_time;  // link ACK option: timestamp when sent frame was acknowledged (adaptive timeout RTT sample)
+  uint32_t _nack_time; // timestamp of last NACK sent on framing error (SDP_FAST_NACK_INTERVAL rate limit)
+  uint32_t _link_fallback_time; // link settings were switched, confirmation must arrive before this timestamp
+  uint8_t _address_size;  // addressing mode: SDP_ADDRESS_SIZE, 0 if disabled (point-to-point)
+  uint8_t _tx_dst;  // addressing mode: DST address of frame that is being composed
+  SDP_filter_state_t _filter_state; // addressing mode: rx filter state
+  uint8_t _filter_code; // addressing mode: held COBS code byte
+  uint16_t _filter_count; // addressing mode, length framing: number of bytes until end of current frame
+  uint8_t _filter_header[SDP_ADDRESS_SIZE + SDP_LENGTH_HEADER_SIZE + SDP_LENGTH_HCRC_SIZE]; // addressing mode, length framing: held header
+  uint8_t _filter_header_index; // addressing mode, length framing: number of held header bytes
+  uint8_t *_token_ring; // token ring: addresses of nodes in ring order (NULL - token passing disabled)
+  uint8_t _token_ring_size; // token ring: number of nodes in ring
+  uint8_t _token_position;  // token ring: index of this node in ring
+  uint32_t _token_time; // token ring: timestamp when token was received
+  volatile uint32_t _bus_activity_time; // token ring: timestamp of last frame start on bus (set in ISR)
+  bool _token_wanted; // token ring: sdp_send_data() is waiting for token or transmitting, token must not be passed
+  uint8_t _token_next;  // token ring: ring offset of node that token is being passed to (0 - token is not being passed)
+  uint8_t _token_retry; // token ring: number of TOKEN frames sent to _token_next node
+  uint32_t _token_response_time;  // token ring: timestamp when TOKEN response times out
+  uint8_t _tx_id; // request ID option: ID byte of frame that is being composed
+  uint8_t _tx_channel; // channels option: channel byte of frame that is being composed
+  uint8_t *_tx_payload; // request ID/channels/FEC option: ID and channel byte + payload (+ parity bytes) of frame that is being composed
+  uint8_t _request_id;  // request ID option: ID of blocking sdp_send_data() request
+  uint8_t _request_dst; // request ID option: destination of blocking sdp_send_data() request
+  uint32_t _request_deadline; // deadline of blocking sdp_send_data() request (0 - no deadline)
+  uint8_t _next_id; // request ID option: next free request ID
+  SDP_request_t _requests[SDP_MAX_REQUESTS];  // request ID option: sdp_send_request() requests in flight
+  uint8_t _request_count; // request ID option: number of active _requests
+  SDP_channel_t _channels[SDP_MAX_CHANNELS];  // channels option: logical channels (handlers and TX queues)
+  uint8_t _queued_count;  // channels option: number of frames in all channel TX queues
+  SDP_cached_response_t _cache[SDP_RESPONSE_CACHE_SIZE];  // request ID option: responses of last handled requests
+  uint8_t _cache_size;  // request ID option: number of used _cache entries, 0 - response cache disabled
+  uint8_t _cache_next;  // request ID option: _cache entry that is replaced by next new request
+  uint8_t _payload_growth;  // adaptive payload: tx_payload growth in 1/4 bytes, not applied yet
+  uint8_t *_batch;  // aggregation: posted messages (LEN | MESSAGE ...) waiting for transmission
+  uint8_t _batch_size;  // aggregation: number of _batch bytes
+  uint8_t _batch_dst; // aggregation: destination address of posted messages
+  uint32_t _batch_time; // aggregation: timestamp when first message of batch was posted
+  bool _batch_sending;  // aggregation: batch is being transmitted, _batch can't be changed
+  bool _suppress_response; // aggregation/datagram: received batch or datagram is being passed to handler, responses are not transmitted
+  uint8_t _rx_dst;  // addressing mode: DST address of received frame (own or group address)
+  uint16_t _groups; // addressing mode: group membership, bit = address - SDP_GROUP_ADDRESS (broadcast bit is always set)
+  uint8_t _group_tx_seq[SDP_GROUP_COUNT]; // addressing mode: sequence number of last transmitted frame to each group
+  SDP_group_rx_t _group_rx[SDP_GROUP_SENDERS];  // addressing mode: received group frames of each (group, sender) pair
+  uint8_t _group_rx_next; // addressing mode: _group_rx entry that is replaced by next new (group, sender) pair
+  uint8_t _notify_tx_seq; // sequence number of last transmitted notification
+  uint8_t _notify_rx_seq; // sequence number of newest received notification
+  uint8_t _notify_src;  // addressing mode: node that sent _notify_rx_seq - sequence of other node starts again
+  bool _notify_synced;  // _notify_rx_seq is valid (notification received after init or HELLO of other node)
+  uint8_t _rx_credit; // credits option: credit byte of last received frame
+  uint32_t _tx_credit_used; // credits option: credits used by all frames transmitted to other node (wraps around)
+  uint32_t _tx_credit_limit;  // credits option: frames can be transmitted while _tx_credit_used stays below this limit
+  uint32_t _credit_mark;  // credits option: _tx_credit_used after last transmission of blocking sdp_send_data() request
+  uint8_t _credit_dst;  // credits option, addressing mode: node that credits belong to
+  struct SDP_data_s *_bond; // link bonding: node that owns bond (this node, if it is primary), NULL - not bonded
+  struct SDP_data_s *_bond_links[SDP_BOND_MAX_LINKS]; // link bonding (primary node): physical links, primary node is first
+  uint8_t _bond_count;  // link bonding (primary node): number of _bond_links, 0 - bonding disabled
+  uint8_t _bond_next; // link bonding (primary node): _bond_links index that is tried first for next frame (round robin)
+  uint8_t _bond_tx_seq; // link bonding (primary node): sequence number of next transmitted frame
+  uint8_t *_bond_tx;  // link bonding (primary node): SEQ byte + payload of frame that is being sent
+  uint8_t _bond_rx_seq; // link bonding (primary node): sequence number of next frame passed to message handler
+  uint8_t *_bond_rx[SDP_BOND_WINDOW]; // link bonding (primary node): frames received ahead of missing frame (by SEQ % SDP_BOND_WINDOW)
+  uint8_t _bond_rx_size[SDP_BOND_WINDOW]; // link bonding (primary node): payload size of _bond_rx frames, 0 - not received
+  uint8_t _bond_rx_count; // link bonding (primary node): number of frames waiting in _bond_rx
+  bool _bond_skipped[SDP_BOND_WINDOW]; // link bonding (primary node): last SDP_BOND_WINDOW frames before _bond_rx_seq that were skipped (by SEQ % SDP_BOND_WINDOW)
+  uint32_t _bond_gap_time;  // link bonding (primary node): timestamp when frame was last passed while others wait for missing one
+  volatile bool _tx_busy; // sdp_transmit_data() is transmitting frame, fast path response must not interleave with it
+  uint8_t _fast_count;  // fast path: number of registered handlers, 0 - fast path disabled
+  uint8_t _fast_opcodes[SDP_MAX_FAST_HANDLERS]; // fast path: first payload byte of requests that are handled in RX interrupt
+  SDP_fast_handler_t _fast_handlers[SDP_MAX_FAST_HANDLERS]; // fast path: handlers of _fast_opcodes
+  SDP_fast_state_t _fast_state; // fast path: rx filter state
+  uint8_t _fast_rx[SDP_FAST_FRAME_SIZE];  // fast path: held bytes of received frame
+  uint8_t _fast_rx_size;  // fast path: number of held _fast_rx bytes
+  uint16_t _fast_remaining; // fast path, length framing: number of bytes until end of current frame (0 - LEN not received yet)
+  volatile uint32_t _fast_rx_time;  // fast path: timestamp of last byte of held (or skipped) frame, released after rx_msg_timeout
+  uint8_t _fast_tx[SDP_FAST_FRAME_SIZE];  // fast path: encoded response frame (composed in RX interrupt)
+  volatile bool _fast_tx_busy;  // fast path: _fast_tx is being transmitted (sdp_user_start_transmit() until sdp_transmit_complete())
 } SDP_data_t;
 
 /* Setup ------------------------------------------------------------------*/  
 bool sdp_init_node(SDP_data_t *node, SDP_uart_t *uart_handle, uint8_t id, uint8_t payload_size, uint8_t rx_buff_count);
+bool sdp_set_framing(SDP_data_t *node, SDP_framing_t framing);
+bool sdp_set_addressing(SDP_data_t *node, bool enable);
+void sdp_set_options(SDP_data_t *node, uint8_t options);
+bool sdp_set_token_ring(SDP_data_t *node, uint8_t *ring, uint8_t ring_size);
+void sdp_set_adaptive_timeout(SDP_data_t *node, uint32_t rto_min, uint32_t rto_max);
+bool sdp_set_adaptive_payload(SDP_data_t *node, uint8_t min_payload);
+bool sdp_set_aggregation(SDP_data_t *node, uint32_t delay, uint8_t threshold);
+bool sdp_set_channel(SDP_data_t *node, uint8_t channel, uint8_t priority, uint8_t share, SDP_message_handler_t handler);
+bool sdp_set_response_cache(SDP_data_t *node, uint8_t size);
+bool sdp_set_group(SDP_data_t *node, uint8_t address, bool member);
+bool sdp_set_bond(SDP_data_t *node, SDP_data_t **links, uint8_t count);
+bool sdp_set_fast_handler(SDP_data_t *node, uint8_t opcode, SDP_fast_handler_t handler);
+bool sdp_negotiate(SDP_data_t *node);
 void sdp_parse_rx_data(SDP_data_t *node);
 void sdp_receive_data(SDP_data_t *node); // call this from RXNE ISR
+void sdp_transmit_complete(SDP_data_t *node); // call this from TX ISR (TXE or DMA) when sdp_user_start_transmit() data is sent
 
 /* Update according your HW and application -----------------------------------------------*/
 // Edit sdp_user.c file
 bool sdp_user_receive_byte(SDP_data_t *node, uint8_t *byte);
 bool sdp_user_transmit_byte(SDP_data_t *node, uint8_t byte);
+bool sdp_user_start_transmit(SDP_data_t *node, uint8_t *data, uint16_t size);
 void sdp_user_handle_message(SDP_data_t *node, uint8_t *payload, uint8_t size);
 uint16_t sdp_user_calculate_crc(SDP_data_t *node, uint8_t *payload, uint16_t size);
+bool sdp_user_set_baudrate(SDP_data_t *node, uint32_t baudrate);
 
 /* Transmit & receive data ------------------------------------------------*/
 bool sdp_send_data(SDP_data_t *node, uint8_t *payload, uint8_t payload_size);
+bool sdp_send_fragments(SDP_data_t *node, uint8_t *data, uint16_t size);
+bool sdp_post_message(SDP_data_t *node, uint8_t *payload, uint8_t payload_size);
+bool sdp_flush_messages(SDP_data_t *node);
+bool sdp_poll_group(SDP_data_t *node, uint8_t address, uint8_t group, uint8_t seq, uint16_t *received);
 bool sdp_send_response(SDP_data_t *node, uint8_t *payload, uint8_t payload_size);
 bool sdp_send_dummy_response(SDP_data_t *node);
+bool sdp_send_request(SDP_data_t *node, uint8_t *payload, uint8_t payload_size, SDP_response_callback_t callback, uint8_t *id);
+bool sdp_send_deferred_response(SDP_data_t *node, uint8_t address, uint8_t id, uint8_t *payload, uint8_t payload_size);
+bool sdp_send_notification(SDP_data_t *node, uint8_t *payload, uint8_t payload_size);
+bool sdp_queue_request(SDP_data_t *node, uint8_t channel, uint8_t *payload, uint8_t payload_size, SDP_response_callback_t callback);
+bool sdp_send_bonded(SDP_data_t *node, uint8_t *payload, uint8_t payload_size, SDP_response_callback_t callback);
 
 uint8_t * sdp_get_response(SDP_data_t *node);
 uint16_t sdp_get_rx_data_size(SDP_data_t *node);
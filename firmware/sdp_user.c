@@ -41,6 +41,7 @@ NACK + received payload is returned. If no response is received, this is conside
 #include "error.h"
 
 #include "stm32f0xx_ll_crc.h"
+#include "stm32f0xx_ll_rcc.h"
 
 /**
 * @brief Receive one byte on serial line
@@ -89,6 +90,51 @@ bool sdp_user_transmit_byte(SDP_data_t *node, uint8_t byte){
   return true; // on success return true
 }
 
+static uint8_t *isr_tx_data; // fast path: response transmitted from TXE interrupt (sdp_user_transmit_isr())
+static uint16_t isr_tx_size;  // fast path: number of isr_tx_data bytes that are not transmitted yet
+
+/**
+* @brief Start non-blocking transmission of data (fast path response, called from RX interrupt)
+* @note Data stays valid until sdp_transmit_complete() is called. Bytes are transmitted from TXE interrupt, one at a 
+*       time (see sdp_user_transmit_isr()), so RX interrupt is not blocked. DMA transfer can be used instead.
+* @retval Function should return "true" if transmission is started, "false" otherwise
+*/
+bool sdp_user_start_transmit(SDP_data_t *node, uint8_t *data, uint16_t size){
+  isr_tx_data = data;
+  isr_tx_size = size;
+  LL_USART_EnableIT_TXE(node->uart.handle);
+  
+  return true;
+}
+
+/**
+* @brief Transmit next byte of data started with sdp_user_start_transmit()
+* @note Call this function from USART ISR when TXE flag is set and TXE interrupt is enabled.
+*/
+void sdp_user_transmit_isr(SDP_data_t *node){
+  LL_USART_TransmitData8(node->uart.handle, *isr_tx_data); // TXE flag will be cleared by writing of TDR register
+  isr_tx_data++;
+  isr_tx_size--;
+  if(isr_tx_size == 0){
+    LL_USART_DisableIT_TXE(node->uart.handle);
+    sdp_transmit_complete(node);
+  }
+}
+
+/**
+* @brief Change baud rate of serial line (negotiated with sdp_negotiate()).
+* @note Called after all pending data is transmitted. If node caps.baudrates is 0 (default), this function is never called.
+* @retval Function should return "true" on success, "false" otherwise
+*/
+bool sdp_user_set_baudrate(SDP_data_t *node, uint32_t baudrate){
+  
+  LL_USART_Disable(node->uart.handle);
+  LL_USART_SetBaudRate(node->uart.handle, LL_RCC_GetUSARTClockFreq(LL_RCC_USART1_CLKSOURCE), LL_USART_OVERSAMPLING_16, baudrate);
+  LL_USART_Enable(node->uart.handle);
+  
+  return true;
+}
+
 /**
 * @brief This function is called when message is received and checked with CRC.
 * @note If multiple nodes are used, user should add node id selector to select right message handler
@@ -104,6 +150,8 @@ void sdp_user_handle_message(SDP_data_t *node, uint8_t *payload, uint8_t size){
 
 /**
 * @brief Calculate CRC value of payload data
+* @note Called only from main loop (parser and send functions). Fast path (RX interrupt) uses its own software CRC, 
+*       so CRC peripheral is never reset in the middle of this calculation.
 * @retval Must return crc value
 */
 uint16_t sdp_user_calculate_crc(SDP_data_t *node, uint8_t *payload, uint16_t size){
@@ -164,6 +212,8 @@ void sdp_debug(SDP_data_t *node, uint8_t err){
     40 - sdp_init_node() - rx_buff init error
     41 - sdp_init_node() - rx_data payload malloc() error
     42 - sdp_init_node() - tx_data malloc() error
+    43 - sdp_init_node()/get_free_request() - tx payload or request payload buffer malloc() error
+    44 - sdp_set_channel()/sdp_set_response_cache() - channel TX queue or response cache malloc() error
   
     50 - sdp_parse_rx_data() - invalid rx_state
     
@@ -171,6 +221,10 @@ void sdp_debug(SDP_data_t *node, uint8_t err){
     61 - sdp_send_data() - transmission unsuccessfull
     62 - sdp_send_data() - composed message larger than SDP_MAX_FRAME
     63 - sdp_send_data() - NACK received
+    64 - sdp_send_data() - link ACK timeout, frame retransmitted (link ACK option)
+    65 - sdp_send_fragments() - fragment not acknowledged, following fragments are not sent
+    66 - sdp_set_adaptive_payload() - min_payload larger than max payload
+    67 - sdp_send_data()/send_frame() - blocking transmission while waiting for response (from message handler), not sent
     
     70 - sdp_send_response()-> compose_frame() - composed message larger than SDP_MAX_FRAME
     71 - sdp_send_response()-> sdp_transmit_data() - transmission unsuccessfull
@@ -178,11 +232,29 @@ void sdp_debug(SDP_data_t *node, uint8_t err){
     80 - append_new_data() - payload exceded SDP_MAX_PAYLOAD
     81 - append_new_data() - payload CRC error (CRC values does not match), node->ack updated
     82 - append_new_data() - frame with no payload while not expecting response (maybe send with sdp_send_dummy_response() but timing or other error occured)
+    83 - append_new_data() - SOF received inside of frame, incomplete frame discarded (DLE framing)
+    84 - fec_correct() - payload CRC error, frame repaired with parity bytes (FEC option), node->fec_corrected updated
+    85 - fec_correct() - payload CRC error, too many corrupted bytes to correct (FEC option)
+    86 - receive_parity() - frame too short to hold parity bytes, other node does not use FEC option
     
     90 - check_if_eof() - payload size out of range before EOF
     91 - check_if_eof() - framing error, DLE should never appear on its own in message
+    92 - send_datagram() - datagram could not be transmitted (token or transmission failure), dropped
+    93 - receive_datagram() - datagram CRC error or invalid prefix, dropped
+    94 - send_group_frame() - group frame could not be transmitted (oversized, token or transmission failure), dropped
+    95 - handle_rx_frame() - non-group frame addressed to group, dropped (addressing mode)
+    96 - receive_group_frame() - group frame CRC error, invalid prefix or sequence number, dropped
+    97 - sdp_poll_group() - invalid group, no response or invalid response
+    98 - sdp_set_group() - invalid group address
     
     100 - rx_frame_timeout() - rx frame timeout
+    101 - sdp_send_request() - other node has no rx buffer space for request, retry when response arrives (credits option)
+    102 - wait_for_credit() - credits were not granted in SDP_RETRANSMIT response timeouts (credits option)
+    103 - transmit_copies()/transmit_hedge() - redundant copy of request frame was not transmitted
+    104 - send_frame() - deadline of sdp_send_data() request passed, stale request is not (re)transmitted
+    105 - retry_request() - deadline of sdp_send_request() request passed, stale request is not retransmitted
+    106 - expire_queued() - deadline of queued request passed, request is dropped from channel queue
+    107 - get_copies() - tx_copies/hedge_delay set while response cache is disabled, frame is sent once
   
     110 - compose_frame() - payload size > SDP_MAX_PAYLOAD
     111, 112, 113 - compose_frame() - frame size > SDP_MAX_FRAME_SIZE
@@ -193,7 +265,75 @@ void sdp_debug(SDP_data_t *node, uint8_t err){
     130, 131, 132 - append_crc_bytes() - frame size > SDP_MAX_FRAME_SIZE
     133 - append_crc_bytes() - CRC size != 2
         
+    140 - sdp_set_response_cache() - size > SDP_RESPONSE_CACHE_SIZE (request ID option)
+    141 - replay_response() - retransmitted request answered from response cache, message handler not called (request ID option)
+    142 - clear_cached_responses() - HELLO received, cached response of other node dropped (new link session)
+    143 - receive_bond_frame() - bonded frame arrived after it was skipped, NACK-ed with SDP_NACK_SKIPPED (link bonding)
+    144 - handle_request_response() - bonded frame NACK-ed as skipped by receiver, callback reports loss (link bonding)
+    
     150 - sdp_send_dummy_response()->sdp_transmit_data() - transmission error
+    151 - sdp_set_bond() - too many links, max payload of links differs or reorder buffer allocation error (link bonding)
+    152 - sdp_send_bonded() - node is not bonded or payload size out of range (link bonding)
+    153 - sdp_send_bonded() - bond window full or no link with free request slot (link bonding)
+    154 - receive_bond_frame() - bonded frame received by node that is not bonded or frame without payload, dropped
+    155 - skip_bonded() - missing bonded frame failed on its link, skipped (link bonding)
+    156 - receive_bond_frame()->send_empty_frame() - bonded frame acknowledge transmission failure
+    157 - sdp_set_fast_handler() - SDP_MAX_FAST_HANDLERS handlers are already registered (fast path)
+    158 - fast_handle_frame() - response larger than response_size or doesn't fit SDP_FAST_FRAME_SIZE, request is passed to parser (fast path)
+    159 - fast_handle_frame()->sdp_user_start_transmit() - response transmission not started, request is passed to parser (fast path)
+    
+    160 - sdp_set_framing()/sdp_set_addressing()->resize_frame_buffers() - rx_buff or tx_data re-allocation error
+    161 - cobs_rx_put() - payload size out of range before COBS delimiter
+    162 - append_cobs_data() - COBS framing error, delimiter inside of block or frame without ack
+    163 - compose_cobs_frame() - frame size > SDP_MAX_FRAME_SIZE
+    
+    170 - receive_header() - length framing header CRC error (LEN can't be trusted, frame is discarded)
+    171 - receive_header() - length framing header LEN > rx_tx_max_payload
+    172 - compose_length_frame() - frame size > SDP_MAX_FRAME_SIZE
+    
+    180 - sdp_negotiate() - HELLO frame transmission failure (no response)
+    181 - sdp_negotiate() - invalid HELLO response
+    182 - sdp_negotiate() - SWITCH frame transmission failure
+    183 - sdp_negotiate() - settings rejected by other node
+    184 - sdp_negotiate() - CONFIRM failure with new settings, fall back to initial settings
+    185 - apply_link_settings() - sdp_user_set_baudrate() failure
+    186 - sdp_parse_rx_data() - new settings not confirmed in SDP_LINK_FALLBACK_TIMEOUT, fall back to initial settings
+    187 - handle_control_frame() - invalid control frame
+    188 - handle_control_frame() - SWITCH settings not supported by this node
+    
+    190 - check_rx_address() - frame addressed to other node reached parser (addressing mode)
+    191 - handle_rx_frame() - frame from other node while waiting for response, ignored (addressing mode)
+    192 - filter_length_header() - addressing mode, length framing: header CRC error in rx filter, searching next SOF
+    
+    200 - wait_for_token() - token not received in SDP_TOKEN_WAIT_TIMEOUT, transmission aborted (token ring)
+    201 - token_service() - bus idle for token_timeout, token lost and regenerated (token ring)
+    202 - sdp_handle_message() - other node initiated transmission while this node holds token, duplicated token dropped (token ring)
+    203 - token_service() - node in ring does not respond, skipped (token ring)
+    
+    210 - handle_rx_frame()->send_empty_frame() - link ACK/NACK transmission failure (link ACK option)
+    
+    220 - receive_prefix() - response with unknown ID, ignored - late response to closed request or duplicate (request ID option)
+    221 - sdp_send_request() - request ID option disabled, too many requests in flight or payload too large
+    222 - transmit_request() - request frame composition or transmission failure
+    223 - request_service() - response (or link ACK) timeout, request retransmitted
+    224 - handle_request_response() - NACK received, request retransmitted
+    
+    230 - sdp_set_channel() - channel number out of range (channels option)
+    231 - sdp_queue_request() - invalid channel, request ID option disabled or payload too large
+    232 - sdp_queue_request() - channel TX queue is full or channel is not set up with sdp_set_channel()
+    233 - channel_service() - queued request transmission failure, callback is called with status = false
+    
+    240 - receive_notification() - notification CRC error (or no sequence number), notification dropped
+    241 - receive_notification() - notify_handler is not set, notification dropped
+    242 - sdp_send_notification() - notification oversized, frame composition or transmission failure
+    243 - notify_record() - notification(s) of other node lost (sequence gap), counted in notify_lost
+    
+    250 - send_fast_nack() - NACK transmission failure (framing error, oversized payload or rx frame timeout)
+    251 - handle_rx_frame() - NACK received while not waiting for response, ignored
+    252 - sdp_post_message() - aggregation disabled, invalid message size or batch is being sent
+    253 - sdp_flush_messages() - batch was not acknowledged, posted messages are lost
+    254 - receive_batch() - message length points past end of batch frame, NACK is sent
+    255 - receive_batch() - batch acknowledge transmission failure
     
     */
   #endif
@@ -29,8 +29,44 @@ SDP_DEFAULT_RX_BYTE_TIMEOUT = 0.3
 SDP_DEFAULT_TX_MSG_TIMEOUT = 0.3
 # [s] default timeout while response must be received
 SDP_DEFAULT_RESPONSE_TIMEOUT = 1
-# [s] default wait time before retry with send_data()
+# [s] link ACK option: receiver acknowledges frame in this time (response can follow later)
+SDP_DEFAULT_ACK_TIMEOUT = 0.02
+# [s] default wait time before retry with send_data() (adaptive timeout: smoothed RTT is used)
 SDP_DEFAULT_RETRANSMIT_DELAY = 0.1
+# [s] adaptive timeout: lower limit of retransmission timeout
+SDP_DEFAULT_RTO_MIN = 0.005
+# [s] receiver sends at most one NACK on framing error (or rx frame timeout) in this time
+SDP_FAST_NACK_INTERVAL = 0.01
+# [s] after link settings are switched, confirmation must arrive in this time or node falls back to initial settings
+SDP_LINK_FALLBACK_TIMEOUT = 1
+# [s] initiator waits this time after switch response, so other node can apply new settings
+SDP_LINK_SWITCH_DELAY = 0.005
+# [s] token ring: holder keeps token this time (for send_data() calls) before it is passed
+SDP_DEFAULT_TOKEN_HOLD_TIME = 0.002
+# [s] token ring: bus idle time before lost token is regenerated (must be > response_timeout)
+SDP_DEFAULT_TOKEN_TIMEOUT = SDP_DEFAULT_RESPONSE_TIMEOUT + 0.1
+# [s] token ring: added to token timeout for each position in ring, so only one node regenerates token
+SDP_TOKEN_SLOT_TIME = 0.01
+# [s] token ring: send_data() waits this time for token
+SDP_TOKEN_WAIT_TIMEOUT = 2
+# request ID option: max number of send_request() requests in flight (< 128)
+SDP_MAX_REQUESTS = 4
+# [count] channels option: number of logical channels with own handler and TX queue (0 .. SDP_MAX_CHANNELS-1)
+SDP_MAX_CHANNELS = 4
+# [count] channels option: number of frames each channel TX queue can hold (queue_request())
+SDP_CHANNEL_QUEUE_SIZE = 4
+# [count] request ID option: default number of responses kept for retransmitted requests (set_response_cache())
+SDP_RESPONSE_CACHE_SIZE = 8
+# [count] FEC option: Reed-Solomon parity bytes per frame, up to SDP_FEC_SIZE/2 corrupted bytes are corrected (even number)
+SDP_FEC_SIZE = 4
+# [bytes] credits option: one credit is this number of bytes of free rx buffer space (advertised up to 255 credits)
+SDP_CREDIT_UNIT = 16
+# [s] aggregation: oldest posted message waits at most this time before batch is sent
+SDP_DEFAULT_BATCH_DELAY = 0.005
+# [count] link bonding: max number of links (nodes) in bond, including primary node (set_bond())
+SDP_BOND_MAX_LINKS = 4
+# [count] link bonding: number of frames receiver can reorder, sender never runs further ahead of oldest unacknowledged frame
+SDP_BOND_WINDOW = 16
 
 SDP_CRC_POLYNOME = 0x18005  # 1 is there because of crcmod package. Polynome is 0x8005
 # CRC-16:
@@ -177,6 +213,33 @@ class SDP_serial():
 
         return status
 
+    ########################################################################################
+    def set_baudrate(self, baudrate):
+        """
+        Change baud rate of open serial port (after all pending data is transmitted).
+        Returns True on success, False otherwise
+        """
+        try:
+            self.serial_port.flush()
+            self.serial_port.baudrate = baudrate
+
+            return True
+        except Exception as e:
+            if SDP_DEBUG:
+                print('SDP set_baudrate() fail, error:', e)
+
+            return False
+
+    ########################################################################################
+    def get_rx_buff_bytes(self, num):
+        """
+        Return (and remove) up to num first rx_buff bytes as list. 
+        """
+        data = self.rx_buff[:num]
+        del self.rx_buff[:num]
+
+        return data
+
     ########################################################################################
     def get_rx_buff_byte(self):
         """
@@ -195,12 +258,63 @@ class SDP_serial():
 SDP_ACK = 0x00  # data received OK
 # data received ERROR (checked with CRC) - normally sdp_debug() error is sent back as NACK
 SDP_NACK = 0xaa
+# link ACK option: ACK field values of frames without payload, sent by parser before application response
+SDP_LINK_ACK = 0x3C  # frame received OK, response follows
+SDP_LINK_NACK = 0xA5  # frame CRC error, retransmit
+SDP_NOTIFY = 0x5A  # notification - unsolicited frame, passed to subscribers without response
+SDP_DATAGRAM = 0x96  # datagram - best-effort frame, passed to message handler without response
+SDP_GROUP = 0xE1  # addressing mode: group frame - SEQ byte follows prefix, passed to message handler without response
+# addressing mode: group (multicast) addresses are 0xF0 - 0xFE (node IDs must be lower), broadcast address is 0xFF
+SDP_GROUP_ADDRESS = 0xF0
+SDP_BROADCAST_ADDRESS = 0xFF
+SDP_GROUP_HISTORY = 16  # number of last group frames (per group and sender) that group poll reports
+SDP_BATCH = 0x69  # aggregation: batch frame - payload is LEN | MESSAGE | LEN | MESSAGE ..., response is empty SDP_BATCH frame
+SDP_BOND = 0x1E  # link bonding: SEQ byte follows prefix, passed to message handler of bond in sequence order, response is empty frame
+
+""" QoS of send_data() frames """
+SDP_QOS_RELIABLE = 0  # response is awaited, frame is retransmitted on error
+SDP_QOS_DATAGRAM = 1  # best effort: frame is sent once without waiting for response, dropped on error
+
+""" NACK reason codes - NACK frame payload (after request ID/channel/credit prefix) is one reason byte instead of received payload """
+SDP_NACK_UNKNOWN = 0x00  # NACK without reason code (older nodes echo received payload)
+SDP_NACK_CRC = 0x01  # payload CRC error
+SDP_NACK_FRAMING = 0x02  # framing error (standalone DLE, COBS delimiter inside of block)
+SDP_NACK_OVERSIZE = 0x03  # payload size out of range
+SDP_NACK_TIMEOUT = 0x04  # frame was not completed in rx_frame_timeout
+SDP_NACK_SKIPPED = 0x05  # link bonding: bonded frame arrived after receiver skipped it - frame is lost, not retransmitted
+
+""" Protocol options (link negotiation, set_options()) - bitmask """
+SDP_OPTION_LINK_ACK = 0x01  # each request is acknowledged by receiver parser, before application response
+SDP_OPTION_REQUEST_ID = 0x02  # each frame carries request ID, responses are matched by ID (multiple requests in flight, full-duplex)
+SDP_OPTION_CHANNELS = 0x04  # each frame carries logical channel number, messages are passed to channel handler
+SDP_OPTION_FEC = 0x08  # each frame carries Reed-Solomon parity bytes, receiver corrects corrupted bytes instead of NACK
+SDP_OPTION_CREDITS = 0x10  # each frame carries free rx buffer space (credits), sender doesn't transmit beyond credits of other node
+
+""" Frame encoding (framing) """
+SDP_FRAMING_DLE = 0  # SOF | ACK | PAYLOAD + CRC (escaped with DLE) | EOF -> worst case frame is 2x payload size
+SDP_FRAMING_COBS = 1  # DELIMITER | COBS(ACK | PAYLOAD + CRC) | DELIMITER -> 1 overhead byte per 254 bytes
+SDP_FRAMING_LENGTH = 2  # SOF | ACK | FLAGS | LEN | HCRC | PAYLOAD | CRC -> fixed overhead, payload is not escaped
+
+# ACK field value of link control frames (negotiation) - handled internally, not passed to user
+SDP_CTRL = 0xC3
+# baud rates that can be negotiated (C library SDP_BAUD_xxx bitmask order)
+SDP_BAUDRATES = [9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600, 1000000, 2000000]
+
+""" Link negotiation status """
+SDP_LINK_INIT = 0  # initial settings, not negotiated
+SDP_LINK_SWITCHED = 1  # new settings applied, waiting for confirmation frame (or fallback timeout)
+SDP_LINK_UP = 2  # negotiated settings confirmed by both nodes
 
 """ Private SDP rx state machine states """
 _SDP_RX_IDLE = 0  # waiting for start flag
 _SDP_RX_ACK = 1  # waiting for ack field
 _SDP_RX_RECEIVING = 2  # receiving data, waiting for end flag
 _SDP_RX_DLE = 3  # end flag or DLE byte received
+_SDP_RX_COBS_ACK = 4  # COBS framing: delimiter received, decoding until ack field is received
+_SDP_RX_COBS = 5  # COBS framing: decoding data, waiting for delimiter
+_SDP_RX_HEADER = 6  # length framing: SOF received, receiving header and header CRC
+_SDP_RX_LENGTH = 7  # length framing: header valid, receiving exactly LEN payload + CRC bytes
+_SDP_RX_ADDRESS = 8  # addressing mode, DLE framing: SOF received, receiving DST and SRC address
 """ Special character definitions and lengths """
 _SDP_SOF = 0x7E  # start byte of each frame
 _SDP_EOF = 0x66  # END byte of each frame
@@ -211,22 +325,241 @@ _SDP_SOF_SIZE = 1  # number of SOF bytes
 _SDP_EOF_SIZE = 1  # number of EOF bytes
 _SDP_ACK_SIZE = 1  # number of acknowledgement bytes
 _SDP_CRC_SIZE = 2  # number of CRC bytes
+_SDP_COBS_DELIMITER = 0x00  # COBS framing: start and end byte of each frame, never appears inside encoded frame
+_SDP_COBS_BLOCK_SIZE = 254  # COBS framing: max number of non-zero bytes after each code byte
+_SDP_LENGTH_HEADER_SIZE = 3  # length framing: ACK, FLAGS and LEN header bytes (protected with header CRC)
+_SDP_LENGTH_HCRC_SIZE = 2  # length framing: number of header CRC bytes
+_SDP_FLAGS_NONE = 0x00  # length framing: FLAGS header field value (reserved for protocol extensions)
+_SDP_ADDRESS_SIZE = 2  # addressing mode: DST and SRC address bytes after start byte
+_SDP_REQUEST_ID_SIZE = 1  # request ID option: ID byte is first byte of payload (before user payload, protected with CRC)
+_SDP_ID_RESPONSE = 0x80  # request ID option: ID byte flag - frame is response (or link ACK) to request with this ID
+_SDP_CHANNEL_SIZE = 1  # channels option: channel byte follows request ID (before user payload, protected with CRC)
+_SDP_CREDIT_SIZE = 1  # credits option: credit byte follows channel byte (before user payload, protected with CRC)
+_SDP_MAX_CREDIT = 0xFF  # credits option: python rx buffer is not limited, max credits are advertised
+_SDP_GROUP_SEQ_SIZE = 1  # addressing mode: sequence number byte of group frame (after request ID/channel/credit prefix)
+_SDP_NOTIFY_SEQ_SIZE = 1  # sequence number byte of notification (after request ID/channel/credit prefix)
+_SDP_BATCH_LENGTH_SIZE = 1  # aggregation: length byte before each message in batch frame
+_SDP_BOND_SEQ_SIZE = 1  # link bonding: sequence number byte before payload of bonded frame
+_SDP_FEC_POLYNOME = 0x11D  # FEC option: GF(2^8) primitive polynomial x^8 + x^4 + x^3 + x^2 + 1
+
+# link control frames (ACK field == SDP_CTRL), first payload byte is opcode
+# HELLO | VERSION | MAX_PAYLOAD | WINDOW | FRAMINGS | OPTIONS | BAUDRATES (msb, lsb)
+_SDP_CTRL_HELLO = 0x01
+# SWITCH | FRAMING | MAX_PAYLOAD | WINDOW | OPTIONS | BAUD_INDEX -> response: SWITCH | STATUS
+_SDP_CTRL_SWITCH = 0x02
+_SDP_CTRL_CONFIRM = 0x03  # CONFIRM - sent with new settings
+_SDP_CTRL_TOKEN = 0x04  # TOKEN - token ring: receiver becomes token holder -> response: TOKEN
+_SDP_CTRL_GROUP_POLL = 0x05  # GROUP_POLL | GROUP -> response: GROUP_POLL | GROUP | SEQ | RECEIVED (lsb, msb)
+_SDP_CTRL_HELLO_SIZE = 8
+_SDP_CTRL_SWITCH_SIZE = 6
+_SDP_CTRL_GROUP_POLL_SIZE = 5
+_SDP_LINK_VERSION = 1  # link control frames version
+_SDP_BAUD_KEEP = 0xFF  # SWITCH frame BAUD_INDEX: do not change baud rate
+# negotiation: most efficient framing first
+_SDP_FRAMING_PREFERENCE = [SDP_FRAMING_LENGTH, SDP_FRAMING_COBS, SDP_FRAMING_DLE]
 
 _SDP_MAX_PAYLOAD = 255  # C library limitation, maximum payload bytes (<255)
 
 _SDP_THREAD_STOP_TIMEOUT = 1  # [s] timeout when stopping parser thread
 
 
+class SDP_request():
+    """
+    Request in flight, returned by send_request() (request ID option). When response arrives (or request fails), 
+    callback is called from parser thread and wait() returns.
+    """
+
+    def __init__(self, request_id, dst, payload, callback, channel=0):
+        self.id = request_id  # None while request waits in channel TX queue
+        self.dst = dst  # addressing mode: destination address
+        self.channel = channel  # channels option: logical channel
+        self.payload = payload
+        self.callback = callback  # callback(request) or None
+        self.status = False  # True if response was received
+        self.response = []
+        self.retransmit_count = 0
+        self.acked = False  # link ACK option: request was acknowledged, waiting for response
+        self.tx_time = 0
+        self.credit_mark = 0  # credits option: credits used after last transmission
+        self.copies = 0  # redundancy: number of copies of each transmission (0 - redundancy not used)
+        self.hedge_time = 0  # redundancy: time when duplicate is sent if request is not acknowledged (0 - no duplicate)
+        self.redundant = False  # redundancy: copy or duplicate was transmitted, RTT sample is ambiguous
+        self.deadline = 0  # time after which request is dropped instead of (re)transmitted (0 - no deadline)
+        self.expired = False  # request was dropped because its deadline passed
+        self.ack = SDP_ACK  # ACK field of request frame (SDP_BOND - link bonding frame)
+        self.done = threading.Event()
+
+    def wait(self, timeout=None):
+        """ Wait until request is completed. Returns status and received response (array of bytes). """
+        self.done.wait(timeout)
+
+        return (self.status, self.response)
+
+
+class SDP_channel():
+    """ Logical channel (channels option), set up with set_channel() """
+
+    def __init__(self):
+        self.priority = 0  # queued frames of channel with higher priority are transmitted first
+        self.share = 0  # max number of consecutive frames while other channels are waiting (0 - unlimited)
+        self.handler = None  # handler(node_id, payload), None - messages are passed to user message handler
+        self.queue = []  # SDP_request objects waiting for transmission (queue_request())
+        self.budget = 0  # frames left until other waiting channels get their turn
+
+
+class SDP_cached_response():
+    """ Response kept for retransmitted request (request ID option, set_response_cache()) """
+
+    def __init__(self, address, request_id, crc):
+        self.address = address  # addressing mode: source address of request
+        self.id = request_id
+        self.crc = crc  # CRC of request payload - new request with reused ID (sender restart) is not answered from cache
+        self.response = None  # response payload, None - message handler did not respond yet (deferred response)
+
+
+class SDP_fec():
+    """
+    Reed-Solomon code over GF(2^8) (FEC option), same code as C library: generator roots are a^0 .. a^(nsym-1).
+    nsym parity bytes follow message, up to nsym/2 corrupted bytes are corrected. Message + parity <= 255 bytes.
+    """
+
+    def __init__(self, nsym=SDP_FEC_SIZE):
+        self.nsym = nsym
+        self.__exp = [0] * 512  # exp/log tables, exp is doubled to avoid modulo in multiplication
+        self.__log = [0] * 256
+        x = 1
+        for i in range(255):
+            self.__exp[i] = x
+            self.__log[x] = i
+            x = x << 1
+            if x & 0x100:
+                x = x ^ _SDP_FEC_POLYNOME
+        for i in range(255, 512):
+            self.__exp[i] = self.__exp[i - 255]
+        self.__generator = [1]  # (x + a^0)(x + a^1)...(x + a^(nsym-1)), highest degree first
+        for i in range(nsym):
+            self.__generator = self.__poly_mul(self.__generator, [1, self.__exp[i]])
+
+    ########################################################################################
+    def __mul(self, a, b):
+        if (a == 0) or (b == 0):
+            return 0
+        return self.__exp[self.__log[a] + self.__log[b]]
+
+    ########################################################################################
+    def __div(self, a, b):
+        if a == 0:
+            return 0
+        return self.__exp[(self.__log[a] + 255 - self.__log[b]) % 255]
+
+    ########################################################################################
+    def __poly_mul(self, p, q):
+        r = [0] * (len(p) + len(q) - 1)
+        for j in range(len(q)):
+            for i in range(len(p)):
+                r[i + j] = r[i + j] ^ self.__mul(p[i], q[j])
+        return r
+
+    ########################################################################################
+    def encode(self, message):
+        """ Return nsym parity bytes of message (remainder of message(x) * x^nsym / generator(x)) """
+        parity = [0] * self.nsym
+        for byte in message:
+            feedback = byte ^ parity[0]
+            parity = parity[1:] + [0]
+            if feedback:
+                for j in range(self.nsym):
+                    parity[j] = parity[j] ^ self.__mul(feedback, self.__generator[j + 1])
+        return parity
+
+    ########################################################################################
+    def decode(self, codeword):
+        """
+        Correct codeword (message + parity) in place.
+        Returns number of corrected bytes, -1 if codeword can't be corrected
+        """
+        n = len(codeword)
+        syndromes = []
+        for i in range(self.nsym):
+            s = 0
+            for byte in codeword:
+                s = self.__mul(s, self.__exp[i]) ^ byte
+            syndromes.append(s)
+        if not any(syndromes):
+            return 0
+
+        # Berlekamp-Massey: error locator polynomial, lowest degree first
+        locator = [1] + [0] * self.nsym
+        prev = [1] + [0] * self.nsym
+        errors = 0
+        shift = 1
+        prev_discrepancy = 1
+        for k in range(self.nsym):
+            discrepancy = syndromes[k]
+            for i in range(1, errors + 1):
+                discrepancy = discrepancy ^ self.__mul(locator[i], syndromes[k - i])
+            if discrepancy == 0:
+                shift = shift + 1
+                continue
+            coef = self.__div(discrepancy, prev_discrepancy)
+            temp = list(locator)
+            for i in range(self.nsym + 1 - shift):
+                locator[i + shift] = locator[i + shift] ^ self.__mul(coef, prev[i])
+            if 2 * errors <= k:
+                errors = k + 1 - errors
+                prev = temp
+                prev_discrepancy = discrepancy
+                shift = 1
+            else:
+                shift = shift + 1
+        if 2 * errors > self.nsym:
+            return -1
+
+        # error evaluator: syndromes(x) * locator(x) mod x^nsym
+        evaluator = [0] * self.nsym
+        for i in range(self.nsym):
+            for j in range(i + 1):
+                evaluator[i] = evaluator[i] ^ self.__mul(syndromes[j], locator[i - j])
+
+        # Chien search and Forney algorithm
+        found = 0
+        for index in range(n):
+            power = n - 1 - index  # codeword[index] is coefficient of x^power
+            x_inv = self.__exp[(255 - power) % 255]
+            value = 0
+            for i in range(errors, -1, -1):
+                value = self.__mul(value, x_inv) ^ locator[i]
+            if value != 0:
+                continue
+            numerator = 0
+            for i in range(self.nsym - 1, -1, -1):
+                numerator = self.__mul(numerator, x_inv) ^ evaluator[i]
+            denominator = 0  # formal derivative of locator: only odd terms remain
+            x_inv2 = self.__mul(x_inv, x_inv)
+            term = 1
+            for i in range(1, errors + 1, 2):
+                denominator = denominator ^ self.__mul(locator[i], term)
+                term = self.__mul(term, x_inv2)
+            if denominator == 0:
+                return -1
+            codeword[index] = codeword[index] ^ self.__mul(self.__exp[power], self.__div(numerator, denominator))
+            found = found + 1
+        if found != errors:
+            return -1
+
+        return found
+
+
 class SDP():
     """
     Init SDP  - Simple Data Protocol node. 
     Serial interface must be intitalised before with SDP_serial() class.
     """
 
-    def __init__(self, msg_handler, node_serial, node_id, max_payload):
+    def __init__(self, msg_handler, node_serial, node_id, max_payload, framing=SDP_FRAMING_DLE):
         self.user_message_handler = msg_handler  # user message handler function
         self.s = node_serial  # node's serial port
-        # node ID (relevant for debugging if more than one node is in use)
+        # node ID (relevant for debugging if more than one node is in use, addressing mode: address of this node)
         self.id = node_id
 
         # each message can contain up to this number of bytes (without framing)(MAX = 256 bytes)
@@ -235,21 +568,160 @@ class SDP():
                 'payload size - C library can handle payloads up to 255 bytes')
         # still use parameter max_payload - this library can be used as python <-> python communication
         self.max_payload_size = max_payload
+        self.framing = framing  # frame encoding, both nodes must use the same framing
         self.rx_frame_timeout = SDP_DEFAULT_RX_MSG_TIMEOUT
         self.tx_frame_timeout = SDP_DEFAULT_TX_MSG_TIMEOUT
         self.response_timeout = SDP_DEFAULT_RESPONSE_TIMEOUT
+        self.ack_timeout = SDP_DEFAULT_ACK_TIMEOUT  # link ACK option: frame is retransmitted if not acknowledged in this time
+        self.options = 0  # protocol options (SDP_OPTION_xxx), set with set_options() or negotiated
+        self.tx_qos = SDP_QOS_RELIABLE  # QoS of send_data() frames (SDP_QOS_xxx), overridden by send_data() qos parameter
+        self.tx_copies = 1  # redundancy (request ID option): number of back to back copies of each request frame
+        self.hedge_delay = 0  # redundancy (request ID option): duplicate of unanswered request is sent after this time [s], 0 - disabled
+        self.tx_deadline = 0  # lifetime of message [s], it is dropped instead of (re)transmitted after that (0 - no deadline)
 
         # user can read
         self.ack = SDP_ACK
         self.rx_payload = []
+        self.nack_reason = SDP_NACK_UNKNOWN  # reason code (SDP_NACK_xxx) of last received NACK
+        self.fec_corrected = 0  # FEC option: number of received frames with CRC error that were repaired with parity bytes
+        self.rx_crc_errors = 0  # number of received frames with CRC error (not repaired)
+        self.tx_errors = 0  # number of transmitted frames that were NACK-ed or not answered in time
+        self.tx_dropped = 0  # number of datagrams that could not be transmitted (token or transmission failure)
+        # number of received datagrams and group frames that were dropped (CRC error or invalid prefix), skipped bonded frames
+        self.rx_dropped = 0
+        self.__subscribers = []  # notification callbacks, subscribe()
+        self.notify_seq = 0  # sequence number of last received notification (other node numbers them from 1)
+        self.notify_lost = 0  # number of notifications of other nodes that were lost or corrupted (sequence gaps)
+        self.__notify_tx_seq = 0  # sequence number of last transmitted notification
+        self.__notify_rx = {}  # notifying node address: sequence number of newest received notification
 
         # private variables
         self.__expect_response = False
+        self.__sending = False  # __send_frame() transmission is in progress (request is in flight)
+        self.__handler_time = 0  # time spent in message handler of requests received while waiting for response
+        self.__handler_start = 0  # time when message handler of such request was called (0 - handler is not running)
+        self.__link_acked = True  # link ACK option: sent frame was acknowledged (or link ACK is not used)
+        self.__link_ack_time = 0  # link ACK option: time when sent frame was acknowledged (adaptive timeout RTT sample)
+        self.__nack_time = 0  # time of last NACK sent on framing error (SDP_FAST_NACK_INTERVAL rate limit)
+        self.__response_ack = SDP_ACK  # ack field and payload of last received response
+        self.__response = []
         self.__rx_state = _SDP_RX_IDLE
         self.__rx_start_time = 0
-        # payload worst case = *2 - if every byte of payload is special character, escaped with DLE
-        self.__max_frame_size = (_SDP_SOF_SIZE + _SDP_ACK_SIZE +
-                                 self.max_payload_size * 2 + _SDP_CRC_SIZE * 2 + _SDP_EOF_SIZE)
+        self.__cobs_code = 0  # COBS framing: last received code byte
+        self.__cobs_remaining = 0  # COBS framing: number of data bytes until next code byte
+        self.__rx_header = []  # length framing: received header + header CRC
+        self.__rx_frame_size = 0  # length framing: number of payload + CRC bytes that follow valid header
+        self.rx_flags = _SDP_FLAGS_NONE  # length framing: FLAGS field of last received header
+
+        # adaptive timeout, enable with set_adaptive_timeout()
+        self.rto_min = SDP_DEFAULT_RTO_MIN  # lower limit of retransmission timeout
+        self.rto_max = 0  # upper limit (backoff cap) of retransmission timeout, 0 - adaptive timeout disabled
+        self.srtt = 0  # smoothed round trip time (until link ACK or response)
+        self.rttvar = 0  # round trip time variation
+        self.rto = 0  # current retransmission timeout (0 - no RTT sample yet, fixed timeouts are used)
+
+        # adaptive payload, enable with set_adaptive_payload()
+        self.min_payload = 0  # lower limit of tx_payload, 0 - adaptive payload disabled
+        self.tx_payload = max_payload  # current fragment size of send_fragments() (min_payload .. max_payload_size)
+        self.__payload_growth = 0  # tx_payload growth in 1/4 bytes, not applied yet
+
+        # aggregation, enable with set_aggregation()
+        self.batch_delay = SDP_DEFAULT_BATCH_DELAY  # batch is sent when oldest posted message waits this time
+        self.batch_threshold = 0  # batch is sent when it holds this number of bytes, 0 - aggregation disabled
+        self.__batch = []  # posted messages (LEN | MESSAGE ...) waiting for transmission
+        self.__batch_dst = 0  # destination address of posted messages
+        self.__batch_timer = None  # sends batch after batch_delay (timer thread)
+        self.__batch_lock = threading.RLock()  # batch is posted from user thread, sent from user or timer thread
+        self.__suppress_response = False  # received batch or datagram is being passed to handler, responses are not sent
+
+        # addressing mode (multi-drop bus), enable with set_addressing()
+        self.tx_address = 0  # destination address of send_data() frames
+        self.rx_address = 0  # source address of last received frame - responses are sent to this node
+        self.__address_size = 0
+        self.__tx_dst = 0  # destination address of frame that is being composed
+        self.__tx_lock = threading.RLock()  # frame fields are shared by user thread and parser thread
+
+        # groups (addressing mode), join with set_group()
+        self.group_seq = 0  # sequence number of last transmitted group frame, see poll_group()
+        self.__rx_dst = 0  # DST address of received frame (own or group address)
+        self.__groups = [SDP_BROADCAST_ADDRESS]  # joined group addresses, all nodes receive broadcast frames
+        self.__group_tx_seq = {}  # group address: sequence number of last transmitted frame
+        # (group address, sender address): (sequence number of newest received frame, received bitmap)
+        self.__group_rx = {}
+
+        # credits option, first frame is sent without credits
+        self.credit_stalls = 0  # number of frames that waited for credits of other node
+        self.tx_redundant = 0  # redundancy: number of transmitted copies and duplicates
+        self.tx_expired = 0  # number of messages that were dropped because their deadline passed
+        self.__rx_credit = 0  # credit byte of last received frame
+        self.__tx_credit_used = 0  # credits used by all frames transmitted to other node
+        self.__tx_credit_limit = 0  # frames can be transmitted while __tx_credit_used stays below this limit
+        self.__credit_mark = 0  # __tx_credit_used after last transmission of blocking send_data() request
+        self.__credit_dst = 0  # addressing mode: node that credits belong to
+
+        # link bonding, set up with set_bond()
+        self.__bond = None  # primary node of bond this node is link of (None - not bonded)
+        self.__bond_links = []  # primary node: all links of bond (primary node is first)
+        self.__bond_next = 0  # primary node: index of link that transmits next bonded frame (round robin)
+        self.__bond_tx_seq = 0  # primary node: sequence number of next transmitted bonded frame
+        self.__bond_rx_seq = 0  # primary node: sequence number of next bonded frame passed to message handler
+        self.__bond_rx = {}  # primary node: received bonded frames waiting for missing frame (sequence number: payload)
+        self.__bond_skipped = set()  # primary node: skipped sequence numbers of last SDP_BOND_WINDOW frames
+        self.__bond_gap_time = 0  # primary node: time since waiting frames wait for missing frame
+        self.__bond_lock = threading.RLock()  # primary node: links are parsed by their own parser threads
+
+        # request ID option
+        self.rx_id = 0  # ID byte of last received frame - save it with rx_address for send_deferred_response()
+        self.__tx_id = 0  # ID byte of frame that is being composed
+        self.__request_id = 0  # ID of blocking send_data() request
+        self.__request_dst = 0  # destination of blocking send_data() request
+        self.__request_deadline = 0  # deadline of blocking send_data() request (0 - no deadline)
+        self.__next_id = 0
+        self.__requests = {}  # send_request() requests in flight (by ID)
+
+        # channels option
+        self.tx_channel = 0  # logical channel of send_data() and send_request() frames
+        self.rx_channel = 0  # logical channel of last received frame
+        self.__tx_channel = 0  # channel byte of frame that is being composed
+        self.__channels = [SDP_channel() for _ in range(SDP_MAX_CHANNELS)]
+
+        # response cache (request ID option), enable with set_response_cache()
+        self.__cache = []  # SDP_cached_response objects of last handled requests, oldest first
+        self.__cache_size = 0  # 0 - response cache disabled
+
+        # FEC option
+        self.__fec = SDP_fec(SDP_FEC_SIZE)
+
+        # token ring (multi-master bus arbitration), enable with set_token_ring()
+        self.token = False  # this node holds token and can initiate transmission
+        self.token_hold_time = SDP_DEFAULT_TOKEN_HOLD_TIME
+        self.token_timeout = SDP_DEFAULT_TOKEN_TIMEOUT  # must be > response_timeout
+        self.__token_ring = []
+        self.__token_position = 0  # index of this node in ring
+        self.__token_time = 0  # time when token was received
+        self.__token_wanted = False  # send_data() is waiting for token or transmitting, token must not be passed
+        self.__token_next = 0  # token is being passed to ring member at this offset (0 - not passing)
+        self.__token_retry = 0
+        self.__token_response_time = 0
+        self.__token_lock = threading.Lock()
+        self.__bus_activity_time = 0  # time when data was last received
+
+        # link capabilities (exchanged with negotiate(), set with set_capabilities()) and negotiated settings
+        self.caps_max_payload = max_payload
+        self.caps_window = SDP_MAX_REQUESTS
+        self.caps_framings = [SDP_FRAMING_DLE, SDP_FRAMING_COBS, SDP_FRAMING_LENGTH]
+        self.caps_options = 0
+        self.caps_baudrates = []    # only initial baud rate
+        self.link_state = SDP_LINK_INIT
+        self.link_window = 1
+        self.link_options = 0
+        self.baudrate = None  # current baud rate, known after negotiate()
+        self.__base_framing = framing  # initial settings, restored on link fallback
+        self.__base_max_payload = max_payload
+        self.__base_options = 0
+        self.__base_baudrate = None
+        self.__link_fallback_time = 0
+        self.__max_frame_size = self.__get_max_frame_size()
 
         self.crc16 = crcmod.mkCrcFun(SDP_CRC_POLYNOME, initCrc=0, rev=False)
 
@@ -266,6 +738,315 @@ class SDP():
         """
         self.response_timeout = response_timeout
 
+    ########################################################################################
+    def set_adaptive_timeout(self, rto_max, rto_min=SDP_DEFAULT_RTO_MIN):
+        """
+        Enable/disable adaptive retransmission timeout [in seconds]. Round trip time (until link ACK or response) of 
+        each request that was not retransmitted is measured (Karn's rule), smoothed RTT and RTT variation give 
+        retransmission timeout (Jacobson): rto = srtt + 4 * rttvar, limited to rto_min - rto_max. On each timeout, 
+        rto is doubled (exponential backoff, up to rto_max) until new RTT sample is taken. Until first sample, 
+        fixed response_timeout/ack_timeout are used. rto_max = 0 disables adaptive timeout.
+        Adaptive timeout is used only with request ID option - without it, late response to frame that timed out 
+        can't be told apart from response to retransmitted frame, so short timeout would shift all responses.
+        Without link ACK option, RTT includes other node's message handler time - slow handlers (that sometimes take 
+        more than rto) cause retransmissions, use link ACK option (response_timeout stays fixed) or large rto_min.
+        """
+        self.rto_min = rto_min
+        self.rto_max = rto_max
+        self.__rtt_reset()
+
+    ########################################################################################
+    def set_adaptive_payload(self, min_payload):
+        """
+        Enable/disable adaptive payload: fragment size of send_fragments() (tx_payload) follows observed error rate of 
+        transmitted frames. Each NACK-ed or lost frame shrinks it by 1/4 (down to min_payload), each acknowledged 
+        frame grows it by 1/4 of frame overhead (up to negotiated max_payload_size). Frame error rate settles near 
+        overhead/payload ratio, where goodput is highest: big fragments on clean link, small on noisy.
+        min_payload = 0 disables adaptive payload (fragments are max_payload_size bytes).
+        Returns False if min_payload > max_payload_size.
+        """
+        if min_payload > self.max_payload_size:
+            self.debug('min_payload larger than max payload')
+            return False
+        self.min_payload = min_payload
+        self.tx_payload = self.max_payload_size
+        self.__payload_growth = 0
+
+        return True
+
+    ########################################################################################
+    def set_aggregation(self, delay, threshold):
+        """
+        Enable/disable aggregation: small messages posted with post_message() are packed into one batch frame 
+        (LEN | MESSAGE | LEN | MESSAGE ...), which is acknowledged once - per message framing overhead and round trips 
+        are shared. Batch is sent when it holds threshold bytes, when next message does not fit into frame, or when 
+        oldest message waits delay [s] (from timer thread). Other node passes each message to its message handler 
+        (channels option: handler of batch channel), its responses are not transmitted.
+        threshold is limited to max_payload_size (1 - each message is sent immediately), 0 disables aggregation.
+        """
+        self.flush_messages()
+        self.batch_delay = delay
+        self.batch_threshold = min(threshold, self.max_payload_size)
+
+        return True
+
+    ########################################################################################
+    def set_framing(self, framing):
+        """
+        Change frame encoding (SDP_FRAMING_DLE, SDP_FRAMING_COBS or SDP_FRAMING_LENGTH). 
+        Both nodes must use the same framing.
+        """
+        self.framing = framing
+        self.__base_framing = framing
+        self.__rx_state = _SDP_RX_IDLE
+        self.__max_frame_size = self.__get_max_frame_size()
+
+    ########################################################################################
+    def set_addressing(self, enable):
+        """
+        Enable/disable addressing mode (multi-drop bus, like RS-485). Each frame carries DST and SRC 
+        address after start byte: node id is address of this node, send_data() frames are sent to 
+        tx_address (or address parameter) and responses to source of received frame (rx_address).
+        Frames addressed to other nodes are dropped. All nodes on bus must use addressing mode.
+        """
+        self.__address_size = _SDP_ADDRESS_SIZE if enable else 0
+        self.__rx_state = _SDP_RX_IDLE
+        self.__max_frame_size = self.__get_max_frame_size()
+
+    ########################################################################################
+    def set_options(self, options):
+        """
+        Set protocol options (SDP_OPTION_xxx bitmask). Options can also be negotiated with negotiate() (caps_options).
+        SDP_OPTION_LINK_ACK: parser acknowledges each received request (SDP_LINK_ACK/SDP_LINK_NACK frame without payload) 
+        as soon as CRC is checked, application response follows later. Sender retransmits if link ACK does not arrive 
+        in ack_timeout, so lost frames are detected early while slow message handlers can use long response_timeout.
+        SDP_OPTION_CHANNELS: each frame carries logical channel number (tx_channel), received messages are passed 
+        to channel handler (set_channel()). With request ID option, channel TX queues are scheduled by priority.
+        SDP_OPTION_FEC: each frame carries SDP_FEC_SIZE Reed-Solomon parity bytes, receiver corrects up to 
+        SDP_FEC_SIZE/2 corrupted bytes when CRC check fails, instead of NACK and retransmission (fec_corrected).
+        SDP_OPTION_CREDITS: each frame carries free rx buffer space of sender (in SDP_CREDIT_UNIT bytes). Requests, 
+        datagrams and batches are not transmitted beyond credits that other node granted with its last response, so 
+        fast sender doesn't overrun rx buffer of other node (MCU flushes it on overflow). Without credits (or with 
+        nothing in flight), one frame is sent as probe - its response grants new credits.
+        Both nodes must use the same options.
+        """
+        self.options = options
+        self.__base_options = options
+        self.__tx_credit_limit = self.__tx_credit_used  # credits option: credits of other node are unknown
+
+    ########################################################################################
+    def set_token_ring(self, ring):
+        """
+        Enable token passing bus arbitration (multi-master shared half-duplex bus). Only token holder can 
+        initiate transmission (send_data() waits for token), other nodes only respond. Holder keeps token for 
+        token_hold_time and passes it to next node in ring (nodes that don't respond are skipped). If bus is idle 
+        for token_timeout + SDP_TOKEN_SLOT_TIME * (position in ring), token is considered lost and this node 
+        regenerates it - first node in ring creates initial token.
+        ring: list of addresses of all nodes in ring order, must include this node. Empty list disables token passing.
+        Returns False if addressing mode is disabled or this node is not part of ring, True otherwise
+        """
+        with self.__token_lock:
+            self.__token_ring = []
+            self.token = False
+            if len(ring) == 0:
+                return True
+            if (not self.__address_size) or (self.id not in ring):
+                self.debug('token ring requires addressing mode and this node in ring')
+                return False
+            self.__token_ring = list(ring)
+            self.__token_position = self.__token_ring.index(self.id)
+            self.__token_next = 0
+            self.__bus_activity_time = systime.time()
+
+        return True
+
+    ########################################################################################
+    def set_channel(self, channel, priority=0, share=0, handler=None):
+        """
+        Channels option: set up logical channel. Messages received on this channel are passed to handler(node_id, payload)
+        (None - user message handler, rx_channel holds channel number). Frames queued with queue_request() are 
+        transmitted by priority: whenever request slot is free, oldest frame of waiting channel with highest priority 
+        is sent, so urgent message waits at most one frame behind bulk transfer (last request slot is reserved for 
+        channel with highest priority). Channel with share != 0 can send max share frames in a row while other 
+        channels are waiting, so it can't block lower priority channels.
+        Returns False if channel number is out of range, True otherwise
+        """
+        if not (0 <= channel < SDP_MAX_CHANNELS):
+            self.debug('invalid channel %s' % channel)
+            return False
+
+        with self.__tx_lock:
+            ch = self.__channels[channel]
+            ch.priority = priority
+            ch.share = share
+            ch.budget = share
+            ch.handler = handler
+
+        return True
+
+    ########################################################################################
+    def set_response_cache(self, size=SDP_RESPONSE_CACHE_SIZE):
+        """
+        Request ID option: enable/disable response cache. Last size handled requests (source address, ID and payload 
+        CRC) and their responses are kept, so retransmitted request (response was lost) is answered from cache by 
+        parser - message handler is not called again, so expensive or non-idempotent commands are executed once. 
+        Retransmitted request whose (deferred) response was not sent yet is ignored, response follows.
+        Request IDs of other node start again when it restarts - its cached responses are dropped when it starts link 
+        negotiation (HELLO), so node that restarts must call negotiate() before its first request.
+        Only ACK responses are cached (send_response(), send_deferred_response() and send_dummy_response()).
+        size = 0 disables cache.
+        """
+        with self.__tx_lock:
+            self.__cache = []
+            self.__cache_size = size
+
+    ########################################################################################
+    def set_group(self, address, member=True):
+        """
+        Addressing mode: join or leave group. Frames addressed to group address (or SDP_BROADCAST_ADDRESS, all nodes 
+        are members) are accepted by all its members and passed to message handler without response - sender 
+        transmits frame once for all nodes and can poll members for received frames later (poll_group()).
+        Returns False if address is not group address (SDP_GROUP_ADDRESS - SDP_BROADCAST_ADDRESS-1).
+        """
+        if not (SDP_GROUP_ADDRESS <= address < SDP_BROADCAST_ADDRESS):
+            self.debug('invalid group address')
+            return False
+        if member and (address not in self.__groups):
+            self.__groups.append(address)
+        elif (not member) and (address in self.__groups):
+            self.__groups.remove(address)
+
+        return True
+
+    ########################################################################################
+    def set_bond(self, links):
+        """
+        Link bonding: bond this node with other nodes (links, each with own serial port) into one logical link. 
+        Frames sent with send_bonded() are striped across links (round robin, link with free request slot) and 
+        carry sequence number of bond. Receiver (bonded with the same number of links) acknowledges each frame on 
+        its link and passes payloads to message handler of this node in sequence order, without response.
+        Request ID option must be enabled on all links, parser of each link must run (enable_receiver()).
+        links: list of other SDP nodes (the same max payload), empty list or None disables bonding.
+        Returns True on success, False if there are too many links or their max payload differs.
+        """
+        with self.__bond_lock:
+            if not links:
+                for link in self.__bond_links:
+                    link.__bond = None
+                self.__bond_links = []
+                return True
+            if len(links) >= SDP_BOND_MAX_LINKS:  # primary node is link too
+                self.debug('too many bonded links')
+                return False
+            if any(link.max_payload_size != self.max_payload_size for link in links):
+                self.debug('bonded links must have the same max payload')
+                return False
+
+            self.__bond_links = [self] + list(links)
+            for link in self.__bond_links:
+                link.__bond = self
+            self.__bond_next = 0
+            self.__bond_tx_seq = 0
+            self.__bond_rx_seq = 0
+            self.__bond_rx = {}
+            self.__bond_skipped = set()
+            self.__bond_gap_time = 0
+
+        return True
+
+    ########################################################################################
+    def subscribe(self, callback):
+        """
+        Subscribe callback(node_id, payload) to notifications - unsolicited frames that other node (device) pushes with 
+        sdp_send_notification() when new data is available, instead of being polled. Callbacks are called from 
+        parser thread, notifications are not answered. Notifications carry sequence number (notify_seq): lost or 
+        corrupted ones are counted in notify_lost - poll device state when it increases.
+        """
+        if callback not in self.__subscribers:
+            self.__subscribers.append(callback)
+
+    ########################################################################################
+    def unsubscribe(self, callback):
+        """ Remove notification callback added with subscribe() """
+        if callback in self.__subscribers:
+            self.__subscribers.remove(callback)
+
+    ########################################################################################
+    def set_capabilities(self, max_payload=None, window=None, framings=None, options=None, baudrates=None):
+        """
+        Set link capabilities of this node, exchanged with negotiate(). 
+        framings: list of SDP_FRAMING_xxx, baudrates: list of SDP_BAUDRATES values this port (and wiring) supports.
+        """
+        if max_payload is not None:
+            self.caps_max_payload = max_payload
+        if window is not None:
+            self.caps_window = window
+        if framings is not None:
+            self.caps_framings = framings
+        if options is not None:
+            self.caps_options = options
+        if baudrates is not None:
+            self.caps_baudrates = baudrates
+
+    ########################################################################################
+    def negotiate(self):
+        """
+        Exchange capabilities with other node and switch both nodes to the best common settings
+        (max payload, window, options, framing and baud rate). New settings are confirmed with the 
+        first frame sent with them. If confirmation fails, both nodes fall back to initial settings.
+        Returns True if link is up with negotiated settings, False otherwise
+        """
+        if not self.__wait_for_token():
+            return False
+        status = self.__negotiate_link()
+        self.__token_wanted = False
+
+        return status
+
+    ########################################################################################
+    def __negotiate_link(self):
+        """ Link negotiation sequence: HELLO, SWITCH and CONFIRM (see negotiate()) """
+        if self.link_state == SDP_LINK_INIT:
+            self.__base_baudrate = self.s.serial_port.baudrate
+            self.baudrate = self.__base_baudrate
+
+        (status, response) = self.__send_frame(self.__compose_hello(), SDP_CTRL)
+        if (not status) and (self.link_state != SDP_LINK_INIT):
+            # other node might be reset, retry with initial settings
+            self.__link_fallback()
+            (status, response) = self.__send_frame(self.__compose_hello(), SDP_CTRL)
+        if not status:
+            self.debug('link HELLO failure')
+            return False
+        if (len(response) != _SDP_CTRL_HELLO_SIZE) or (response[0] != _SDP_CTRL_HELLO):
+            self.debug('invalid HELLO response')
+            return False
+
+        settings = self.__select_link_settings(response)
+        (status, response) = self.__send_frame(settings, SDP_CTRL)
+        if not status:
+            self.debug('link SWITCH failure')
+            return False
+        if (len(response) != 2) or (response[0] != _SDP_CTRL_SWITCH) or (response[1] != 0):
+            self.debug('link settings rejected')
+            return False
+
+        # other node applies new settings after its response is transmitted
+        systime.sleep(SDP_LINK_SWITCH_DELAY)
+        if not self.__apply_link_settings(settings):
+            self.__link_fallback()
+            return False
+
+        (status, response) = self.__send_frame([_SDP_CTRL_CONFIRM], SDP_CTRL)
+        if not status:
+            # new settings don't work, other node will fall back after SDP_LINK_FALLBACK_TIMEOUT
+            self.debug('link CONFIRM failure')
+            self.__link_fallback()
+            return False
+        self.link_state = SDP_LINK_UP
+
+        return True
+
     ########################################################################################
     def status(self):
         """
@@ -343,6 +1124,21 @@ class SDP():
             self.disable_receiver()
             return
 
+        if (self.link_state == SDP_LINK_SWITCHED) and (systime.time() > self.__link_fallback_time):
+            self.debug('link settings not confirmed, fall back to initial settings')
+            self.__link_fallback()
+
+        if len(self.s.rx_buff):
+            self.__bus_activity_time = systime.time()  # token ring: bus is not idle
+        if self.__token_ring:
+            self.__token_service()
+        if self.__requests:
+            self.__request_service()
+        if any(ch.queue for ch in self.__channels):
+            self.__channel_service()
+        if (self.__bond is not None) and self.__bond.__bond_rx:
+            self.__bond.__bond_service()
+
         if len(self.s.rx_buff):  # if rx buffer is not empty
             if self.__rx_state == _SDP_RX_IDLE:
                 self.__search_for_sof()
@@ -358,6 +1154,22 @@ class SDP():
                 self.__check_if_eof()
                 self.__rx_frame_timeout()
 
+            elif self.__rx_state in (_SDP_RX_COBS_ACK, _SDP_RX_COBS):
+                self.__append_cobs_data()
+                self.__rx_frame_timeout()
+
+            elif self.__rx_state == _SDP_RX_HEADER:
+                self.__receive_header()
+                self.__rx_frame_timeout()
+
+            elif self.__rx_state == _SDP_RX_LENGTH:
+                self.__receive_length_data()
+                self.__rx_frame_timeout()
+
+            elif self.__rx_state == _SDP_RX_ADDRESS:
+                self.__receive_address()
+                self.__rx_frame_timeout()
+
             else:
                 self.debug(50)
                 self.__rx_state = _SDP_RX_IDLE
@@ -368,10 +1180,29 @@ class SDP():
                 self.__rx_frame_timeout()
 
 ########################################################################################
-    def send_data(self, payload):
+    def send_data(self, payload, address=None, qos=None, deadline=None):
         """
         Transmit data and wait for response. Retry if neccessary.
-        Return status and received response (array of bytes).
+        Addressing mode: frame is sent to address (if given, tx_address is updated) or tx_address.
+        Group address (or SDP_BROADCAST_ADDRESS): frame is sent as group frame - transmitted once without waiting, 
+        accepted by all group members without response. Its sequence number (group_seq) can be polled later with 
+        poll_group(). Max payload of group frame is max_payload_size - 1.
+        qos (default: tx_qos): SDP_QOS_DATAGRAM - frame is transmitted once without waiting for response, other node 
+        passes datagram to message handler and does not respond, corrupted datagram is dropped (counted in 
+        rx_dropped of other node). Use it for streams where fresh data replaces lost one.
+        Credits option: request waits until other node has rx buffer space for it, datagram without credits is sent 
+        as request (waits for response).
+        Request ID option: frame is sent tx_copies times back to back and/or duplicated if it is not answered in 
+        hedge_delay - other node drops duplicates with response cache, first response is taken. Both nodes must enable 
+        response cache (set_response_cache()), otherwise frame is sent once.
+        deadline (default: tx_deadline) [s]: request is not (re)transmitted after this time (stale data), 
+        (False, []) is returned and tx_expired is incremented.
+        Without request ID option link is half-duplex - each frame received while waiting is taken as response, so 
+        only one node may initiate transmission (or use token ring).
+        Request ID option (full-duplex): requests of other node are handled by parser thread while this function 
+        waits for response, time spent in their message handler is not counted into timeouts. Message handler 
+        (parser thread) can't call this function - (False, []) is returned, use send_request() instead.
+        Return status and received response (array of bytes, datagram and group frame: empty).
         """
         if not self.status():  # check if serial port is opened
             self.debug('serial port is not open')
@@ -382,14 +1213,273 @@ class SDP():
             self.debug('invalid payload data')
             return (False, [])
 
+        if address is not None:
+            self.tx_address = address
+
+        if self.__address_size and (self.tx_address >= SDP_GROUP_ADDRESS):
+            return (self.__send_group_frame(payload), [])
+        if ((self.tx_qos if qos is None else qos) == SDP_QOS_DATAGRAM) and \
+                self.__has_credit(self.tx_address, len(payload), False):
+            return (self.__send_datagram(payload), [])
+        # credits option: datagram without credits is sent as request, its response grants new credits
+        if threading.current_thread() is self.parser_thread:
+            # message handler can't wait for response, parser thread would parse it
+            self.debug('blocking transmission from parser thread, use send_request()')
+            return (False, [])
+
+        with self.__batch_lock:  # aggregation: batch is not sent from timer thread meanwhile
+            self.__request_deadline = self.__get_deadline(deadline)  # waiting for token and credits counts too
+            if not self.__wait_for_token():
+                return (False, [])
+            if not self.__wait_for_credit(self.tx_address, len(payload)):
+                self.__token_wanted = False
+                return (False, [])
+            status = self.__send_frame(payload, SDP_ACK)
+            self.__token_wanted = False
+
+        return status
+
+    ########################################################################################
+    def send_fragments(self, data, address=None):
+        """
+        Transmit data larger than one frame: data is split into fragments of tx_payload bytes (adaptive payload, 
+        otherwise max_payload_size) and each fragment is sent with send_data(). Other node must respond to each 
+        fragment, response payload is ignored. Fragment boundaries are not marked - if other node must reassemble 
+        data, put offset into data (application layer). With adaptive payload, fragment that is not acknowledged is 
+        split again with (shrunk) tx_payload and sent again, up to SDP_RETRANSMIT times in a row.
+        Returns False if fragment is not acknowledged (following fragments are not sent).
+        """
+        sent = 0
+        failed = 0
+        while sent < len(data):
+            size = self.tx_payload if self.min_payload else self.max_payload_size
+            size = min(size, self.max_payload_size)
+            (status, _) = self.send_data(list(data[sent:sent + size]), address)
+            if status:
+                sent = sent + size
+                failed = 0
+                continue
+            failed = failed + 1
+            if (not self.min_payload) or (failed >= SDP_RETRANSMIT):
+                self.debug('fragment not acknowledged')
+                return False
+
+        return True
+
+    ########################################################################################
+    def __send_datagram(self, payload):
+        """ Transmit datagram once to tx_address, without waiting for response. Returns True if it was transmitted. """
+        status = self.__wait_for_token()
+        if status:
+            with self.__tx_lock:
+                self.__tx_dst = self.tx_address
+                self.__tx_id = 0  # request ID option: datagram is not a response
+                self.__tx_channel = self.tx_channel
+                (status, frame) = self.__compose_frame(payload, SDP_DATAGRAM)
+            if status:
+                status = self.__transmit_data(frame)
+            self.__token_wanted = False
+        if not status:
+            self.tx_dropped = self.tx_dropped + 1
+            self.debug('datagram dropped')
+
+        return status
+
+    ########################################################################################
+    def __send_group_frame(self, payload):
+        """
+        Transmit group frame once to tx_address (group or broadcast address), without waiting for response. 
+        Group sequence number is incremented and stored in group_seq. Returns True if frame was transmitted.
+        """
+        status = (len(payload) + _SDP_GROUP_SEQ_SIZE) <= self.max_payload_size
+        if status:
+            status = self.__wait_for_token()
+        if status:
+            with self.__tx_lock:
+                self.group_seq = (self.__group_tx_seq.get(self.tx_address, 0) + 1) & 0xFF
+                self.__group_tx_seq[self.tx_address] = self.group_seq
+                self.__tx_dst = self.tx_address
+                self.__tx_id = 0  # request ID option: group frame is not a response
+                self.__tx_channel = self.tx_channel
+                (status, frame) = self.__compose_frame([self.group_seq] + list(payload), SDP_GROUP)
+            if status:
+                status = self.__transmit_data(frame)
+            self.__token_wanted = False
+        if not status:
+            self.tx_dropped = self.tx_dropped + 1
+            self.debug('group frame dropped')
+
+        return status
+
+    ########################################################################################
+    def poll_group(self, address, group, seq):
+        """
+        Addressing mode: ask node (address) which of last SDP_GROUP_HISTORY frames this node sent to group it 
+        received - group frames are not acknowledged, sender collects acknowledges later with one poll per node 
+        (frames of other senders to the same group are not reported). seq is sequence number of group frame 
+        (group_seq after send_data()).
+        Returns status and bitmap - bit i is set if node received group frame with sequence number seq - i.
+        """
+        if (not self.__address_size) or (group < SDP_GROUP_ADDRESS):
+            self.debug('invalid group poll')
+            return (False, 0)
+
+        tx_address = self.tx_address
+        self.tx_address = address
+        with self.__batch_lock:
+            status = self.__wait_for_token()
+            if status:
+                (status, response) = self.__send_frame([_SDP_CTRL_GROUP_POLL, group], SDP_CTRL)
+                self.__token_wanted = False
+        self.tx_address = tx_address
+        if (not status) or (len(response) != _SDP_CTRL_GROUP_POLL_SIZE) or (response[0] != _SDP_CTRL_GROUP_POLL) or \
+                (response[1] != group):
+            self.debug('group poll failure')
+            return (False, 0)
+
+        last_seq = response[2]  # newest group frame that node received
+        bitmap = response[3] | (response[4] << 8)
+        received = 0
+        if ((last_seq - seq) & 0xFF) < SDP_GROUP_HISTORY:  # node received newer frames
+            received = bitmap >> ((last_seq - seq) & 0xFF)
+        elif ((seq - last_seq) & 0xFF) < SDP_GROUP_HISTORY:  # node missed frames after last_seq
+            received = (bitmap << ((seq - last_seq) & 0xFF)) & 0xFFFF
+
+        return (True, received)
+
+    ########################################################################################
+    def post_message(self, payload, address=None):
+        """
+        Aggregation: append message to batch (sent to address - if given, tx_address is updated - or tx_address) and 
+        return. Batch is sent (blocking, like send_data()) when it reaches batch_threshold, when message does not fit 
+        into batch frame or when tx_address changes, otherwise from timer thread after batch_delay or with 
+        flush_messages(). Other node passes message to its message handler, there is no response payload.
+        Called from message handler (parser thread), full batch is sent from timer thread and message that does not 
+        fit is rejected. Batch is retransmitted as a whole - all its messages are lost if it is not acknowledged.
+        Returns False if aggregation is disabled, message is too long or batch transmission failed.
+        """
+        if not self.__check_data(payload):
+            self.debug('invalid payload data')
+            return False
+
+        if (not self.batch_threshold) or (not payload) or \
+                ((len(payload) + _SDP_BATCH_LENGTH_SIZE) > self.max_payload_size):
+            self.debug('aggregation disabled or message can not be posted')
+            return False
+
+        if address is not None:
+            self.tx_address = address
+
+        parser = (threading.current_thread() is self.parser_thread)  # parser thread can't wait for batch response
+        if not self.__batch_lock.acquire(not parser):
+            self.debug('batch is being sent, message can not be posted')
+            return False
+        try:
+            status = True
+            if self.__batch and (((len(self.__batch) + _SDP_BATCH_LENGTH_SIZE + len(payload)) > self.max_payload_size)
+                                 or (self.__batch_dst != self.tx_address)):
+                if parser:
+                    self.debug('batch is full, message can not be posted')
+                    return False
+                status = self.__flush_batch()  # message does not fit into batch frame (or goes to other node)
+            if not self.__batch:
+                self.__batch_dst = self.tx_address
+                self.__start_batch_timer(self.batch_delay)
+            self.__batch.append(len(payload))
+            self.__batch.extend(payload)
+            if len(self.__batch) >= self.batch_threshold:
+                if parser:
+                    self.__start_batch_timer(0)
+                elif not self.__flush_batch():
+                    status = False
+        finally:
+            self.__batch_lock.release()
+
+        return status
+
+    ########################################################################################
+    def flush_messages(self):
+        """
+        Aggregation: transmit posted messages now and wait for acknowledge (with retransmissions, like send_data()). 
+        Batch is cleared even if transmission fails. Must not be called from message handler (parser thread).
+        Returns True if batch is acknowledged (or empty), False otherwise.
+        """
+        with self.__batch_lock:
+            return self.__flush_batch()
+
+    ########################################################################################
+    def __flush_batch(self):
+        """ Transmit batch to its destination, caller holds __batch_lock """
+        if self.__batch_timer is not None:
+            self.__batch_timer.cancel()
+            self.__batch_timer = None
+        if not self.__batch:
+            return True
+
+        payload = self.__batch
+        self.__batch = []
+        tx_address = self.tx_address
+        self.tx_address = self.__batch_dst
+        status = self.__wait_for_token()
+        if status:
+            status = self.__wait_for_credit(self.tx_address, len(payload))
+            if status:
+                (status, _) = self.__send_frame(payload, SDP_BATCH)
+            self.__token_wanted = False
+        self.tx_address = tx_address
+        if not status:
+            self.debug('batch transmission failure')
+
+        return status
+
+    ########################################################################################
+    def __start_batch_timer(self, delay):
+        """ Batch is sent from timer thread after delay [s] """
+        if self.__batch_timer is not None:
+            self.__batch_timer.cancel()
+        self.__batch_timer = threading.Timer(delay, self.flush_messages)
+        self.__batch_timer.daemon = True
+        self.__batch_timer.start()
+
+    ########################################################################################
+    def __send_frame(self, payload, ack):
+        """
+        Transmit frame with given ACK field value and wait for response (with the same ACK field value). 
+        Retry if neccessary. Return status and received response (array of bytes).
+        """
+        if threading.current_thread() is self.parser_thread:
+            # message handler can't wait for response, parser thread would parse it
+            self.debug('blocking transmission from parser thread, use send_request()')
+            return (False, [])
+
         retransmit_count = 0
+        self.__request_id = self.__new_request_id()  # request ID option: retransmitted frames keep the same ID
+        self.__request_dst = self.tx_address
+        self.__sending = True
         while retransmit_count < SDP_RETRANSMIT:
-            (status, frame) = self.__compose_frame(payload)
+            if (ack == SDP_ACK) and self.__is_expired(self.__request_deadline):
+                self.debug('deadline passed, stale request is not transmitted')
+                self.tx_expired = self.tx_expired + 1
+                self.__sending = False
+                return (False, [])
+            with self.__tx_lock:
+                self.__tx_dst = self.tx_address
+                self.__tx_id = self.__request_id
+                self.__tx_channel = self.tx_channel
+                (status, frame) = self.__compose_frame(payload, ack)
             if status:
                 if self.__transmit_data(frame):
 
-                    response_timeout = systime.time() + self.response_timeout
-                    self.__rx_state = _SDP_RX_IDLE
+                    copies = self.__get_copies(ack)
+                    self.__transmit_copies(frame, copies)
+                    self.__credit_mark = self.__tx_credit_used
+                    tx_time = systime.time()
+                    hedge_time = (tx_time + self.hedge_delay) if (copies and self.hedge_delay) else 0
+                    hedged = copies > 1
+                    response_timeout = tx_time + self.__get_timeout(True)
+                    ack_timeout = tx_time + self.__get_timeout(False)
+                    self.__link_acked = not (self.options & SDP_OPTION_LINK_ACK)  # set by parser on SDP_LINK_ACK
+                    self.__handler_time = 0
                     self.__expect_response = True
 
                     while self.__expect_response:
@@ -400,20 +1490,45 @@ class SDP():
                         # https://stackoverflow.com/questions/48198172/python-v2-7-and-v3-6-behave-differently-but-the-same
                         
                         # all incoming data are parsed in parser thread
-                        if systime.time() > response_timeout:  # check for response timeout
+                        now = systime.time() - self.__get_handler_time()  # requests of other node don't count
+                        if hedge_time and (now > hedge_time):
+                            hedge_time = 0
+                            if (not self.__link_acked) or (not (self.options & SDP_OPTION_LINK_ACK)):
+                                # neither link ACK nor response arrived
+                                hedged = self.__transmit_hedge(self.__request_id, self.tx_channel, payload, ack,
+                                                               self.__request_dst) or hedged
+                        if (not self.__link_acked) and (now > ack_timeout):
+                            # frame was not acknowledged, retransmit without waiting for response
+                            self.debug('timeout expecting link ACK')
+                            self.__rto_backoff()
+                            self.__payload_error()
+                            break
+                        if now > response_timeout:  # check for response timeout
                             # response not received in time
                             self.debug('timeout expecting reseponse')
+                            if not (self.options & SDP_OPTION_LINK_ACK):  # with link ACK, response timeout covers message handler
+                                self.__rto_backoff()
+                                self.__payload_error()
                             break
 
                     if not self.__expect_response:  # parser cleared flag - response received
-                        if self.ack == SDP_ACK:
-                            return (True, self.rx_payload)  # success
+                        if self.__response_ack == ack:
+                            if (retransmit_count == 0) and (not hedged) and (not self.__handler_time):
+                                # Karn's rule: RTT of retransmitted, duplicated (or delayed) frame is ambiguous
+                                rx_time = self.__link_ack_time if (self.options & SDP_OPTION_LINK_ACK) else systime.time()
+                                self.__rtt_sample(rx_time - tx_time)
+                            self.__payload_success()
+                            self.__sending = False
+                            return (True, self.__response)  # success
                         else:
                             # response received, but CRC validation failed -> retry
                             self.debug('CRC validation failure')
+                            self.__payload_error()
 
-                            # delay to avoid receiver overrun
-                            systime.sleep(SDP_DEFAULT_RETRANSMIT_DELAY)
+                            if not ((self.__response_ack == SDP_LINK_NACK) or
+                                    ((self.__response_ack == SDP_NACK) and (self.nack_reason != SDP_NACK_UNKNOWN))):
+                                # delay to avoid receiver overrun (compact/link NACK: receiver is ready, retransmit immediately)
+                                systime.sleep(self.__get_retransmit_delay())
 
                     # else:  parser didn't clear expect_response flag, reseponse not received in time
 
@@ -421,16 +1536,25 @@ class SDP():
                     self.debug('transmission failure (take %s)' %
                                (retransmit_count + 1))
                     # retry
-                    systime.sleep(SDP_DEFAULT_RETRANSMIT_DELAY)
+                    systime.sleep(self.__get_retransmit_delay())
 
             else:  # frame composition error
                 self.debug('frame composition')
+                self.__sending = False
                 return (False, [])
 
             retransmit_count = retransmit_count + 1
 
+        self.__sending = False
         return (False, [])  # loop didn't return while executing, error occured
 
+    ########################################################################################
+    def __get_handler_time(self):
+        """ Return time spent in message handler of requests received while waiting for response (including running one) """
+        start = self.__handler_start
+
+        return self.__handler_time + ((systime.time() - start) if start else 0)
+
     ########################################################################################
     def send_response(self, payload):
         """
@@ -446,17 +1570,26 @@ class SDP():
             self.debug('invalid payload data')
             return (False, [])
 
-        if self.ack == SDP_ACK:
-            (status, frame) = self.__compose_frame(payload)
-            if not status:
-                self.debug('frame composition')
-                return False
+        if self.__suppress_response:
+            return True  # aggregation: parser acknowledges whole batch, datagram: no response
+
+        with self.__tx_lock:
+            self.__tx_dst = self.rx_address  # response goes to sender of received frame
+            self.__tx_id = self.rx_id | _SDP_ID_RESPONSE  # request ID option: response carries ID of request
+            self.__tx_channel = self.rx_channel  # channels option: response is sent on channel of request
+            if self.ack != SDP_NACK:  # ACK or control frame response
+                (status, frame) = self.__compose_frame(payload, self.ack)
+                if not status:
+                    self.debug('frame composition')
+                    return False
+                if self.ack == SDP_ACK:
+                    self.__cache_response(self.rx_address, self.rx_id, payload)  # cached even if transmission fails
 
-        else:  # ack = NACK (CRC values does not match)
-            (status, frame) = self.__compose_nack_frame(payload)
-            if not status:
-                self.debug('NACK frame composition')
-                return False
+            else:  # ack = NACK (CRC values does not match)
+                (status, frame) = self.__compose_nack_frame(payload)
+                if not status:
+                    self.debug('NACK frame composition')
+                    return False
 
         # frame composition OK, send data
         if self.__transmit_data(frame):
@@ -475,54 +1608,1193 @@ class SDP():
             self.debug('serial port is not open')
             return False
 
-        frame = []
-        self.ack = SDP_ACK
-        frame.append(_SDP_SOF)
-        frame.append(self.ack)
-        frame.append(_SDP_EOF)
+        if self.__suppress_response:
+            return True  # aggregation: parser acknowledges whole batch, datagram: no response
 
-        if self.__transmit_data(frame):
+        self.ack = SDP_ACK
+        with self.__tx_lock:
+            self.__cache_response(self.rx_address, self.rx_id, [])
+        if self.__send_empty_frame(SDP_ACK):
             return True
         else:  # transmission failed
             self.debug('transmission failure')
             return False
 
     ########################################################################################
-    def __transmit_data(self, frame):
+    def __send_empty_frame(self, ack):
         """
-        Transmit frame array through node's serial port.
-        Returns True on success, False otherwise
+        Compose and transmit frame without payload (and CRC) to sender of received frame: dummy response or link ACK/NACK.
+        Returns True on success, false otherwise
         """
-        status = self.s.serial_write(frame)
-        if not status:
-            self.__thread_stop_flag = True
+        frame = []
+        with self.__tx_lock:
+            self.__tx_dst = self.rx_address  # response goes to sender of received frame
+            if self.__get_prefix_size():  # request ID/channels option: ID and channel are the only payload bytes
+                self.__tx_id = self.rx_id | _SDP_ID_RESPONSE
+                self.__tx_channel = self.rx_channel
+                (status, frame) = self.__compose_frame([], ack)
+                if not status:
+                    return False
+            elif self.framing == SDP_FRAMING_COBS:
+                frame.append(_SDP_COBS_DELIMITER)
+                frame.extend(self.__cobs_encode(self.__get_address() + [ack]))
+                frame.append(_SDP_COBS_DELIMITER)
+            elif self.framing == SDP_FRAMING_LENGTH:
+                (status, frame) = self.__compose_length_frame([], ack)
+            else:
+                frame.append(_SDP_SOF)
+                frame.extend(self.__get_address())
+                frame.append(ack)
+                frame.append(_SDP_EOF)
+
+        return self.__transmit_data(frame)
+
+    ########################################################################################
+    def send_request(self, payload, callback=None, address=None, deadline=None):
+        """
+        Request ID option: transmit request without waiting for response (more requests can be in flight).
+        Response is matched by request ID - responses can arrive in any order. Request is retransmitted on 
+        timeout (ack_timeout/response_timeout) or NACK. When request is completed, callback(request) is called 
+        from parser thread and request.wait() returns (status, response).
+        Addressing mode: request is sent to address (if given, tx_address is updated) or tx_address.
+        Number of requests in flight is limited to SDP_MAX_REQUESTS (or negotiated link window).
+        deadline (default: tx_deadline) [s]: request is not retransmitted after this time, it is completed with 
+        status False and request.expired set.
+        Returns SDP_request object, None if request can't be transmitted
+        """
+        if not self.status():  # check if serial port is opened
+            self.debug('serial port is not open')
+            return None
+
+        if not self.__check_data(payload):
+            self.debug('invalid payload data')
+            return None
+
+        if (not self.__get_id_size()) or (len(self.__requests) >= self.__get_request_window()):
+            self.debug('request ID option disabled or too many requests in flight')
+            return None
+
+        if address is not None:
+            self.tx_address = address
+
+        if not self.__has_credit(self.tx_address, len(payload), True):
+            self.debug('no credits of other node, retry when response arrives')
+            self.credit_stalls = self.credit_stalls + 1
+            return None
+
+        if not self.__wait_for_token():
+            return None
+        with self.__tx_lock:
+            request = SDP_request(None, self.tx_address, list(payload), callback, self.tx_channel)
+            request.copies = self.__get_copies(SDP_ACK)
+            request.hedge_time = (systime.time() + self.hedge_delay) if (request.copies and self.hedge_delay) else 0
+            request.redundant = request.copies > 1
+            request.deadline = self.__get_deadline(deadline)
+            status = self.__open_request(request)
+        self.__token_wanted = False  # token ring: token is not passed until all requests are closed
+
+        if not status:
+            return None
+        return request
+
+    ########################################################################################
+    def send_bonded(self, payload, callback=None, deadline=None):
+        """
+        Link bonding: transmit frame on one of bonded links (set_bond()) without waiting for response, like 
+        send_request(). Frames are striped across links round robin (link without free request slot or credits 
+        is skipped) and carry sequence number of bond - receiver passes them to message handler in sequence order. 
+        Each frame is retransmitted on its link until it is acknowledged, frame that fails on all retries is 
+        skipped by receiver after reorder timeout. Frame that arrives after it was skipped fails (request.status = 
+        False) without retransmission. Payload can be up to max_payload_size - 1 bytes.
+        callback(request) is called from parser thread of link that transmitted frame.
+        Returns SDP_request object, None if node is not bonded or all links are busy (retry later)
+        """
+        if (not self.__bond_links) or (not self.__check_data(payload)) or \
+                ((len(payload) + _SDP_BOND_SEQ_SIZE) > self.max_payload_size):
+            self.debug('node not bonded or invalid payload data')
+            return None
+
+        with self.__bond_lock:
+            if self.__is_bond_window_full():
+                self.debug('bond window full, retry when oldest frame is acknowledged')
+                return None
+
+            for i in range(len(self.__bond_links)):
+                index = (self.__bond_next + i) % len(self.__bond_links)
+                link = self.__bond_links[index]
+                if not link.status():
+                    continue
+                with link.__tx_lock:
+                    if (not link.__get_id_size()) or (len(link.__requests) >= link.__get_request_window()) or \
+                            (not link.__has_credit(link.tx_address, len(payload) + _SDP_BOND_SEQ_SIZE, True)):
+                        continue  # link is busy, try next one
+                    request = SDP_request(None, link.tx_address, [self.__bond_tx_seq] + list(payload), callback,
+                                          link.tx_channel)
+                    request.ack = SDP_BOND
+                    request.deadline = self.__get_deadline(deadline)
+                    if not link.__open_request(request):
+                        continue  # transmission failure, try next link
+                self.__bond_next = (index + 1) % len(self.__bond_links)
+                self.__bond_tx_seq = (self.__bond_tx_seq + 1) & 0xFF
+                return request
+
+        self.debug('all bonded links busy')
+        return None
+
+    ########################################################################################
+    def send_deferred_response(self, address, request_id, payload):
+        """
+        Request ID option: send response to request that was received earlier. Save rx_address and rx_id 
+        in message handler and return without response - requests can so be completed in any order.
+        Returns True on successfull transmission, False otherwise.
+        """
+        if not self.__check_data(payload):
+            self.debug('invalid payload data')
+            return False
+
+        with self.__tx_lock:
+            self.__tx_dst = address
+            self.__tx_id = request_id | _SDP_ID_RESPONSE
+            self.__tx_channel = self.tx_channel
+            (status, frame) = self.__compose_frame(payload, SDP_ACK)
+            if status:
+                self.__cache_response(address, request_id, payload)
+        if not status:
+            self.debug('frame composition')
+            return False
+
+        return self.__transmit_data(frame)
+
+    ########################################################################################
+    def send_notification(self, payload, address=None):
+        """
+        Transmit notification - unsolicited frame that is passed to notification handler (subscribers) of other node 
+        without response. Notification is transmitted once (not acknowledged or retransmitted), its sequence number 
+        lets other node count lost ones.
+        Addressing mode: notification is sent to address (if given, tx_address is updated) or tx_address.
+        Returns True on successfull transmission, False otherwise.
+        """
+        if not self.status():  # check if serial port is opened
+            self.debug('serial port is not open')
+            return False
+
+        if (not self.__check_data(payload)) or ((len(payload) + _SDP_NOTIFY_SEQ_SIZE) > self.max_payload_size):
+            self.debug('invalid payload data')
+            return False
+
+        if address is not None:
+            self.tx_address = address
+
+        if not self.__wait_for_token():
+            return False
+        with self.__tx_lock:
+            self.__notify_tx_seq = (self.__notify_tx_seq + 1) & 0xFF
+            self.__tx_dst = self.tx_address
+            self.__tx_id = 0  # request ID option: notification is not a response
+            self.__tx_channel = self.tx_channel
+            (status, frame) = self.__compose_frame([self.__notify_tx_seq] + list(payload), SDP_NOTIFY)
+        if status:
+            status = self.__transmit_data(frame)
+        self.__token_wanted = False
+        if not status:
+            self.debug('notification transmission failure')
+
+        return status
+
+    ########################################################################################
+    def queue_request(self, channel, payload, callback=None, address=None, deadline=None):
+        """
+        Channels option: put request into TX queue of logical channel (set_channel()) and return. Queued frames 
+        are transmitted as send_request() requests (to address or tx_address) by channel priority, from parser 
+        thread - token ring: only while this node holds token. Request ID option must be enabled.
+        deadline (default: tx_deadline) [s]: frames of the same priority are transmitted earliest deadline first, 
+        frame whose deadline passed is dropped from queue (or not retransmitted), request.expired is set.
+        Returns SDP_request object (request.wait() returns when completed), None if queue is full
+        """
+        if not self.__check_data(payload):
+            self.debug('invalid payload data')
+            return None
+
+        if (not (0 <= channel < SDP_MAX_CHANNELS)) or (not self.__get_id_size()) or \
+                (len(payload) > self.max_payload_size):
+            self.debug('request ID option disabled or request can not be queued')
+            return None
+
+        if address is not None:
+            self.tx_address = address
+
+        with self.__tx_lock:
+            if len(self.__channels[channel].queue) >= SDP_CHANNEL_QUEUE_SIZE:
+                self.debug('channel %s queue is full' % channel)
+                return None
+            request = SDP_request(None, self.tx_address, list(payload), callback, channel)
+            request.deadline = self.__get_deadline(deadline)
+            self.__channels[channel].queue.append(request)
+            self.__channel_service()  # transmit now if request slot is free
+
+        return request
+
+    ########################################################################################
+    def __transmit_data(self, frame):
+        """
+        Transmit frame array through node's serial port. Frames of user thread (requests) and parser thread 
+        (responses) are not interleaved.
+        Returns True on success, False otherwise
+        """
+        with self.__tx_lock:
+            status = self.s.serial_write(frame)
+            if not status:
+                self.__thread_stop_flag = True
+            elif self.__get_credit_size() and ((not self.__address_size) or (self.__tx_dst == self.__credit_dst)):
+                # each frame (also responses) takes rx buffer space of other node
+                self.__tx_credit_used = self.__tx_credit_used + (len(frame) + SDP_CREDIT_UNIT - 1) // SDP_CREDIT_UNIT
+
+        return status
+
+    ########################################################################################
+    def __handle_message(self):
+        """
+        Handle received message or returned response (clears expecting_response flag).
+        This function calls user defined message handler function (parameter of SDP class) 
+        """
+        if self.__is_response():
+            # store response, next frame can be parsed before __send_frame() reads it
+            self.__response_ack = self.ack
+            self.__response = list(self.rx_payload)
+            if self.ack == SDP_NACK:
+                self.nack_reason = self.__get_nack_reason()
+            self.__expect_response = False
+        elif self.__expect_response:  # request ID option: request of other node while waiting for response (full-duplex)
+            self.__handler_start = systime.time()
+            try:
+                self.__handle_request()
+            finally:
+                self.__handler_time = self.__handler_time + (systime.time() - self.__handler_start)
+                self.__handler_start = 0
+        else:
+            self.__handle_request()
+
+    ########################################################################################
+    def __handle_request(self):
+        """ 
+        Received frame is request (or other frame that is not a response): pass it to message handler (or handle it 
+        internally) - called from __handle_message(), also while user thread waits for response in send_data()
+        """
+        if self.token and not ((self.ack == SDP_CTRL) and (self.rx_payload[:1] == [_SDP_CTRL_TOKEN])):
+            # other node initiated transmission while this node holds token - duplicated token, drop it
+            self.debug('duplicated token dropped')
+            self.token = False
+        if self.ack == SDP_ACK:  # if message received correctly, pass it to user
+            if self.__replay_response():
+                return  # retransmitted request, message handler is not called again
+            if self.__get_channel_size() and (self.rx_channel < SDP_MAX_CHANNELS) and \
+                    (self.__channels[self.rx_channel].handler is not None):
+                self.__channels[self.rx_channel].handler(self.id, self.rx_payload)  # channels option: channel handler
+            else:
+                self.user_message_handler(self.id, self.rx_payload)
+        elif self.ack == SDP_CTRL:  # link control frames are handled internally
+            self.__handle_control_frame()
+        elif self.ack == SDP_BATCH:  # aggregation: each message is passed to message handler
+            self.__receive_batch()
+        elif self.ack == SDP_BOND:  # link bonding: payload is passed to message handler of bond in sequence order
+            self.__receive_bond_frame()
+        # message CRC failure, send compact NACK (reason code instead of received payload)
+        else:
+            if not self.send_response([SDP_NACK_CRC]):
+                self.debug('send response failure')
+
+    ########################################################################################
+    def __receive_batch(self):
+        """
+        Batch frame is received: check message lengths, pass each message to message handler (responses are not 
+        sent) and acknowledge whole batch with empty SDP_BATCH frame.
+        """
+        data = self.rx_payload
+        messages = []
+        index = 0
+        while index < len(data):  # LEN field of last message must not point past end of frame
+            size = data[index]
+            if (size == 0) or ((index + _SDP_BATCH_LENGTH_SIZE + size) > len(data)):
+                self.debug('invalid batch frame')
+                self.ack = SDP_NACK
+                if not self.send_response([SDP_NACK_OVERSIZE]):
+                    self.debug('send response failure')
+                return
+            messages.append(data[index + _SDP_BATCH_LENGTH_SIZE:index + _SDP_BATCH_LENGTH_SIZE + size])
+            index = index + _SDP_BATCH_LENGTH_SIZE + size
+
+        handler = self.user_message_handler
+        if self.__get_channel_size() and (self.rx_channel < SDP_MAX_CHANNELS) and \
+                (self.__channels[self.rx_channel].handler is not None):
+            handler = self.__channels[self.rx_channel].handler  # channels option: channel handler
+
+        self.__suppress_response = True
+        self.ack = SDP_ACK  # each message is handled as correctly received frame
+        try:
+            for message in messages:
+                self.rx_payload = message
+                handler(self.id, message)
+        finally:
+            self.__suppress_response = False
+            self.rx_payload = data
+
+        if not self.__send_empty_frame(SDP_BATCH):
+            self.debug('batch acknowledge failure')
+
+    ########################################################################################
+    def __handle_control_frame(self):
+        """ Handle link control frame (HELLO, SWITCH, CONFIRM or TOKEN) from other node and send response """
+        if len(self.rx_payload) == 0:
+            self.debug('invalid control frame')
+            return
+
+        if self.rx_payload[0] == _SDP_CTRL_HELLO:
+            self.__clear_cached_responses(self.rx_address)  # new link session of other node
+            self.__notify_rx.pop(self.rx_address, None)  # notification sequence of other node starts again
+            if self.link_state == SDP_LINK_INIT:
+                self.__base_baudrate = self.s.serial_port.baudrate
+                self.baudrate = self.__base_baudrate
+            self.send_response(self.__compose_hello())
+
+        elif self.rx_payload[0] == _SDP_CTRL_SWITCH:
+            settings = list(self.rx_payload)
+            if (len(settings) != _SDP_CTRL_SWITCH_SIZE) or (not self.__check_link_settings(settings)):
+                self.send_response([_SDP_CTRL_SWITCH, 1])   # settings rejected
+                self.debug('link settings rejected')
+                return
+            # response is sent with current settings
+            if not self.send_response([_SDP_CTRL_SWITCH, 0]):
+                return
+            if not self.__apply_link_settings(settings):
+                self.__link_fallback()
+                return
+            self.link_state = SDP_LINK_SWITCHED
+            self.__link_fallback_time = systime.time() + SDP_LINK_FALLBACK_TIMEOUT
+
+        elif self.rx_payload[0] == _SDP_CTRL_CONFIRM:
+            if self.send_response([_SDP_CTRL_CONFIRM]):
+                self.link_state = SDP_LINK_UP
+
+        elif self.rx_payload[0] == _SDP_CTRL_GROUP_POLL:
+            if (len(self.rx_payload) != 2) or (self.rx_payload[1] < SDP_GROUP_ADDRESS):
+                self.debug('invalid control frame')
+                return
+            # frames that polling node sent to group
+            (last_seq, bitmap) = self.__group_rx.get((self.rx_payload[1], self.rx_address), (0, 0))
+            self.send_response([_SDP_CTRL_GROUP_POLL, self.rx_payload[1], last_seq, bitmap & 0xFF, bitmap >> 8])
+
+        elif self.rx_payload[0] == _SDP_CTRL_TOKEN:
+            if not self.__token_ring:  # token passing is not enabled, no response - sender skips this node
+                self.debug('token ring not enabled')
+                return
+            if self.send_response([_SDP_CTRL_TOKEN]):
+                self.token = True
+                self.__token_time = systime.time()
+
+        else:
+            self.debug('invalid control frame')
+
+    ########################################################################################
+    def __compose_hello(self):
+        """ Compose HELLO control payload from node capabilities """
+        framings = 0
+        for f in self.caps_framings:
+            framings = framings | (1 << f)
+        baudrates = 0
+        for i, b in enumerate(SDP_BAUDRATES):
+            if b in self.caps_baudrates:
+                baudrates = baudrates | (1 << i)
+        max_payload = min(self.caps_max_payload, self.__base_max_payload, _SDP_MAX_PAYLOAD)
+
+        return [_SDP_CTRL_HELLO, _SDP_LINK_VERSION, max_payload, self.caps_window,
+                framings, self.caps_options, baudrates >> 8, baudrates & 0x00FF]
+
+    ########################################################################################
+    def __select_link_settings(self, peer_hello):
+        """
+        Select best common settings of this node capabilities and other node HELLO payload
+        Returns SWITCH payload: SWITCH | FRAMING | MAX_PAYLOAD | WINDOW | OPTIONS | BAUD_INDEX
+        """
+        max_payload = min(self.caps_max_payload, self.__base_max_payload, _SDP_MAX_PAYLOAD, peer_hello[2])
+        window = min(self.caps_window, peer_hello[3])
+        options = self.caps_options & peer_hello[5]
+
+        framing = self.framing  # if there is no better common framing, keep current one
+        for f in _SDP_FRAMING_PREFERENCE:
+            if (f in self.caps_framings) and (peer_hello[4] & (1 << f)):
+                framing = f
+                break
+
+        baud_index = _SDP_BAUD_KEEP
+        peer_baudrates = (peer_hello[6] << 8) | peer_hello[7]
+        for i in reversed(range(len(SDP_BAUDRATES))):  # highest common baud rate
+            if (SDP_BAUDRATES[i] in self.caps_baudrates) and (peer_baudrates & (1 << i)):
+                if SDP_BAUDRATES[i] != self.baudrate:
+                    baud_index = i
+                break
+
+        return [_SDP_CTRL_SWITCH, framing, max_payload, window, options, baud_index]
+
+    ########################################################################################
+    def __check_link_settings(self, settings):
+        """ Check if requested (SWITCH) settings are supported by this node """
+        if settings[1] not in self.caps_framings:
+            return False
+        if settings[2] > min(self.caps_max_payload, self.__base_max_payload):
+            return False
+        if (settings[3] > self.caps_window) or (settings[4] & ~self.caps_options):
+            return False
+        if settings[5] != _SDP_BAUD_KEEP:
+            if (settings[5] >= len(SDP_BAUDRATES)) or (SDP_BAUDRATES[settings[5]] not in self.caps_baudrates):
+                return False
+
+        return True
+
+    ########################################################################################
+    def __apply_link_settings(self, settings):
+        """ Switch node to given (SWITCH payload) settings. Rx buffer is flushed. """
+        if settings[5] != _SDP_BAUD_KEEP:
+            if not self.s.set_baudrate(SDP_BAUDRATES[settings[5]]):
+                self.debug('baud rate change failure')
+                return False
+            self.baudrate = SDP_BAUDRATES[settings[5]]
+
+        self.framing = settings[1]
+        self.max_payload_size = settings[2]
+        self.link_window = settings[3]
+        self.link_options = settings[4]
+        self.options = settings[4]
+        self.__max_frame_size = self.__get_max_frame_size()
+        self.__rx_state = _SDP_RX_IDLE
+        self.s.rx_buff = []  # discard data received with old settings
+        self.__rtt_reset()  # adaptive timeout: new baud rate and framing change round trip time
+        self.tx_payload = self.max_payload_size  # adaptive payload: error rate of new link is not known yet
+
+        return True
+
+    ########################################################################################
+    def __link_fallback(self):
+        """ Restore initial settings (framing, max payload, options, baud rate) """
+        if self.link_state == SDP_LINK_INIT:
+            return
+        if (self.__base_baudrate is not None) and (self.baudrate != self.__base_baudrate):
+            self.s.set_baudrate(self.__base_baudrate)
+            self.baudrate = self.__base_baudrate
+        self.framing = self.__base_framing
+        self.max_payload_size = self.__base_max_payload
+        self.options = self.__base_options
+        self.__max_frame_size = self.__get_max_frame_size()
+        self.link_state = SDP_LINK_INIT
+        self.__rx_state = _SDP_RX_IDLE
+        self.s.rx_buff = []
+        self.__rtt_reset()
+        self.tx_payload = self.max_payload_size
+
+    ########################################################################################
+    def __wait_for_token(self):
+        """
+        If token passing is enabled, wait until this node holds token (received in parser thread). 
+        Token is not passed until caller clears __token_wanted.
+        Returns True if node can initiate transmission, False on SDP_TOKEN_WAIT_TIMEOUT
+        """
+        if not self.__token_ring:
+            return True
+
+        timeout = systime.time() + SDP_TOKEN_WAIT_TIMEOUT
+        self.__token_wanted = True
+        while True:
+            with self.__token_lock:
+                if self.token and (self.__token_next == 0):
+                    return True
+            systime.sleep(0)
+
+            if systime.time() > timeout:
+                self.debug('timeout waiting for token')
+                self.__token_wanted = False
+                return False
+
+    ########################################################################################
+    def __token_service(self):
+        """ 
+        Pass token after token_hold_time or regenerate lost token. Token is passed without blocking 
+        parser thread: TOKEN frame is sent and response is checked on next calls.
+        """
+        now = systime.time()
+        with self.__token_lock:
+            if self.__token_next:  # token is being passed
+                if self.__expect_response:
+                    if now < self.__token_response_time:
+                        return  # wait for TOKEN response
+                    self.__expect_response = False
+                elif (self.__response_ack == SDP_CTRL) and (self.__response == [_SDP_CTRL_TOKEN]):
+                    self.__token_next = 0  # token passed
+                    return
+
+                self.__token_retry = self.__token_retry + 1
+                if self.__token_retry >= SDP_RETRANSMIT:
+                    # node in ring does not respond, skip it
+                    self.debug('node %s not responding, skipped' % self.__get_token_next_address())
+                    self.__token_next = self.__token_next + 1
+                    self.__token_retry = 0
+                    if self.__token_next >= len(self.__token_ring):
+                        # no other node accepted token
+                        self.__token_next = 0
+                        self.token = True
+                        self.__token_time = now
+                        return
+                self.__send_token()
+
+            elif self.token:
+                if (not self.__token_wanted) and (not self.__requests) and (now >= (self.__token_time + self.token_hold_time)):
+                    self.token = False
+                    self.__token_next = 1
+                    self.__token_retry = 0
+                    self.__send_token()
+
+            elif now > (self.__bus_activity_time + self.token_timeout + (SDP_TOKEN_SLOT_TIME * self.__token_position)):
+                # bus is idle, token is lost - regenerate it
+                self.debug('token lost, regenerated')
+                self.token = True
+                self.__token_time = now
+
+    ########################################################################################
+    def __get_token_next_address(self):
+        """ Return address of ring member that token is being passed to """
+        return self.__token_ring[(self.__token_position + self.__token_next) % len(self.__token_ring)]
+
+    ########################################################################################
+    def __send_token(self):
+        """ Transmit TOKEN frame to next ring member, response is checked in __token_service() """
+        with self.__tx_lock:
+            self.__tx_dst = self.__get_token_next_address()
+            self.__request_id = self.__new_request_id()
+            self.__request_dst = self.__tx_dst
+            self.__tx_id = self.__request_id
+            (status, frame) = self.__compose_frame([_SDP_CTRL_TOKEN], SDP_CTRL)
+        self.__response_ack = SDP_ACK
+        self.__token_response_time = systime.time() + self.response_timeout
+        self.__rx_state = _SDP_RX_IDLE
+        self.__expect_response = True
+        if status and (not self.__transmit_data(frame)):
+            self.__expect_response = False
+
+    ########################################################################################
+    def __get_id_size(self):
+        """ Return _SDP_REQUEST_ID_SIZE if request ID option is enabled, 0 otherwise """
+        return _SDP_REQUEST_ID_SIZE if (self.options & SDP_OPTION_REQUEST_ID) else 0
+
+    ########################################################################################
+    def __is_response(self):
+        """ 
+        Return True if received frame is response (to blocking send_data() request), False if it is request.
+        Without request ID option, each frame received while waiting for response is response.
+        """
+        if not self.__get_id_size():
+            return self.__expect_response
+
+        return (self.rx_id & _SDP_ID_RESPONSE) != 0
+
+    ########################################################################################
+    def __receive_prefix(self):
+        """
+        Remove ID, channel and credit byte from received payload (rx_id, rx_channel) and match responses by ID: 
+        response to blocking send_data() request is handled normally, responses to send_request() complete request.
+        Returns True if frame must be handled (request or send_data() response), False otherwise
+        """
+        if len(self.rx_payload) < self.__get_prefix_size():
+            self.debug('frame without request ID/channel')
+            return False
+        if self.__get_id_size():
+            self.rx_id = self.rx_payload.pop(0)
+        if self.__get_channel_size():
+            self.rx_channel = self.rx_payload.pop(0)
+        if self.__get_credit_size():
+            self.__rx_credit = self.rx_payload.pop(0)
+
+        if not self.__get_id_size():  # channels/credits option only: link ACK carries channel and credit byte
+            if self.__expect_response:
+                self.__update_credits(self.__credit_mark)
+            if self.__expect_response and (self.ack == SDP_LINK_ACK):
+                self.__link_acked = True  # frame received by other node, keep waiting for response
+                self.__link_ack_time = systime.time()
+                return False
+            return True
+
+        if not (self.rx_id & _SDP_ID_RESPONSE):
+            return True  # request - handled even while this node is waiting for response
+        request_id = self.rx_id & ~_SDP_ID_RESPONSE
+        if self.__expect_response and (request_id == self.__request_id) and \
+                ((not self.__address_size) or (self.rx_address == self.__request_dst)):
+            self.__update_credits(self.__credit_mark)
+            if self.ack == SDP_LINK_ACK:
+                self.__link_acked = True  # frame received by other node, keep waiting for response
+                self.__link_ack_time = systime.time()
+                return False
+            return True
+
+        with self.__tx_lock:
+            request = self.__requests.get(request_id)
+            if (request is not None) and ((not self.__address_size) or (self.rx_address == request.dst)):
+                self.__update_credits(request.credit_mark)
+                self.__handle_request_response(request)
+            else:
+                # late response to closed request (or duplicate), ignore it
+                self.debug('response with unknown ID %s' % request_id)
+
+        return False
+
+    ########################################################################################
+    def __get_request_window(self):
+        """ Return number of requests that can be in flight: SDP_MAX_REQUESTS or negotiated link window """
+        if self.link_state == SDP_LINK_UP:
+            return min(SDP_MAX_REQUESTS, self.link_window)
+
+        return SDP_MAX_REQUESTS
+
+    ########################################################################################
+    def __open_request(self, request):
+        """ 
+        Assign ID to request, add it to requests in flight and transmit it (called with tx lock held)
+        Returns True on success, False otherwise (request is removed)
+        """
+        request.id = self.__new_request_id()
+        self.__requests[request.id] = request
+        if not self.__transmit_request(request):
+            del self.__requests[request.id]
+            return False
+
+        return True
+
+    ########################################################################################
+    def __new_request_id(self):
+        """ Return next request ID (0 - 127) that is not used by any request in flight """
+        self.__next_id = (self.__next_id + 1) & ~_SDP_ID_RESPONSE
+        while self.__next_id in self.__requests:
+            self.__next_id = (self.__next_id + 1) & ~_SDP_ID_RESPONSE
+
+        return self.__next_id
+
+    ########################################################################################
+    def __handle_request_response(self, request):
+        """ Handle response (or link ACK/NACK) to send_request() request """
+        if self.ack == SDP_LINK_ACK:
+            if (not request.acked) and (request.retransmit_count == 0) and (not request.redundant):
+                self.__rtt_sample(systime.time() - request.tx_time)
+            request.acked = True  # keep waiting for response
+        elif self.ack == SDP_ACK:
+            if (not (self.options & SDP_OPTION_LINK_ACK)) and (request.retransmit_count == 0) and (not request.redundant):
+                self.__rtt_sample(systime.time() - request.tx_time)
+            request.response = list(self.rx_payload)
+            self.__payload_success()
+            self.__close_request(request, True)
+        else:
+            if self.ack == SDP_NACK:
+                self.nack_reason = self.__get_nack_reason()
+                if (request.ack == SDP_BOND) and (self.nack_reason == SDP_NACK_SKIPPED):
+                    # receiver already skipped bonded frame, retransmission would be NACK-ed too
+                    self.debug('bond frame %s was skipped by receiver, lost' % request.payload[0])
+                    self.__close_request(request, False)
+                    return
+            self.debug('NACK received, request %s retransmitted' % request.id)
+            self.__payload_error()
+            self.__retry_request(request)
+
+    ########################################################################################
+    def __transmit_request(self, request):
+        """ 
+        Compose and transmit send_request() request frame (first transmission or retransmission)
+        Returns True on success, False otherwise
+        """
+        self.__tx_dst = request.dst
+        self.__tx_id = request.id
+        self.__tx_channel = request.channel
+        request.acked = not (self.options & SDP_OPTION_LINK_ACK)
+        request.tx_time = systime.time()
+        (status, frame) = self.__compose_frame(request.payload, request.ack)
+        if (not status) or (not self.__transmit_data(frame)):
+            self.debug('request transmission failure')
+            return False
+        self.__transmit_copies(frame, request.copies)
+        request.credit_mark = self.__tx_credit_used
+
+        return True
+
+    ########################################################################################
+    def __retry_request(self, request):
+        """ Retransmit request or close it (status = False) if all SDP_RETRANSMIT transmissions failed """
+        request.retransmit_count = request.retransmit_count + 1
+        if self.__is_expired(request.deadline):
+            self.debug('deadline passed, stale request %s is not retransmitted' % request.id)
+            self.tx_expired = self.tx_expired + 1
+            request.expired = True
+            self.__close_request(request, False)
+            return
+        if (request.retransmit_count >= SDP_RETRANSMIT) or (not self.__transmit_request(request)):
+            self.__close_request(request, False)
+
+    ########################################################################################
+    def __close_request(self, request, status):
+        """ Remove request from requests in flight, call its callback and release wait() """
+        del self.__requests[request.id]
+        request.status = status
+        request.done.set()
+        if request.callback is not None:
+            request.callback(request)
+
+    ########################################################################################
+    def __request_service(self):
+        """ 
+        Retransmit requests that were not acknowledged in ack_timeout (link ACK option) or 
+        answered in response_timeout. Called from parse_rx_data().
+        """
+        now = systime.time()
+        with self.__tx_lock:
+            for request in list(self.__requests.values()):
+                if request.hedge_time and (now > request.hedge_time):
+                    request.hedge_time = 0
+                    if (not request.acked) or (not (self.options & SDP_OPTION_LINK_ACK)):
+                        # neither link ACK nor response arrived
+                        request.redundant = self.__transmit_hedge(request.id, request.channel, request.payload,
+                                                                  request.ack, request.dst) or request.redundant
+                timeout = self.__get_timeout(request.acked)
+                if now > (request.tx_time + timeout):
+                    self.debug('request %s timeout' % request.id)
+                    if (not request.acked) or (not (self.options & SDP_OPTION_LINK_ACK)):
+                        self.__rto_backoff()
+                        self.__payload_error()
+                    self.__retry_request(request)
+
+    ########################################################################################
+    def __get_timeout(self, link_acked):
+        """
+        Return time to wait for first acknowledgement (link ACK, or response if link ACK option is disabled) of 
+        transmitted frame or, if frame was acknowledged with link ACK, time to wait for response.
+        """
+        if (self.options & SDP_OPTION_LINK_ACK) and link_acked:
+            return self.response_timeout  # response follows when message handler is done
+        if self.rto_max and self.rto and self.__get_id_size():
+            return self.rto  # request ID option: late response to retransmitted frame is discarded by ID
+
+        return self.ack_timeout if (self.options & SDP_OPTION_LINK_ACK) else self.response_timeout
+
+    ########################################################################################
+    def __get_retransmit_delay(self):
+        """ Return wait time before retransmission after NACK or transmission failure """
+        if self.rto_max and self.rto and self.__get_id_size():
+            return self.srtt  # adaptive timeout: one round trip time
+
+        return SDP_DEFAULT_RETRANSMIT_DELAY
+
+    ########################################################################################
+    def __rtt_sample(self, rtt):
+        """ Update smoothed RTT and RTT variation with new sample, recalculate retransmission timeout (Jacobson) """
+        if not self.rto_max:
+            return
+        if not self.rto:  # first sample
+            self.srtt = rtt
+            self.rttvar = rtt / 2
+        else:
+            self.rttvar = 0.75 * self.rttvar + 0.25 * abs(self.srtt - rtt)
+            self.srtt = 0.875 * self.srtt + 0.125 * rtt
+        self.rto = min(max(self.srtt + 4 * self.rttvar, self.rto_min), self.rto_max)
+
+    ########################################################################################
+    def __rto_backoff(self):
+        """ Double retransmission timeout after timeout (exponential backoff), up to rto_max """
+        if self.rto_max and self.rto:
+            self.rto = min(self.rto * 2, self.rto_max)
+
+    ########################################################################################
+    def __rtt_reset(self):
+        """ Discard RTT estimation (adaptive timeout is enabled or link settings are changed) """
+        self.srtt = 0
+        self.rttvar = 0
+        self.rto = 0
+
+    ########################################################################################
+    def __get_channel_size(self):
+        """ Return _SDP_CHANNEL_SIZE if channels option is enabled, 0 otherwise """
+        return _SDP_CHANNEL_SIZE if (self.options & SDP_OPTION_CHANNELS) else 0
+
+    ########################################################################################
+    def __get_prefix_size(self):
+        """ Return number of protocol bytes before user payload (request ID, channel and credit byte) """
+        return self.__get_id_size() + self.__get_channel_size() + self.__get_credit_size()
+
+    ########################################################################################
+    def __select_channel(self):
+        """ 
+        Return waiting channel with highest priority that has not used its share, None if all queues are empty.
+        If all waiting channels used their share, channel with highest priority is returned anyway.
+        Channel with earliest deadline wins between channels of equal priority.
+        """
+        waiting = [i for i, ch in enumerate(self.__channels) if ch.queue]
+        if not waiting:
+            return None
+        # max() returns first channel (lowest number) of equal priority and deadline
+        eligible = [i for i in waiting if (self.__channels[i].share == 0) or self.__channels[i].budget]
+        if not eligible:
+            eligible = waiting  # all waiting channels used their share
+
+        return max(eligible, key=lambda i: (self.__channels[i].priority,
+                                            -self.__deadline_key(self.__earliest_queued(self.__channels[i]))))
+
+    ########################################################################################
+    def __channel_service(self):
+        """ 
+        Transmit queued frames by channel priority while request slots are free. Last free slot is reserved for 
+        channel with highest priority. Called from parse_rx_data() and queue_request().
+        """
+        if self.__token_ring and not self.token:
+            return  # token ring: queued frames wait for token
+
+        top_priority = max(ch.priority for ch in self.__channels)
+        window = self.__get_request_window()
+        with self.__tx_lock:
+            self.__expire_queued()
+            while True:
+                selected = self.__select_channel()
+                if (selected is None) or (not self.__get_id_size()) or (len(self.__requests) >= window):
+                    return  # nothing to send or window is full, retry when response arrives
+                ch = self.__channels[selected]
+                if (ch.priority < top_priority) and (window > 1) and ((len(self.__requests) + 1) >= window):
+                    return  # last request slot is reserved for urgent messages
+                # earliest deadline first, frames without deadline keep FIFO order
+                ch.queue.insert(0, ch.queue.pop(ch.queue.index(self.__earliest_queued(ch))))
+                if not self.__has_credit(ch.queue[0].dst, len(ch.queue[0].payload), True):
+                    return  # credits option: other node has no rx buffer space, retry when response arrives
+
+                for i, other in enumerate(self.__channels):  # other channels get their full share after this frame
+                    if i != selected:
+                        other.budget = other.share
+                if ch.budget:
+                    ch.budget = ch.budget - 1
+                request = ch.queue.pop(0)
+                if not self.__open_request(request):
+                    self.debug('queued request transmission failure')
+                    request.done.set()
+                    if request.callback is not None:
+                        request.callback(request)
+
+    ########################################################################################
+    def __get_copies(self, ack):
+        """ 
+        Return number of copies of each transmission of frame with given ACK field value: tx_copies (at least 1) for 
+        requests with request ID option - other node drops duplicates by ID, 0 if redundancy can't be used (also 
+        while response cache of this node is disabled - nodes that use redundancy must both enable it).
+        """
+        if (ack != SDP_ACK) or (not self.__get_id_size()):
+            return 0  # without request ID, response to copy would be taken as response to next request
+        if not self.__cache_size:
+            # duplicates are dropped only by response cache - each copy would call (possibly non-idempotent) handler
+            if (self.tx_copies > 1) or self.hedge_delay:
+                self.debug('redundancy refused: response cache disabled (set_response_cache()), frame sent once')
+            return 0
+
+        return max(self.tx_copies, 1)
+
+    ########################################################################################
+    def __transmit_copies(self, frame, copies):
+        """ Transmit already composed frame again, so copies are sent back to back """
+        for _ in range(1, copies):
+            if not self.__transmit_data(frame):
+                self.debug('redundant copy transmission failure')
+                return
+            self.tx_redundant = self.tx_redundant + 1
+
+    ########################################################################################
+    def __transmit_hedge(self, request_id, channel, payload, ack, dst):
+        """ 
+        Compose and transmit duplicate of request that was not acknowledged in hedge_delay. Retransmission timeout 
+        still runs from original transmission. Returns True if duplicate was transmitted, False otherwise
+        """
+        with self.__tx_lock:
+            self.__tx_dst = dst
+            self.__tx_id = request_id
+            self.__tx_channel = channel
+            (status, frame) = self.__compose_frame(payload, ack)
+            if (not status) or (not self.__transmit_data(frame)):
+                self.debug('redundant copy transmission failure')
+                return False
+        self.tx_redundant = self.tx_redundant + 1
+
+        return True
+
+    ########################################################################################
+    def __get_deadline(self, deadline):
+        """ Return deadline time of message that is sent now (deadline or tx_deadline [s]), 0 - no deadline """
+        lifetime = self.tx_deadline if deadline is None else deadline
+
+        return (systime.time() + lifetime) if lifetime else 0
+
+    ########################################################################################
+    def __is_expired(self, deadline):
+        """ Return True if given deadline time passed (message is stale), False if there is no deadline (0) """
+        return bool(deadline) and (systime.time() > deadline)
+
+    ########################################################################################
+    def __deadline_key(self, request):
+        """ Return sort key of request deadline (no deadline is later than any deadline) """
+        return request.deadline if request.deadline else float('inf')
+
+    ########################################################################################
+    def __earliest_queued(self, ch):
+        """ Return queued request of channel with earliest deadline, oldest request if deadlines are equal """
+        return min(ch.queue, key=self.__deadline_key)  # min() returns first of equal keys
+
+    ########################################################################################
+    def __expire_queued(self):
+        """ Drop queued requests whose deadline passed, they are completed with status False and expired set """
+        for ch in self.__channels:
+            for request in [r for r in ch.queue if self.__is_expired(r.deadline)]:
+                if request not in ch.queue:
+                    continue  # already dropped by callback of other request
+                ch.queue.remove(request)  # removed before callback, so callback can queue new request
+                self.debug('deadline passed, stale queued request dropped')
+                self.tx_expired = self.tx_expired + 1
+                request.expired = True
+                request.done.set()
+                if request.callback is not None:
+                    request.callback(request)
+
+    ########################################################################################
+    def __receive_bond_frame(self):
+        """
+        Bonded frame is received (and acknowledged on link that received it): store it in reorder buffer of bond 
+        and pass frames to message handler of bond in sequence order. Duplicates (retransmitted frame whose 
+        response was lost) are acknowledged again, but not passed to message handler. Sender never transmits 
+        frame SDP_BOND_WINDOW frames ahead of its oldest unacknowledged frame, so missing frames that far behind 
+        received frame failed on their links and are skipped. Skipped frame that arrives late is NACK-ed with 
+        SDP_NACK_SKIPPED, so sender reports it as lost instead of delivered.
+        """
+        bond = self.__bond
+        if (bond is None) or (len(self.rx_payload) <= _SDP_BOND_SEQ_SIZE):
+            self.debug('invalid bond frame')
+            return
+
+        seq = self.rx_payload[0]
+        with bond.__bond_lock:
+            while SDP_BOND_WINDOW <= ((seq - bond.__bond_rx_seq) & 0xFF) < 0x80:
+                bond.__skip_bonded()
+            offset = (seq - bond.__bond_rx_seq) & 0xFF
+            if (offset >= (0x100 - SDP_BOND_WINDOW)) and (seq in bond.__bond_skipped):
+                # frame was skipped (sender retried it longer than this node waited), it is lost
+                self.debug('skipped bond frame %s arrived, NACK-ed' % seq)
+                self.ack = SDP_NACK
+                if not self.send_response([SDP_NACK_SKIPPED]):
+                    self.debug('bond frame acknowledge failure')
+                return
+
+            self.ack = SDP_ACK
+            if not self.__send_empty_frame(SDP_ACK):
+                self.debug('bond frame acknowledge failure')
+            if offset >= 0x80:
+                return  # older than next expected frame - already passed to message handler
+
+            if seq not in bond.__bond_rx:
+                bond.__bond_rx[seq] = list(self.rx_payload[_SDP_BOND_SEQ_SIZE:])
+                if not bond.__bond_gap_time:
+                    bond.__bond_gap_time = systime.time()
+            bond.__deliver_bonded()
+
+    ########################################################################################
+    def __deliver_bonded(self):
+        """ Pass received bonded frames to message handler of bond (this node) while next expected frame is received """
+        while self.__bond_rx_seq in self.__bond_rx:
+            payload = self.__bond_rx.pop(self.__bond_rx_seq)
+            self.__bond_skipped.discard(self.__bond_rx_seq)
+            self.__bond_rx_seq = (self.__bond_rx_seq + 1) & 0xFF
+            self.__bond_gap_time = systime.time()  # waiting frames wait for missing one from now on
+            self.__suppress_response = True
+            try:
+                self.user_message_handler(self.id, payload)
+            finally:
+                self.__suppress_response = False
+        if not self.__bond_rx:
+            self.__bond_gap_time = 0
+
+    ########################################################################################
+    def __bond_service(self):
+        """
+        Skip missing bonded frame if frames after it wait longer than sender retries it (frame failed on its link), 
+        so stream continues. Called from parse_rx_data() of each link.
+        """
+        with self.__bond_lock:
+            timeout = self.__get_timeout(True) * (SDP_RETRANSMIT + 1)  # sender gave up on missing frame
+            if self.__bond_rx and (systime.time() > (self.__bond_gap_time + timeout)):
+                self.__skip_bonded()
+
+    ########################################################################################
+    def __skip_bonded(self):
+        """ Skip missing bonded frame (next expected frame) and pass frames that waited for it to message handler """
+        self.debug('missing bond frame %s skipped' % self.__bond_rx_seq)
+        self.rx_dropped = self.rx_dropped + 1
+        self.__bond_skipped.discard((self.__bond_rx_seq - SDP_BOND_WINDOW) & 0xFF)
+        self.__bond_skipped.add(self.__bond_rx_seq)  # late frame is NACK-ed
+        self.__bond_rx_seq = (self.__bond_rx_seq + 1) & 0xFF
+        self.__bond_gap_time = systime.time()
+        self.__deliver_bonded()
+
+    ########################################################################################
+    def __is_bond_window_full(self):
+        """ 
+        Return True if next bonded frame would be SDP_BOND_WINDOW frames ahead of oldest unacknowledged frame, 
+        receiver could not reorder it
+        """
+        for link in self.__bond_links:
+            for request in list(link.__requests.values()):
+                if (request.ack == SDP_BOND) and (((self.__bond_tx_seq - request.payload[0]) & 0xFF) >= SDP_BOND_WINDOW):
+                    return True
+
+        return False
+
+    ########################################################################################
+    def __find_cached_response(self, address, request_id):
+        """ Return cache entry of request with given source address and ID, None if request is not cached """
+        for entry in self.__cache:
+            if (entry.id == request_id) and (entry.address == address):
+                return entry
+
+        return None
+
+    ########################################################################################
+    def __replay_response(self):
+        """
+        Check received request against response cache. Retransmitted request is answered with cached response (or 
+        ignored if its response was not sent yet), new request is stored in cache (oldest entry is replaced).
+        Returns True if request was retransmitted (message handler must not be called), False otherwise
+        """
+        if (not self.__cache_size) or (not self.__get_id_size()):
+            return False
+
+        (_, crc) = self.__calculate_crc(self.rx_payload)
+        with self.__tx_lock:
+            entry = self.__find_cached_response(self.rx_address, self.rx_id)
+            if (entry is not None) and (entry.crc == crc):
+                self.debug('request %s retransmitted, answered from response cache' % self.rx_id)
+                if entry.response is not None:
+                    if entry.response:
+                        self.send_response(entry.response)
+                    else:
+                        self.__send_empty_frame(SDP_ACK)
+                return True
+
+            if entry is not None:  # same ID with other payload - sender restarted
+                self.__cache.remove(entry)
+            self.__cache.append(SDP_cached_response(self.rx_address, self.rx_id, crc))
+            if len(self.__cache) > self.__cache_size:
+                self.__cache.pop(0)  # replace oldest entry
+
+        return False
+
+    ########################################################################################
+    def __clear_cached_responses(self, address):
+        """ 
+        Drop cached responses of requests from given source address - other node (re)started link with HELLO, its 
+        request IDs start again, so its new request with same ID and payload must not be answered from cache
+        """
+        with self.__tx_lock:
+            if any(entry.address == address for entry in self.__cache):
+                self.debug('HELLO from node %s, its cached responses dropped' % address)
+                self.__cache = [entry for entry in self.__cache if entry.address != address]
+
+    ########################################################################################
+    def __cache_response(self, address, request_id, payload):
+        """ Store response of cached request (sent from message handler or deferred). Call with __tx_lock held. """
+        if (not self.__cache_size) or (not self.__get_id_size()):
+            return
+        entry = self.__find_cached_response(address, request_id)
+        if entry is not None:  # else request was already replaced in cache
+            entry.response = list(payload)
 
-        return status
+    ########################################################################################
+    def __payload_success(self):
+        """ Adaptive payload: transmitted frame was acknowledged, grow tx_payload by 1/4 of frame overhead """
+        if not self.min_payload:
+            return
+        self.__payload_growth = self.__payload_growth + self.__get_max_frame_size(0)
+        self.tx_payload = min(self.max_payload_size, self.tx_payload + self.__payload_growth // 4)
+        self.__payload_growth = self.__payload_growth % 4
 
     ########################################################################################
-    def __handle_message(self):
+    def __payload_error(self):
+        """ Adaptive payload: transmitted frame was NACK-ed or lost, shrink tx_payload by 1/4 """
+        self.tx_errors = self.tx_errors + 1
+        if not self.min_payload:
+            return
+        size = min(self.tx_payload, self.max_payload_size)
+        self.tx_payload = max(self.min_payload, size - size // 4)
+        self.__payload_growth = 0
+
+    ########################################################################################
+    def __get_fec_size(self):
+        """ Returns SDP_FEC_SIZE if FEC option is enabled, 0 otherwise """
+        return SDP_FEC_SIZE if (self.options & SDP_OPTION_FEC) else 0
+
+    ########################################################################################
+    def __fec_correct(self):
         """
-        Handle received message or returned response (clears expecting_response flag).
-        This function calls user defined message handler function (parameter of SDP class) 
+        FEC option: CRC check failed - correct received ID + channel + payload + parity bytes with Reed-Solomon 
+        decoder. Corrected data must match received CRC, unless decoder found no errors (only CRC bytes were corrupted).
+        Returns True if frame is repaired, False if it must be NACK-ed (or dropped)
         """
-        if self.__expect_response:
-            self.__expect_response = False
-        else:
-            if self.ack == SDP_ACK:  # if message received correctly, pass it to user
-                self.user_message_handler(self.id, self.rx_payload)
-            # message CRC failure, send response (return received payload)
-            else:
-                if not self.send_response(self.rx_payload):
-                    self.debug('send response failure')
+        size = len(self.rx_payload) - _SDP_CRC_SIZE
+        if (not self.__get_fec_size()) or (size <= self.__get_fec_size()) or (size > _SDP_MAX_PAYLOAD):
+            return False
+        data = self.rx_payload[:size]
+        corrected = self.__fec.decode(data)
+        if corrected > 0:
+            self.rx_payload[:size] = data
+        if (corrected < 0) or ((corrected > 0) and (not self.__check_rx_message())):
+            self.debug('FEC: too many corrupted bytes')
+            return False
+
+        self.fec_corrected = self.fec_corrected + 1
+        self.debug('FEC: corrupted frame repaired')
+        return True
+
+    ########################################################################################
+    def __receive_parity(self):
+        """ FEC option: discard parity bytes after payload. Returns False if frame is too short to hold parity bytes """
+        if len(self.rx_payload) < self.__get_fec_size():
+            self.debug('FEC: frame without parity bytes')
+            return False
+        del self.rx_payload[len(self.rx_payload) - self.__get_fec_size():]
+
+        return True
 
     ########################################################################################
     def __search_for_sof(self):
         """ Search for "start of frame" character """
         (status, byte) = self.s.get_rx_buff_byte()
         while status:
-            if byte == _SDP_SOF:
-                self.__rx_state = _SDP_RX_ACK
+            if (self.framing == SDP_FRAMING_COBS) and (byte == _SDP_COBS_DELIMITER):
+                # COBS frame starts with delimiter
+                self.__rx_state = _SDP_RX_COBS_ACK
+                self.ack = SDP_ACK
+                self.rx_payload = []  # clear payload buffer
+                self.__cobs_code = 0  # no code byte received yet
+                self.__cobs_remaining = 0
+                self.__rx_header = []  # addressing mode: address bytes are decoded before ack
+                self.__rx_start_time = systime.time()
+
+                return
+            elif (self.framing == SDP_FRAMING_LENGTH) and (byte == _SDP_SOF):
+                # length frame starts with SOF
+                self.__rx_state = _SDP_RX_HEADER
                 self.ack = SDP_ACK
+                self.rx_payload = []  # clear payload buffer
+                self.__rx_header = []
+                self.__rx_start_time = systime.time()
+
+                return
+            elif (self.framing == SDP_FRAMING_DLE) and (byte == _SDP_SOF):
+                if self.__address_size:
+                    self.__rx_state = _SDP_RX_ADDRESS
+                else:
+                    self.__rx_state = _SDP_RX_ACK
+                self.ack = SDP_ACK
+                self.__rx_header = []
                 self.__rx_start_time = systime.time()
 
                 return
@@ -550,36 +2822,26 @@ class SDP():
             elif byte == _SDP_EOF:
                 self.__rx_state = _SDP_RX_IDLE
 
-                if len(self.rx_payload) == 0:  # empty payload, dummy response or frame error
-                    if self.__expect_response:
-                        self.__expect_response = False  # reset flag
-                        # node->ack field is than checked in send_data()
-                    else:  # node is not expecting response, so this frame is corrupted or other error occured.
-                        self.debug(
-                            'empty payload while not expecting response')
-
-                    # in both cases (expecting response or frame error, return)
-                    return
-
-                # payload not empty, continue checking and handling message
-                if not self.__check_rx_message():
-                    self.ack = SDP_NACK
-                    # message CRC validation error
-                    self.debug('CRC validation failure')
+                self.__handle_rx_frame()
+                return  # even if bytes are still in rx buffer, start with searching for SOF
 
-                for _ in range(_SDP_CRC_SIZE):
-                    self.rx_payload.pop()  # clear last elements of payload, since they are CRC
+            elif byte == _SDP_SOF:  # SOF is escaped inside of frame - previous frame is incomplete, receive new frame
+                self.__rx_state = _SDP_RX_ADDRESS if self.__address_size else _SDP_RX_ACK
+                self.ack = SDP_ACK
+                self.__rx_header = []
+                self.__rx_start_time = systime.time()
 
-                self.__handle_message()  # handle message upon expect_response flag, NACK and payload
-                return  # even if bytes are still in rx buffer, start with searching for SOF
+                self.debug('incomplete frame, SOF received')
+                return
 
             else:  # received character is not DLE or EOF, append data to payload
-                if len(self.rx_payload) < (self.max_payload_size + _SDP_CRC_SIZE):
+                if len(self.rx_payload) < (self.max_payload_size + self.__get_prefix_size() + self.__get_fec_size() + _SDP_CRC_SIZE):
                     self.rx_payload.append(byte)
                 else:  # discard data, payload size out of range before EOF
                     self.__rx_state = _SDP_RX_IDLE
 
                     self.debug('payload oversized')
+                    self.__send_fast_nack(SDP_NACK_OVERSIZE)
                     return
 
             # handle all bytes in serial rx buffer
@@ -598,24 +2860,456 @@ class SDP():
 
                 self.__rx_state = _SDP_RX_RECEIVING
 
-                if len(self.rx_payload) < (self.max_payload_size + _SDP_CRC_SIZE):
+                if len(self.rx_payload) < (self.max_payload_size + self.__get_prefix_size() + self.__get_fec_size() + _SDP_CRC_SIZE):
                     self.rx_payload.append(byte ^ _SDP_DLE_XOR)
-                else:
+                else:  # discard data, payload size out of range before EOF
+                    self.__rx_state = _SDP_RX_IDLE
                     self.debug('payload oversized')
+                    self.__send_fast_nack(SDP_NACK_OVERSIZE)
                     return
             else:  # framing error, DLE should never appear on its own in message
                 self.__rx_state = _SDP_RX_IDLE
                 self.debug('corrupted data, standalone DLE')
+                self.__send_fast_nack(SDP_NACK_FRAMING)
+
+    ########################################################################################
+    def __handle_rx_frame(self):
+        """ Complete frame (ack and payload + CRC) is received. Check CRC and handle message. """
+        if self.ack == SDP_NOTIFY:
+            self.__receive_notification()  # notification is never a response, even while this node is waiting for one
+            return
+        if self.ack == SDP_DATAGRAM:
+            self.__receive_datagram()  # datagram is never a response, corrupted datagram is not NACK-ed
+            return
+        if self.ack == SDP_GROUP:
+            self.__receive_group_frame()  # group members never respond
+            return
+        if self.__address_size and (self.__rx_dst >= SDP_GROUP_ADDRESS):
+            self.debug('frame addressed to group dropped')  # only group frames, responses of members would collide
+            return
+
+        if self.__expect_response and self.__address_size and (self.rx_address != self.__tx_dst) and \
+                (not self.__get_id_size()):
+            # frame from other node while waiting for response, ignore it
+            self.debug('frame from node %s while waiting for response' % self.rx_address)
+            return
+        if (self.ack == SDP_NACK) and (not self.__expect_response) and (not self.__get_id_size()):
+            # late NACK (request already timed out) is not answered - no NACK ping-pong
+            self.debug('NACK while not waiting for response ignored')
+            return
+
+        if len(self.rx_payload) == 0:  # empty payload, dummy response or frame error
+            if self.__expect_response and (not self.__get_id_size()):  # with request ID option, frames always carry ID
+                if self.ack == SDP_LINK_ACK:
+                    self.__link_acked = True  # frame received by other node, keep waiting for response
+                    self.__link_ack_time = systime.time()
+                    return
+                self.__response_ack = self.ack
+                self.__response = []
+                self.__expect_response = False  # reset flag
+                # ack field is than checked in send_data()
+            else:  # node is not expecting response, so this frame is corrupted or other error occured.
+                self.debug(
+                    'empty payload while not expecting response')
+
+            # in both cases (expecting response or frame error, return)
+            return
+
+        # payload not empty, continue checking and handling message
+        if (not self.__check_rx_message()) and (not self.__fec_correct()):
+            self.ack = SDP_NACK
+            self.rx_crc_errors = self.rx_crc_errors + 1
+            # message CRC validation error
+            self.debug('CRC validation failure')
+
+        for _ in range(_SDP_CRC_SIZE):
+            self.rx_payload.pop()  # clear last elements of payload, since they are CRC
+        if self.__get_fec_size() and (not self.__receive_parity()):
+            self.ack = SDP_NACK
+
+        if self.__get_prefix_size() and (not self.__receive_prefix()):
+            return  # request ID option: response to send_request() is already handled
+
+        if (self.options & SDP_OPTION_LINK_ACK) and (not self.__is_response()):
+            # acknowledge request before it is handled, response follows when message handler is done
+            if not self.__send_empty_frame(SDP_LINK_NACK if (self.ack == SDP_NACK) else SDP_LINK_ACK):
+                self.debug('link ACK transmission failure')
+            if self.ack == SDP_NACK:
+                return  # sender retransmits frame on link NACK
+
+        self.__handle_message()  # handle message upon expect_response flag, NACK and payload
+
+    ########################################################################################
+    def __receive_notification(self):
+        """ Notification frame is received. Check CRC and pass payload to subscribers - no response is sent. """
+        if (len(self.rx_payload) == 0) or ((not self.__check_rx_message()) and (not self.__fec_correct())):
+            self.debug('notification CRC validation failure')  # can't be retransmitted, drop it
+            return
+
+        for _ in range(_SDP_CRC_SIZE):
+            self.rx_payload.pop()
+        if self.__get_fec_size() and (not self.__receive_parity()):
+            return
+        if self.__get_prefix_size() and (not self.__receive_prefix()):
+            return
+        if len(self.rx_payload) < _SDP_NOTIFY_SEQ_SIZE:
+            self.debug('notification without sequence number dropped')
+            return
+        self.__notify_record(self.rx_payload[0])
+        if self.token:
+            # notifying node holds token - duplicated token, drop it
+            self.debug('duplicated token dropped')
+            self.token = False
+        if not self.__subscribers:
+            self.debug('notification without subscriber dropped')
+        for callback in list(self.__subscribers):
+            callback(self.id, self.rx_payload[_SDP_NOTIFY_SEQ_SIZE:])
+
+    ########################################################################################
+    def __notify_record(self, seq):
+        """ Store sequence number of received notification and count notifications skipped since newest one """
+        self.notify_seq = seq
+        if self.rx_address in self.__notify_rx:
+            missed = (seq - self.__notify_rx[self.rx_address] - 1) & 0xFF
+            if missed >= 0x80:  # late (reordered) notification, it was counted as lost
+                return
+            if missed:
+                self.notify_lost = self.notify_lost + missed
+                self.debug('%s notification(s) lost' % missed)
+        self.__notify_rx[self.rx_address] = seq
+
+    ########################################################################################
+    def __receive_datagram(self):
+        """
+        Datagram is received. Check CRC and pass payload to message handler - responses are not sent, corrupted 
+        datagram is dropped (counted in rx_dropped).
+        """
+        if (len(self.rx_payload) == 0) or ((not self.__check_rx_message()) and (not self.__fec_correct())):
+            self.rx_dropped = self.rx_dropped + 1
+            self.debug('datagram CRC validation failure')
+            return
+
+        for _ in range(_SDP_CRC_SIZE):
+            self.rx_payload.pop()
+        if (self.__get_fec_size() and (not self.__receive_parity())) or \
+                (self.__get_prefix_size() and (not self.__receive_prefix())):
+            self.rx_dropped = self.rx_dropped + 1
+            return
+        if self.token:
+            # sending node holds token - duplicated token, drop it
+            self.debug('duplicated token dropped')
+            self.token = False
+
+        handler = self.user_message_handler
+        if self.__get_channel_size() and (self.rx_channel < SDP_MAX_CHANNELS) and \
+                (self.__channels[self.rx_channel].handler is not None):
+            handler = self.__channels[self.rx_channel].handler  # channels option: channel handler
+        self.__suppress_response = True
+        self.ack = SDP_ACK  # datagram is handled as correctly received frame
+        try:
+            handler(self.id, self.rx_payload)
+        finally:
+            self.__suppress_response = False
+
+    ########################################################################################
+    def __receive_group_frame(self):
+        """
+        Group frame is received. Check CRC, record sequence number (poll_group()) and pass payload to message 
+        handler - responses are not sent, corrupted frame is dropped (counted in rx_dropped).
+        """
+        if (len(self.rx_payload) == 0) or ((not self.__check_rx_message()) and (not self.__fec_correct())):
+            self.rx_dropped = self.rx_dropped + 1
+            self.debug('group frame CRC validation failure')
+            return
+
+        for _ in range(_SDP_CRC_SIZE):
+            self.rx_payload.pop()
+        if (self.__get_fec_size() and (not self.__receive_parity())) or \
+                (self.__get_prefix_size() and (not self.__receive_prefix())) or \
+                (len(self.rx_payload) < _SDP_GROUP_SEQ_SIZE) or (not self.__address_size) or \
+                (self.__rx_dst < SDP_GROUP_ADDRESS):
+            self.rx_dropped = self.rx_dropped + 1
+            self.debug('invalid group frame')
+            return
+        self.__group_record(self.__rx_dst, self.rx_address, self.rx_payload[0])
+        if self.token:
+            # sending node holds token - duplicated token, drop it
+            self.debug('duplicated token dropped')
+            self.token = False
+
+        handler = self.user_message_handler
+        if self.__get_channel_size() and (self.rx_channel < SDP_MAX_CHANNELS) and \
+                (self.__channels[self.rx_channel].handler is not None):
+            handler = self.__channels[self.rx_channel].handler  # channels option: channel handler
+        self.__suppress_response = True
+        self.ack = SDP_ACK  # group frame is handled as correctly received frame
+        try:
+            handler(self.id, self.rx_payload[_SDP_GROUP_SEQ_SIZE:])
+        finally:
+            self.__suppress_response = False
+
+    ########################################################################################
+    def __group_record(self, group, address, seq):
+        """
+        Mark group frame, sent by node with given address to group, as received. Each sender numbers its group frames, 
+        so bitmap (last SDP_GROUP_HISTORY frames, bit 0 is newest frame) is kept per (group, sender) pair.
+        """
+        key = (group, address)
+        (last_seq, bitmap) = self.__group_rx.get(key, (0, 0))
+        ahead = (seq - last_seq) & 0xFF
+        behind = (last_seq - seq) & 0xFF
+        if (not bitmap) or (0 < ahead < 0x80):  # first or newer frame
+            bitmap = (((bitmap << ahead) | 1) & 0xFFFF) if ahead < SDP_GROUP_HISTORY else 1
+            self.__group_rx[key] = (seq, bitmap)
+        elif behind < SDP_GROUP_HISTORY:  # late (reordered) frame
+            self.__group_rx[key] = (last_seq, bitmap | (1 << behind))
+
+    ########################################################################################
+    def __get_credit_size(self):
+        """ Return _SDP_CREDIT_SIZE if credits option is enabled, 0 otherwise """
+        return _SDP_CREDIT_SIZE if (self.options & SDP_OPTION_CREDITS) else 0
+
+    ########################################################################################
+    def __get_frame_credits(self, payload_size):
+        """
+        Return number of credits (started SDP_CREDIT_UNIT blocks) that frame with given payload size takes in rx 
+        buffer of other node - worst case size of active framing (DLE escapes can double it), so rx buffer can't 
+        overflow whatever payload bytes are.
+        """
+        frame_size = self.__get_max_frame_size(payload_size)
+
+        return (frame_size + SDP_CREDIT_UNIT - 1) // SDP_CREDIT_UNIT
+
+    ########################################################################################
+    def __has_credit(self, dst, payload_size, probe):
+        """
+        Return True if frame with given payload size can be transmitted to dst: credits option is disabled or other 
+        node granted enough credits. Credits of one max sized frame are reserved for probe - request that is sent 
+        when nothing is in flight (its response grants new credits), so it fits even if frames without response 
+        (datagrams) used all other credits.
+        probe: frame waits for response (request, batch) and can be sent as probe
+        """
+        # without request ID option, __expect_response stays set after failed send_data() (late response is not taken 
+        # as request), but nothing is retransmitted anymore
+        in_flight = bool(self.__requests) or self.__sending
+        if not self.__get_credit_size():
+            return True
+        if self.__address_size and (dst != self.__credit_dst):
+            if in_flight:
+                return False  # credits belong to other node, wait until its frames are answered
+            self.__credit_dst = dst
+            self.__tx_credit_limit = self.__tx_credit_used
+        if probe and (not in_flight):
+            return True
+
+        return (self.__tx_credit_limit - self.__tx_credit_used) >= \
+            (self.__get_frame_credits(payload_size) + self.__get_frame_credits(self.max_payload_size))
+
+    ########################################################################################
+    def __wait_for_credit(self, dst, payload_size):
+        """
+        Wait until frame with given payload size can be transmitted to dst (__has_credit()) - responses (parser 
+        thread) grant new credits and requests in flight time out if other node doesn't respond.
+        Returns False if credits were not granted in SDP_RETRANSMIT response timeouts
+        """
+        if self.__has_credit(dst, payload_size, True):
+            return True
+
+        self.credit_stalls = self.credit_stalls + 1
+        timeout = systime.time() + self.__get_timeout(True) * SDP_RETRANSMIT
+        while not self.__has_credit(dst, payload_size, True):
+            systime.sleep(0)
+            if systime.time() > timeout:
+                self.debug('timeout waiting for credits')
+                return False
+
+        return True
+
+    ########################################################################################
+    def __update_credits(self, mark):
+        """
+        Response from other node is received: its credit byte is free rx buffer space when response was sent, 
+        all frames transmitted after request (mark: __tx_credit_used after its last transmission) may still take it.
+        """
+        if (not self.__get_credit_size()) or (self.__address_size and (self.rx_address != self.__credit_dst)):
+            return
+        self.__tx_credit_limit = mark + self.__rx_credit
+
+    ########################################################################################
+    def __append_cobs_data(self):
+        """ 
+        Decode COBS encoded bytes until delimiter is received. Each code byte holds number 
+        of following data bytes + 1. If code < 0xFF, zero byte is appended after data bytes.
+        """
+        (status, byte) = self.s.get_rx_buff_byte()
+        while status:
+            if byte == _SDP_COBS_DELIMITER:
+                if self.__cobs_code == 0:  # back to back delimiters, frame has not started yet
+                    self.__rx_start_time = systime.time()
+
+                elif (self.__cobs_remaining != 0) or (self.__rx_state == _SDP_RX_COBS_ACK):
+                    # delimiter inside of block or no ack - framing error
+                    self.debug('COBS framing error')
+                    if self.__rx_state == _SDP_RX_COBS:  # ack field was received
+                        self.__send_fast_nack(SDP_NACK_FRAMING)
+                    self.__rx_state = _SDP_RX_IDLE
+                    return
+
+                else:  # end of frame, last (implicit) zero is not part of frame
+                    self.__rx_state = _SDP_RX_IDLE
+
+                    self.__handle_rx_frame()
+                    return  # even if bytes are still in rx buffer, start with searching for delimiter
+
+            elif self.__cobs_remaining == 0:  # code byte
+                # previous block ended with zero
+                if (self.__cobs_code != 0) and (self.__cobs_code != 0xFF):
+                    if not self.__cobs_rx_put(0):
+                        return
+                self.__cobs_code = byte
+                self.__cobs_remaining = byte - 1
+
+            else:  # data byte
+                self.__cobs_remaining = self.__cobs_remaining - 1
+                if not self.__cobs_rx_put(byte):
+                    return
+
+            (status, byte) = self.s.get_rx_buff_byte()
+
+    ########################################################################################
+    def __cobs_rx_put(self, byte):
+        """ 
+        Store decoded COBS byte. First byte of frame is ack (after address), others are payload and CRC.
+        Returns False if payload size is out of range, True otherwise.
+        """
+        if (self.__rx_state == _SDP_RX_COBS_ACK) and (len(self.__rx_header) < self.__address_size):
+            self.__rx_header.append(byte)  # address before ack
+            if (len(self.__rx_header) == self.__address_size) and (not self.__check_rx_address(self.__rx_header)):
+                self.__rx_state = _SDP_RX_IDLE
+                return False
+            return True
+
+        if self.__rx_state == _SDP_RX_COBS_ACK:
+            self.ack = byte
+            self.__rx_state = _SDP_RX_COBS
+            self.rx_payload = []  # clear payload buffer
+            return True
+
+        if len(self.rx_payload) < (self.max_payload_size + self.__get_prefix_size() + self.__get_fec_size() + _SDP_CRC_SIZE):
+            self.rx_payload.append(byte)
+            return True
+        else:  # discard data, payload size out of range before delimiter
+            self.__rx_state = _SDP_RX_IDLE
+
+            self.debug('payload oversized')
+            self.__send_fast_nack(SDP_NACK_OVERSIZE)
+            return False
+
+    ########################################################################################
+    def __receive_header(self):
+        """
+        Receive fixed size header ([DST, SRC], ACK, FLAGS, LEN) and header CRC. If header is valid, 
+        exactly LEN payload bytes + CRC follows. If header is corrupted, frame is discarded and receiver searches for 
+        next SOF (also inside of received header).
+        """
+        (status, byte) = self.s.get_rx_buff_byte()
+        while status:
+            self.__rx_header.append(byte)
+            if len(self.__rx_header) < (self.__address_size + _SDP_LENGTH_HEADER_SIZE + _SDP_LENGTH_HCRC_SIZE):
+                (status, byte) = self.s.get_rx_buff_byte()
+                continue
+
+            (status, crc_value) = self.__calculate_crc(self.__rx_header)
+            if (not status) or (crc_value != [0, 0]):
+                self.debug('header CRC validation failure')
+                # SOF was false (inside of payload) or header is corrupted: next frame can start inside of header
+                if _SDP_SOF not in self.__rx_header:
+                    self.__rx_state = _SDP_RX_IDLE
+                    return
+                self.__rx_header = self.__rx_header[self.__rx_header.index(_SDP_SOF) + 1:]
+                (status, byte) = self.s.get_rx_buff_byte()
+                continue
+            self.__rx_state = _SDP_RX_IDLE
+            header = self.__rx_header[self.__address_size:]  # ACK, FLAGS, LEN
+            if header[2] > (self.max_payload_size + self.__get_prefix_size() + self.__get_fec_size()):
+                self.debug('header payload length oversized')
+                if (not self.__address_size) or self.__check_rx_address(self.__rx_header):
+                    self.ack = header[0]
+                    self.rx_payload = []
+                    self.__send_fast_nack(SDP_NACK_OVERSIZE)
+                return
+            if self.__address_size and (not self.__check_rx_address(self.__rx_header)):
+                return
+
+            self.ack = header[0]
+            self.rx_flags = header[1]
+            self.rx_payload = []
+            if header[2] == 0:  # header only - no payload and no CRC (dummy response)
+                self.__handle_rx_frame()
+                return
+            self.__rx_frame_size = header[2] + _SDP_CRC_SIZE
+            self.__rx_state = _SDP_RX_LENGTH
+
+            return  # header OK, start receiving payload
+
+    ########################################################################################
+    def __receive_length_data(self):
+        """ Copy payload and CRC bytes from rx buffer (in blocks, no byte inspection) """
+        num = self.__rx_frame_size - len(self.rx_payload)  # remaining bytes of this frame
+        self.rx_payload.extend(self.s.get_rx_buff_bytes(num))
+
+        if len(self.rx_payload) == self.__rx_frame_size:  # payload and CRC received
+            self.__rx_state = _SDP_RX_IDLE
+
+            self.__handle_rx_frame()
+
+    ########################################################################################
+    def __receive_address(self):
+        """ Addressing mode, DLE framing: receive DST and SRC address bytes (not escaped) after SOF """
+        (status, byte) = self.s.get_rx_buff_byte()
+        while status:
+            self.__rx_header.append(byte)
+            if len(self.__rx_header) < self.__address_size:
+                (status, byte) = self.s.get_rx_buff_byte()
+                continue
+
+            if self.__check_rx_address(self.__rx_header):
+                self.__rx_state = _SDP_RX_ACK
+            else:
+                self.__rx_state = _SDP_RX_IDLE
+            return
+
+    ########################################################################################
+    def __check_rx_address(self, address):
+        """
+        Addressing mode: check received DST address and store SRC address. 
+        Returns True if frame is addressed to this node, False otherwise (frame is dropped)
+        """
+        if (address[0] != self.id) and (address[0] not in self.__groups):
+            return False
+        self.__rx_dst = address[0]
+        self.rx_address = address[1]
+
+        return True
+
+    ########################################################################################
+    def __get_address(self):
+        """ Addressing mode: return DST and SRC address bytes of frame that is being composed """
+        if self.__address_size:
+            return [self.__tx_dst, self.id]
+        return []
 
     ########################################################################################
     def __rx_frame_timeout(self):
         """ Check if frame (and character EOF) arrived in rx_frame_timeout """
         if systime.time() > (self.__rx_start_time + self.rx_frame_timeout):
+            self.debug('receiving frame timeout')
+            if self.__rx_state in (_SDP_RX_RECEIVING, _SDP_RX_DLE, _SDP_RX_COBS, _SDP_RX_LENGTH):
+                self.__send_fast_nack(SDP_NACK_TIMEOUT)  # ack field was received
             self.__rx_state = _SDP_RX_IDLE
 
             self.rx_payload = []    # discard payload data
 
-            self.debug('receiving frame timeout')
             return False
         else:
             return True
@@ -672,15 +3366,32 @@ class SDP():
             return (False, [])
 
     ########################################################################################
-    def __compose_frame(self, payload):
+    def __compose_frame(self, payload, ack=SDP_ACK):
         """
         Compose frame accordingly to SDP protocol
         Returns status and array of bytes
         """
+        if self.__get_credit_size():  # credits option: credit byte follows channel byte
+            payload = [_SDP_MAX_CREDIT] + list(payload)
+        if self.__get_channel_size():  # channels option: channel byte follows request ID
+            payload = [self.__tx_channel] + list(payload)
+        if self.__get_id_size():  # request ID option: ID byte is first payload byte
+            payload = [self.__tx_id] + list(payload)
+        if self.__get_fec_size() and payload:  # FEC option: parity bytes follow payload (frame without payload stays empty)
+            if len(payload) > (_SDP_MAX_PAYLOAD - self.__get_fec_size()):  # max Reed-Solomon codeword size
+                self.debug('frame oversized')
+                return (False, [])
+            payload = list(payload) + self.__fec.encode(payload)
+        if self.framing == SDP_FRAMING_COBS:
+            return self.__compose_cobs_frame(payload, ack)
+        if self.framing == SDP_FRAMING_LENGTH:
+            return self.__compose_length_frame(payload, ack)
+
         frame = []
 
         frame.append(_SDP_SOF)
-        frame.append(SDP_ACK)
+        frame.extend(self.__get_address())  # addressing mode: DST | SRC
+        frame.append(ack)
 
         for b in payload:
             # check for special characters
@@ -720,18 +3431,141 @@ class SDP():
     ########################################################################################
     def __compose_nack_frame(self, payload):
         """
-        Compose frame with payload for response purposes (CRC verification failure at receiver)
+        Compose NACK frame for response purposes (CRC verification failure at receiver). Payload is reason code 
+        (SDP_NACK_xxx), received payload is not echoed.
         Returns status and array of bytes
         """
-        (status, frame) = self.__compose_frame(payload)  # build normal frame
-        if status:
-            # on success, change ACK to NACK
-            # accordingly to SDP frame, ack/nack positions is second byte
-            frame[1] = SDP_NACK
+        return self.__compose_frame(payload, SDP_NACK)
 
-            return (True, frame)
+    ########################################################################################
+    def __send_fast_nack(self, reason):
+        """
+        Framing error (or rx frame timeout) after ack field was received: send compact NACK immediately, so sender 
+        retransmits frame without waiting for response timeout. Only requests are NACK-ed (with request ID option, 
+        ID byte must be received) and at most one NACK is sent in SDP_FAST_NACK_INTERVAL.
+        """
+        if (self.ack != SDP_ACK) and (self.ack != SDP_BATCH) and (self.ack != SDP_BOND):
+            return  # response, notification or control frame
+        if self.__address_size and (self.__rx_dst >= SDP_GROUP_ADDRESS):
+            return  # frame addressed to group is never answered
+        if not self.__get_id_size():
+            if self.__expect_response:
+                return  # frame is probably response, this node retransmits request on timeout
+        else:
+            if (len(self.rx_payload) < self.__get_prefix_size()) or (self.rx_payload[0] & _SDP_ID_RESPONSE):
+                return  # request ID not received or frame is response
+            self.rx_id = self.rx_payload[0]
+            if self.__get_channel_size():
+                self.rx_channel = self.rx_payload[self.__get_id_size()]
+        if (systime.time() - self.__nack_time) < SDP_FAST_NACK_INTERVAL:
+            return
+
+        self.__nack_time = systime.time()
+        self.ack = SDP_NACK
+        if not self.send_response([reason]):
+            self.debug('fast NACK transmission failure')
+
+    ########################################################################################
+    def __get_nack_reason(self):
+        """ Return reason code of received NACK, SDP_NACK_UNKNOWN if NACK echoes payload (older nodes) """
+        if len(self.rx_payload) != 1:
+            return SDP_NACK_UNKNOWN
+
+        return self.rx_payload[0]
+
+    ########################################################################################
+    def __compose_cobs_frame(self, payload, ack):
+        """
+        Compose COBS encoded frame: DELIMITER | COBS([DST | SRC] | ACK | PAYLOAD + CRC) | DELIMITER
+        Returns status and array of bytes
+        """
+        (status, crc) = self.__calculate_crc(
+            payload)  # calculate payload CRC data
+        if not status:
+            self.debug('calculating CRC failure')
+            return (False, [])
+
+        frame = [_SDP_COBS_DELIMITER]
+        frame.extend(self.__cobs_encode(self.__get_address() + [ack] + list(payload) + crc))
+        frame.append(_SDP_COBS_DELIMITER)
+
+        if len(frame) > self.__max_frame_size:   # check if frame is inside of SDP size setup
+            self.debug('frame oversized')
+            return (False, [])
         else:
+            return (True, frame)
+
+    ########################################################################################
+    def __compose_length_frame(self, payload, ack):
+        """
+        Compose length prefixed frame: SOF | [DST | SRC] | ACK | FLAGS | LEN | HCRC | PAYLOAD | CRC
+        Payload is not escaped. If payload is empty, frame ends with header CRC (dummy response).
+        Returns status and array of bytes
+        """
+        if len(payload) > _SDP_MAX_PAYLOAD:  # LEN field is one byte
+            self.debug('frame oversized')
+            return (False, [])
+        header = self.__get_address() + [ack, _SDP_FLAGS_NONE, len(payload)]
+        (status, hcrc) = self.__calculate_crc(header)
+        if not status:
+            self.debug('calculating CRC failure')
+            return (False, [])
+        frame = [_SDP_SOF] + header + hcrc
+        if len(payload) == 0:
+            return (True, frame)
+
+        (status, crc) = self.__calculate_crc(payload)
+        if not status:
+            self.debug('calculating CRC failure')
+            return (False, [])
+        frame.extend(payload)
+        frame.extend(crc)
+
+        if len(frame) > self.__max_frame_size:   # check if frame is inside of SDP size setup
+            self.debug('frame oversized')
             return (False, [])
+        else:
+            return (True, frame)
+
+    ########################################################################################
+    def __cobs_encode(self, data):
+        """
+        COBS encode data (array of bytes). Zero bytes (and full blocks) close current block.
+        Returns array of encoded bytes (without delimiters)
+        """
+        encoded = [0]   # placeholder for first code byte
+        code_index = 0
+        code = 1
+        for b in data:
+            if b != _SDP_COBS_DELIMITER:
+                encoded.append(b)
+                code = code + 1
+            if (b == _SDP_COBS_DELIMITER) or (code == 0xFF):
+                encoded[code_index] = code
+                code_index = len(encoded)  # reserve place for next code byte
+                encoded.append(0)
+                code = 1
+        encoded[code_index] = code  # close last block
+
+        return encoded
+
+    ########################################################################################
+    def __get_max_frame_size(self, payload_size=None):
+        """ Calculate worst case frame size of node's payload size (or given payload size) and framing """
+        if payload_size is None:
+            payload_size = self.max_payload_size
+        # worst case includes optional request ID, channel, credit and parity
+        data_size = payload_size + _SDP_REQUEST_ID_SIZE + _SDP_CHANNEL_SIZE + _SDP_CREDIT_SIZE + SDP_FEC_SIZE
+        body_size = self.__address_size + _SDP_ACK_SIZE + data_size + _SDP_CRC_SIZE
+        if self.framing == SDP_FRAMING_COBS:
+            # delimiter + code byte for each (started) block of 254 bytes + delimiter
+            return 1 + body_size + (body_size // _SDP_COBS_BLOCK_SIZE) + 1 + 1
+        if self.framing == SDP_FRAMING_LENGTH:
+            return (_SDP_SOF_SIZE + self.__address_size + _SDP_LENGTH_HEADER_SIZE + _SDP_LENGTH_HCRC_SIZE +
+                    data_size + _SDP_CRC_SIZE)
+        # payload worst case = *2 - if every byte of payload is special character, escaped with DLE (address is not)
+        return (_SDP_SOF_SIZE + self.__address_size + _SDP_ACK_SIZE +
+                data_size * 2 + _SDP_CRC_SIZE * 2 + _SDP_EOF_SIZE)
 
     ########################################################################################
     def __check_data(self, data):
@@ -741,6 +3575,13 @@ class SDP():
         Data is converted to integer (byte).
         Returns True if all elements are OK, False otherwise.
         """
+        if isinstance(data, (list, tuple, bytes, bytearray)):  # bytearray(int) would be accepted as zero bytes
+            try:
+                bytes(bytearray(data))  # fast path: all elements are integers 0 - 255 (checked without python loop)
+                return True
+            except (TypeError, ValueError):
+                pass  # characters (converted below) or invalid elements
+
         for i, d in enumerate(data):
             if isinstance(d, str):  # d = character
                 if len(d) == 1:  # check if it is not a single character
@@ -0,0 +1,496 @@
+# -*- coding: utf-8 -*-
+"""
+Simple Data Protocol - message schema code generator
+Messages are described once in schema file, generator writes matching C (firmware) and python codecs:
+ - C: message structs, encode/decode functions (straight-line byte copies into packed little endian payload, no 
+   alignment requirements) and static opcode -> handler dispatch table (O(1) lookup by first payload byte)
+ - python: struct based message classes (one pack/unpack call per message) and opcode -> class table
+
+Schema file (one statement per line, '#' starts comment):
+    prefix motor                    # optional, default: schema file name
+    message set_speed 0x01          # message name and opcode (0 - 255), opcode is first payload byte
+        int16 rpm                   # field: type and name
+        uint8 ramp_ms
+    message read_adc 0x02
+        uint16 samples[4]           # fixed size array
+Field types: uint8, int8, uint16, int16, uint32, int32, float (32 bit IEEE 754)
+Message and field names must be identifiers that are valid in C and python: C/python keywords, names that start with
+'_' and names used by generated code (ID, SIZE, encode, decode, ... - see RESERVED) are rejected.
+
+C usage: implement one handler per message (void <prefix>_handle_<message>(SDP_data_t *node, <prefix>_<message>_t *msg))
+and call <prefix>_dispatch(node, payload, size) from sdp_user_handle_message() (returns false on unknown opcode or
+invalid size). Transmit: size = <prefix>_encode_<message>(&msg, payload), sdp_send_data(node, payload, size).
+Python usage: node.send_data(<message>(rpm=100).encode()), msg = <prefix>.decode(payload) (None if invalid).
+
+# python sdp_codegen.py motor.sdpi --c-dir ../firmware --py-dir .
+"""
+
+import argparse
+import keyword
+import os
+import re
+import sys
+
+# type: (C type, python struct format, size [bytes])
+TYPES = {
+    'uint8': ('uint8_t', 'B', 1),
+    'int8': ('int8_t', 'b', 1),
+    'uint16': ('uint16_t', 'H', 2),
+    'int16': ('int16_t', 'h', 2),
+    'uint32': ('uint32_t', 'I', 4),
+    'int32': ('int32_t', 'i', 4),
+    'float': ('float', 'f', 4),
+}
+# C unsigned type of the same size - signed and float values are shifted as unsigned
+UNSIGNED = {1: 'uint8_t', 2: 'uint16_t', 4: 'uint32_t'}
+OPCODE_SIZE = 1  # opcode is first payload byte
+MAX_PAYLOAD = 255  # C library limitation, maximum payload bytes
+
+IDENTIFIER = r'[A-Za-z_][A-Za-z0-9_]*'
+RE_IDENTIFIER = re.compile(r'^%s$' % IDENTIFIER)
+RE_PREFIX = re.compile(r'^prefix\s+(\S+)$')
+RE_MESSAGE = re.compile(r'^message\s+(\S+)\s+(0[xX][0-9A-Fa-f]+|[0-9]+)$')
+RE_FIELD = re.compile(r'^(%s)\s+([^\s\[]+)(?:\s*\[\s*([0-9]+)\s*\])?$' % IDENTIFIER)
+C_KEYWORDS = ('auto', 'break', 'case', 'char', 'const', 'continue', 'default', 'do', 'double', 'else', 'enum', 'extern',
+              'float', 'for', 'goto', 'if', 'inline', 'int', 'long', 'register', 'restrict', 'return', 'short', 'signed',
+              'sizeof', 'static', 'struct', 'switch', 'typedef', 'union', 'unsigned', 'void', 'volatile', 'while',
+              'bool', 'true', 'false', 'NULL')  # last four are macros of stdbool.h and stddef.h
+# names used by generated python code: message class attributes and methods, module names and used builtins
+RESERVED = ('ID', 'SIZE', 'encode', 'decode', 'self', 'cls', 'struct', 'MAX_SIZE', 'MESSAGES', 'object', 'list', 'bytes',
+            'bytearray', 'classmethod', 'len')
+
+
+class SchemaError(Exception):
+    pass
+
+
+class Field(object):
+    def __init__(self, type_name, name, count):
+        self.type_name = type_name
+        self.name = name
+        self.count = count  # number of elements, 0 - scalar
+        (self.c_type, self.fmt, self.size) = TYPES[type_name]
+
+    ########################################################################################
+    def total_size(self):
+        """ Number of payload bytes of this field """
+        return self.size * max(self.count, 1)
+
+
+class Message(object):
+    def __init__(self, name, opcode):
+        self.name = name
+        self.opcode = opcode
+        self.fields = []
+
+    ########################################################################################
+    def size(self):
+        """ Number of payload bytes, including opcode """
+        return OPCODE_SIZE + sum(f.total_size() for f in self.fields)
+
+    ########################################################################################
+    def struct_format(self):
+        """ python struct format of whole payload (opcode + fields), little endian without padding """
+        fmt = '<B'
+        for f in self.fields:
+            fmt = fmt + ('%s%s' % (f.count, f.fmt) if f.count else f.fmt)
+
+        return fmt
+
+
+def check_name(name, kind, line_number):
+    """ Raise SchemaError if name can't be used in generated C and python code """
+    if not RE_IDENTIFIER.match(name):
+        raise SchemaError('line %s: %s name "%s" is not an identifier' % (line_number, kind, name))
+    if (name in C_KEYWORDS) or keyword.iskeyword(name):
+        raise SchemaError('line %s: %s name "%s" is C or python keyword' % (line_number, kind, name))
+    if name in RESERVED or name.startswith('_'):
+        raise SchemaError('line %s: %s name "%s" is reserved by generated code' % (line_number, kind, name))
+
+
+def parse_schema(text, default_prefix):
+    """ Parse schema text, return (prefix, list of Message). Raise SchemaError on invalid schema. """
+    prefix = re.sub(r'\W', '_', default_prefix)  # file name can contain characters that are not valid in C names
+    messages = []
+    for (line_number, line) in enumerate(text.splitlines(), 1):
+        line = line.split('#', 1)[0].strip()
+        if not line:
+            continue
+        match = RE_PREFIX.match(line)
+        if match:
+            if messages:
+                raise SchemaError('line %s: prefix must be set before first message' % line_number)
+            if not RE_IDENTIFIER.match(match.group(1)):
+                raise SchemaError('line %s: prefix "%s" is not an identifier' % (line_number, match.group(1)))
+            prefix = match.group(1)
+            continue
+        match = RE_MESSAGE.match(line)
+        if match:
+            check_name(match.group(1), 'message', line_number)
+            opcode = int(match.group(2), 0)
+            if opcode > 0xFF:
+                raise SchemaError('line %s: opcode %s out of range (0 - 255)' % (line_number, opcode))
+            if match.group(1) in [m.name for m in messages]:
+                raise SchemaError('line %s: duplicated message name %s' % (line_number, match.group(1)))
+            if opcode in [m.opcode for m in messages]:
+                raise SchemaError('line %s: duplicated opcode 0x%02X' % (line_number, opcode))
+            messages.append(Message(match.group(1), opcode))
+            continue
+        match = RE_FIELD.match(line)
+        if match:
+            if not messages:
+                raise SchemaError('line %s: field outside of message' % line_number)
+            if match.group(1) not in TYPES:
+                raise SchemaError('line %s: unknown type %s' % (line_number, match.group(1)))
+            check_name(match.group(2), 'field', line_number)
+            if match.group(2) in [f.name for f in messages[-1].fields]:
+                raise SchemaError('line %s: duplicated field name %s' % (line_number, match.group(2)))
+            count = int(match.group(3)) if match.group(3) is not None else 0
+            if match.group(3) is not None and count == 0:
+                raise SchemaError('line %s: array of 0 elements' % line_number)
+            messages[-1].fields.append(Field(match.group(1), match.group(2), count))
+            if messages[-1].size() > MAX_PAYLOAD:
+                raise SchemaError('line %s: message %s larger than %s bytes' % (line_number, messages[-1].name, MAX_PAYLOAD))
+            continue
+        raise SchemaError('line %s: invalid statement "%s"' % (line_number, line))
+
+    if not messages:
+        raise SchemaError('no messages')
+    if not RE_IDENTIFIER.match(prefix):
+        raise SchemaError('prefix "%s" (schema file name) is not an identifier, set prefix in schema' % prefix)
+
+    return (prefix, messages)
+
+
+def c_field_code(field, encode):
+    """ Straight-line C code that copies one field between msg struct and payload (p points to field) """
+    lines = []
+    for i in range(max(field.count, 1)):
+        member = 'msg->%s[%s]' % (field.name, i) if field.count else 'msg->%s' % field.name
+        offset = i * field.size
+        if field.size == 1:
+            if encode:
+                lines.append('  p[%s] = (uint8_t)%s;' % (offset, member))
+            else:
+                lines.append('  %s = (%s)p[%s];' % (member, field.c_type, offset))
+            continue
+        unsigned = UNSIGNED[field.size]
+        if field.type_name == 'float':  # float is copied as its bit pattern
+            if encode:
+                lines.append('  memcpy(&u%s, &%s, sizeof(u%s));' % (field.size * 8, member, field.size * 8))
+            value = 'u%s' % (field.size * 8)
+        else:
+            value = '(%s)%s' % (unsigned, member)
+        if encode:
+            for b in range(field.size):
+                shift = ' >> %s' % (b * 8) if b else ''
+                lines.append('  p[%s] = (uint8_t)(%s%s);' % (offset + b, value, shift))
+        else:
+            parts = ['((%s)p[%s] << %s)' % (unsigned, offset + b, b * 8) if b else '(%s)p[%s]' % (unsigned, offset)
+                     for b in range(field.size)]
+            if field.type_name == 'float':
+                lines.append('  u%s = %s;' % (field.size * 8, ' | '.join(parts)))
+                lines.append('  memcpy(&%s, &u%s, sizeof(u%s));' % (member, field.size * 8, field.size * 8))
+            else:
+                lines.append('  %s = (%s)(%s);' % (member, field.c_type, ' | '.join(parts)))
+
+    return lines
+
+
+def c_body(message, encode):
+    """ Field copy code of encode/decode function, p walks through payload after opcode """
+    lines = []
+    if any(f.type_name == 'float' for f in message.fields):
+        lines.append('  uint32_t u32;')
+    lines.append('  uint8_t *p = &payload[%s];' % OPCODE_SIZE)
+    lines.append('  ')
+    for f in message.fields:
+        lines.extend(c_field_code(f, encode))
+        lines.append('  p = p + %s;' % f.total_size())
+    if message.fields:
+        lines.pop()  # p is not used after last field
+    else:
+        lines = []
+
+    return lines
+
+
+def generate_c_header(prefix, messages, name):
+    upper = prefix.upper()
+    guard = '__%s_H' % re.sub(r'\W', '_', name.upper())  # file name can contain characters that are not valid in C names
+    out = []
+    out.append('/**')
+    out.append('  ******************************************************************************')
+    out.append('  * File Name          : %s.h' % name)
+    out.append('  * Description        : Simple Data Protocol - %s messages' % prefix)
+    out.append('  *                      Generated by sdp_codegen.py from message schema, do not edit.')
+    out.append('  ******************************************************************************')
+    out.append('*/')
+    out.append('#ifndef %s' % guard)
+    out.append('#define %s' % guard)
+    out.append('')
+    out.append('#include "sdp.h"')
+    out.append('')
+    out.append('/* Opcodes and payload sizes (with opcode) ------------------------------------------------------------------*/')
+    for m in messages:
+        out.append('#define %s_%s_ID 0x%02X' % (upper, m.name.upper(), m.opcode))
+        out.append('#define %s_%s_SIZE %s' % (upper, m.name.upper(), m.size()))
+    out.append('#define %s_MAX_SIZE %s  // node max payload must be at least this size' % (upper, max(m.size() for m in messages)))
+    out.append('')
+    out.append('/* Messages ------------------------------------------------------------------*/')
+    for m in messages:
+        out.append('typedef struct{')
+        for f in m.fields:
+            out.append('  %s %s%s;' % (f.c_type, f.name, '[%s]' % f.count if f.count else ''))
+        if not m.fields:
+            out.append('  uint8_t _reserved; // message without fields')
+        out.append('} %s_%s_t;' % (prefix, m.name))
+        out.append('')
+    out.append('/* Encode & decode ------------------------------------------------------------------*/')
+    for m in messages:
+        out.append('uint8_t %s_encode_%s(%s_%s_t *msg, uint8_t *payload);' % (prefix, m.name, prefix, m.name))
+        out.append('bool %s_decode_%s(uint8_t *payload, uint8_t size, %s_%s_t *msg);' % (prefix, m.name, prefix, m.name))
+    out.append('bool %s_dispatch(SDP_data_t *node, uint8_t *payload, uint8_t size);' % prefix)
+    out.append('')
+    out.append('/* Message handlers (implemented by user) ------------------------------------------------------------------*/')
+    for m in messages:
+        out.append('void %s_handle_%s(SDP_data_t *node, %s_%s_t *msg);' % (prefix, m.name, prefix, m.name))
+    out.append('')
+    out.append('#endif')
+    out.append('')
+
+    return '\n'.join(out)
+
+
+def generate_c_source(prefix, messages, name):
+    upper = prefix.upper()
+    table_size = max(m.opcode for m in messages) + 1
+    by_opcode = dict((m.opcode, m) for m in messages)
+    out = []
+    out.append('/**')
+    out.append('  ******************************************************************************')
+    out.append('  * File Name          : %s.c' % name)
+    out.append('  * Description        : Simple Data Protocol - %s messages' % prefix)
+    out.append('  *                      Generated by sdp_codegen.py from message schema, do not edit.')
+    out.append('  ******************************************************************************')
+    out.append('*/')
+    out.append('#include <string.h>')
+    out.append('')
+    out.append('#include "%s.h"' % name)
+    out.append('')
+    out.append('typedef struct{')
+    out.append('  uint8_t size;  // payload size with opcode')
+    out.append('  void (*handler)(SDP_data_t *node, uint8_t *payload);  // decodes payload and calls user handler')
+    out.append('} %s_dispatch_entry_t;' % prefix)
+    out.append('')
+    out.append('/* Private function prototypes ------------------------------------------------------------------*/')
+    for m in messages:
+        out.append('static void dispatch_%s(SDP_data_t *node, uint8_t *payload);' % m.name)
+    out.append('')
+    out.append('// opcode -> handler, opcodes without message have NULL handler')
+    out.append('static const %s_dispatch_entry_t %s_dispatch_table[%s] = {' % (prefix, prefix, table_size))
+    for opcode in range(table_size):
+        if opcode in by_opcode:
+            m = by_opcode[opcode]
+            entry = '{%s_%s_SIZE, dispatch_%s}' % (upper, m.name.upper(), m.name)
+        else:
+            entry = '{0, NULL}'
+        out.append('  %s%s  // 0x%02X' % (entry, ',' if opcode < table_size - 1 else '', opcode))
+    out.append('};')
+    out.append('')
+    out.append('/* Encode & decode ------------------------------------------------------------------*/')
+    for m in messages:
+        out.append('/**')
+        out.append('* @brief Write opcode and fields of %s message into payload (at least %s_%s_SIZE bytes)' % (m.name, upper, m.name.upper()))
+        out.append('* @retval Returns payload size')
+        out.append('*/')
+        out.append('uint8_t %s_encode_%s(%s_%s_t *msg, uint8_t *payload){' % (prefix, m.name, prefix, m.name))
+        out.extend(c_body(m, True))
+        if m.fields:
+            out.append('  ')
+        else:
+            out.append('  (void)msg; // message without fields')
+        out.append('  payload[0] = %s_%s_ID;' % (upper, m.name.upper()))
+        out.append('  ')
+        out.append('  return %s_%s_SIZE;' % (upper, m.name.upper()))
+        out.append('}')
+        out.append('')
+        out.append('/**')
+        out.append('* @brief Read fields of %s message from payload' % m.name)
+        out.append('* @retval Returns false if opcode or payload size does not match, true otherwise')
+        out.append('*/')
+        out.append('bool %s_decode_%s(uint8_t *payload, uint8_t size, %s_%s_t *msg){' % (prefix, m.name, prefix, m.name))
+        body = c_body(m, False)
+        declarations = [line for line in body if line.startswith('  uint32_t') or line.startswith('  uint8_t *p')]
+        out.extend(declarations)
+        if declarations:
+            out.append('  ')
+        out.append('  if((size != %s_%s_SIZE) || (payload[0] != %s_%s_ID)){' % (upper, m.name.upper(), upper, m.name.upper()))
+        out.append('    return false;')
+        out.append('  }')
+        if not m.fields:
+            out.append('  (void)msg; // message without fields')
+        out.extend([line for line in body if line not in declarations and line != '  '])
+        out.append('  ')
+        out.append('  return true;')
+        out.append('}')
+        out.append('')
+    out.append('/**')
+    out.append('* @brief Pass received payload to message handler selected by opcode (first payload byte). Call this ')
+    out.append('*        function from sdp_user_handle_message() or channel message handler.')
+    out.append('* @retval Returns false if opcode is unknown or payload size does not match message, true otherwise')
+    out.append('*/')
+    out.append('bool %s_dispatch(SDP_data_t *node, uint8_t *payload, uint8_t size){' % prefix)
+    out.append('  const %s_dispatch_entry_t *entry;' % prefix)
+    out.append('  ')
+    if table_size > 0xFF:  # table covers all opcodes, uint8_t opcode can't be out of range
+        out.append('  if(size == 0){')
+    else:
+        out.append('  if((size == 0) || (payload[0] >= %s)){' % table_size)
+    out.append('    return false;')
+    out.append('  }')
+    out.append('  entry = &%s_dispatch_table[payload[0]];' % prefix)
+    out.append('  if((entry->handler == NULL) || (entry->size != size)){')
+    out.append('    return false;')
+    out.append('  }')
+    out.append('  entry->handler(node, payload);')
+    out.append('  ')
+    out.append('  return true;')
+    out.append('}')
+    out.append('')
+    out.append('/* Dispatch ------------------------------------------------------------------*/')
+    for m in messages:
+        out.append('static void dispatch_%s(SDP_data_t *node, uint8_t *payload){' % m.name)
+        out.append('  %s_%s_t msg;' % (prefix, m.name))
+        out.append('  ')
+        if m.fields:
+            out.append('  // opcode and size are already checked')
+            out.append('  %s_decode_%s(payload, %s_%s_SIZE, &msg);' % (prefix, m.name, upper, m.name.upper()))
+        else:
+            out.append('  (void)payload; // message without fields')
+            out.append('  msg._reserved = 0;')
+        out.append('  %s_handle_%s(node, &msg);' % (prefix, m.name))
+        out.append('}')
+        out.append('')
+
+    return '\n'.join(out)
+
+
+def generate_python(prefix, messages, name):
+    out = []
+    out.append('# -*- coding: utf-8 -*-')
+    out.append('"""')
+    out.append('Simple Data Protocol - %s messages' % prefix)
+    out.append('Generated by sdp_codegen.py from message schema, do not edit.')
+    out.append('"""')
+    out.append('import struct')
+    out.append('')
+    out.append('MAX_SIZE = %s  # node max payload must be at least this size' % max(m.size() for m in messages))
+    out.append('')
+    for m in messages:
+        names = [f.name for f in m.fields]
+        out.append('')
+        out.append('class %s(object):' % m.name)
+        out.append('    """ %s message, opcode 0x%02X, %s payload bytes """' % (m.name, m.opcode, m.size()))
+        out.append('    ID = 0x%02X' % m.opcode)
+        out.append('    SIZE = %s' % m.size())
+        out.append("    _struct = struct.Struct('%s')" % m.struct_format())
+        out.append('    __slots__ = (%s)' % ''.join("'%s', " % n for n in names))
+        out.append('')
+        args = ''.join(', %s=%s' % (f.name, '0' if not f.count else 'None') for f in m.fields)
+        out.append('    def __init__(self%s):' % args)
+        for f in m.fields:
+            if f.count:
+                out.append('        self.%s = list(%s) if %s is not None else [0] * %s' % (f.name, f.name, f.name, f.count))
+            else:
+                out.append('        self.%s = %s' % (f.name, f.name))
+        if not m.fields:
+            out.append('        pass')
+        out.append('')
+        out.append('    ########################################################################################')
+        out.append('    def encode(self):')
+        out.append('        """ Return payload (list of bytes) for SDP.send_data() """')
+        values = ['self.ID'] + [('*self.%s' % f.name) if f.count else ('self.%s' % f.name) for f in m.fields]
+        out.append('        return list(self._struct.pack(%s))' % ', '.join(values))
+        out.append('')
+        out.append('    ########################################################################################')
+        out.append('    @classmethod')
+        out.append('    def decode(cls, payload):')
+        out.append('        """ Return message from received payload, None if opcode or size does not match """')
+        out.append('        if (len(payload) != cls.SIZE) or (payload[0] != cls.ID):')
+        out.append('            return None')
+        out.append('        values = cls._struct.unpack(bytes(bytearray(payload)))')
+        out.append('        msg = cls.__new__(cls)')
+        index = 1
+        for f in m.fields:
+            if f.count:
+                out.append('        msg.%s = list(values[%s:%s])' % (f.name, index, index + f.count))
+                index = index + f.count
+            else:
+                out.append('        msg.%s = values[%s]' % (f.name, index))
+                index = index + 1
+        out.append('')
+        out.append('        return msg')
+        out.append('')
+        out.append('    ########################################################################################')
+        out.append('    def __repr__(self):')
+        fields = ', '.join('%s=%%r' % n for n in names)
+        if names:
+            out.append("        return '%s(%s)' %% (%s, )" % (m.name, fields, ', '.join('self.%s' % n for n in names)))
+        else:
+            out.append("        return '%s()'" % m.name)
+        out.append('')
+    out.append('')
+    out.append('MESSAGES = {%s}  # opcode -> message class' % ', '.join('0x%02X: %s' % (m.opcode, m.name) for m in messages))
+    out.append('')
+    out.append('')
+    out.append('def decode(payload):')
+    out.append('    """ Return message object selected by opcode (first payload byte), None if opcode or size is invalid """')
+    out.append('    if not payload:')
+    out.append('        return None')
+    out.append('    cls = MESSAGES.get(payload[0])')
+    out.append('    if cls is None:')
+    out.append('        return None')
+    out.append('')
+    out.append('    return cls.decode(payload)')
+    out.append('')
+
+    return '\n'.join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate SDP message codecs (C and python) from schema file')
+    parser.add_argument('schema', help='message schema file')
+    parser.add_argument('--c-dir', help='output folder of <name>.h and <name>.c')
+    parser.add_argument('--py-dir', help='output folder of <name>.py')
+    parser.add_argument('--name', help='output file name (default: schema file name)')
+    args = parser.parse_args()
+
+    name = args.name or os.path.splitext(os.path.basename(args.schema))[0]
+    with open(args.schema) as f:
+        text = f.read()
+    try:
+        (prefix, messages) = parse_schema(text, name)
+    except SchemaError as e:
+        sys.stderr.write('%s: %s\n' % (args.schema, e))
+        return 1
+
+    outputs = []
+    if args.c_dir is not None:
+        outputs.append((os.path.join(args.c_dir, name + '.h'), generate_c_header(prefix, messages, name)))
+        outputs.append((os.path.join(args.c_dir, name + '.c'), generate_c_source(prefix, messages, name)))
+    if args.py_dir is not None:
+        outputs.append((os.path.join(args.py_dir, name + '.py'), generate_python(prefix, messages, name)))
+    if not outputs:
+        sys.stderr.write('no output folder (--c-dir, --py-dir)\n')
+        return 1
+    for (path, content) in outputs:
+        with open(path, 'w') as f:
+            f.write(content)
+        print('%s: %s messages -> %s' % (args.schema, len(messages), path))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -58,6 +58,10 @@ def main():
 
     sdp_node.s.set_timeouts(0.7, 0.2)   # rx = 0.5 sec, tx = 0.2 sec
 
+    # agree on best common framing and max payload with microcontroller (initial settings are kept on failure)
+    if not sdp_node.negotiate():
+        print('Link negotiation failed, initial settings are used.')
+
     print("\nHit key \'s\' to send data and \'ESC\' to quit.\n")
 
     while True:
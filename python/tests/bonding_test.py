@@ -0,0 +1,115 @@
+# -*- coding: utf-8 -*-
+"""
+Simple Data Protocol - link bonding regression test
+Sender and receiver bond LINKS python nodes each, links are pseudo terminal pairs (Linux) with paced relay. Every
+DELAY_EVERY-th frame on first link is delayed by DELAY, longer than receiver waits for missing frame (its own, shorter
+timeout) but shorter than sender's response timeout - receiver skips frame before it arrives. Checks:
+ - receiver passes frames to message handler in sequence order
+ - each frame that sender reports as delivered (request.status) was passed to message handler of receiver and each
+   frame that sender reports as failed was not (late skipped frame must not be acknowledged)
+
+# python python/tests/bonding_test.py
+"""
+
+import heapq
+import os
+import select
+import sys
+import threading
+import time as systime
+import tty
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+import sdp
+
+LINKS = 2
+FRAMES = 200
+RATE = 3000  # [bytes/s] per link direction
+DELAY_EVERY = 15
+DELAY = 0.35  # [s]
+SENDER_RESPONSE_TIMEOUT = 0.5  # [s]
+RECEIVER_RESPONSE_TIMEOUT = 0.05  # [s] missing frame is skipped after this time * (SDP_RETRANSMIT + 1)
+
+
+def relay(src, dst, delay_every):
+    """ Forward bursts (frames) from src to dst with RATE, every delay_every-th burst is delivered DELAY later """
+    pending = []
+    lock = threading.Lock()
+
+    def deliver():
+        while True:
+            with lock:
+                now = systime.time()
+                while pending and (pending[0][0] <= now):
+                    os.write(dst, heapq.heappop(pending)[2])
+            systime.sleep(0.001)
+
+    threading.Thread(target=deliver, daemon=True).start()
+    count = 0
+    next_time = 0
+    while True:
+        data = os.read(src, 4096)
+        while select.select([src], [], [], 0.002)[0]:
+            data = data + os.read(src, 4096)
+        count = count + 1
+        next_time = max(next_time, systime.time()) + len(data) / RATE
+        if delay_every and ((count % delay_every) == 0):
+            deliver_time = next_time + DELAY
+        else:
+            deliver_time = next_time
+        with lock:
+            heapq.heappush(pending, (deliver_time, count, data))
+
+
+def create_node(port, handler, response_timeout):
+    ser = sdp.SDP_serial()
+    ser.serial_init(port, 115200)
+    node = sdp.SDP(handler, ser, 0, 50)
+    node.set_options(sdp.SDP_OPTION_REQUEST_ID)
+    node.response_timeout = response_timeout
+    node.ack_timeout = response_timeout
+
+    return node
+
+
+received = []
+statuses = {}
+tx_nodes = []
+rx_nodes = []
+for link in range(LINKS):
+    (tx_master, tx_slave) = os.openpty()
+    (rx_master, rx_slave) = os.openpty()
+    for fd in (tx_master, tx_slave, rx_master, rx_slave):
+        tty.setraw(fd)
+    threading.Thread(target=relay, args=(tx_master, rx_master, DELAY_EVERY if (link == 0) else 0), daemon=True).start()
+    threading.Thread(target=relay, args=(rx_master, tx_master, 0), daemon=True).start()
+    tx_nodes.append(create_node(os.ttyname(tx_slave), lambda node_id, payload: None, SENDER_RESPONSE_TIMEOUT))
+    rx_nodes.append(create_node(os.ttyname(rx_slave), lambda node_id, payload: received.append(payload[0] | (payload[1] << 8)),
+                                RECEIVER_RESPONSE_TIMEOUT))
+tx_nodes[0].set_bond(tx_nodes[1:])
+rx_nodes[0].set_bond(rx_nodes[1:])
+for node in tx_nodes + rx_nodes:
+    node.enable_receiver()
+systime.sleep(0.1)
+
+for i in range(FRAMES):
+    while tx_nodes[0].send_bonded([i & 0xFF, i >> 8, 0x55], lambda request, i=i: statuses.update({i: request.status})) is None:
+        systime.sleep(0.002)  # all links busy
+timeout = systime.time() + SENDER_RESPONSE_TIMEOUT * (sdp.SDP_RETRANSMIT + 2)
+while (len(statuses) < FRAMES) and (systime.time() < timeout):
+    systime.sleep(0.01)
+systime.sleep(0.2)
+for node in tx_nodes + rx_nodes:
+    node.disable_receiver()
+
+delivered = set(i for i in statuses if statuses[i])
+in_order = all(received[i] < received[i + 1] for i in range(len(received) - 1))
+false_success = delivered - set(received)
+false_failure = set(i for i in statuses if not statuses[i]) & set(received)
+print("sent %s, reported delivered %s, failed %s, received %s (in order %s), skipped %s" %
+      (FRAMES, len(delivered), len(statuses) - len(delivered), len(received), in_order, rx_nodes[0].rx_dropped))
+print("reported delivered but lost %s, reported failed but delivered %s" % (sorted(false_success), sorted(false_failure)))
+
+failed = (len(statuses) != FRAMES) or (not in_order) or false_success or false_failure
+print("FAILED" if failed else "OK")
+sys.exit(1 if failed else 0)
@@ -0,0 +1,151 @@
+# -*- coding: utf-8 -*-
+"""
+Simple Data Protocol - message schema code generator regression test
+Generates C and python codecs of codegen_test.sdpi into temporary folder (file name with '-', so include guard must be
+sanitized). Checks:
+ - python round trip: decode(encode(message)) returns equal fields for each message, invalid payloads return None
+ - C round trip (if gcc is available): generated C compiles without warnings (-Wall -Wextra -Wtype-limits), python
+   payloads dispatched in C are decoded, encoded again by message handler and equal to original payload
+ - invalid names (reserved, keywords, non-identifiers) are rejected with SchemaError
+
+# python python/tests/codegen_test.py
+"""
+
+import importlib.util
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+import sdp_codegen
+
+SCHEMA = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'codegen_test.sdpi')
+NAME = 'codegen-test'
+VALUES = {  # message name -> field values
+    'set_speed': {'rpm': -1234, 'ramp_ms': 200},
+    'read_adc': {'samples': [0, 1, 0x7E7D, 0xFFFF], 'offset': -128},
+    'status': {'uptime_ms': 0xDEADBEEF, 'position': -100000, 'temperature': 21.5, 'gains': [1.0, -0.25, 1e6],
+               'flags': [0x7E, 0x00]},
+    'ping': {},
+    'last': {'value': 0xFF},
+}
+INVALID_SCHEMAS = [
+    'message ID 0x01',
+    'message m 0x01\n    uint8 encode',
+    'message m 0x01\n    uint8 SIZE',
+    'message m 0x01\n    uint8 self',
+    'message while 0x01',
+    'message m 0x01\n    uint8 int',
+    'message m 0x01\n    uint8 lambda',
+    'message m 0x01\n    uint8 my-field',
+    'message m-1 0x01',
+    'prefix my-prefix\nmessage m 0x01',
+]
+C_STUB = """
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+typedef struct SDP_data_t SDP_data_t;
+"""
+
+
+def c_main(prefix, messages):
+    """ C program: dispatch each argument (hex payload), handlers print payload encoded again ('-' if not dispatched) """
+    out = ['#include <stdio.h>', '#include <stdlib.h>', '#include <string.h>', '#include "%s.h"' % NAME, '']
+    out.append('static void print_payload(uint8_t *payload, uint8_t size){')
+    out.append('  uint8_t i;')
+    out.append('  for(i = 0; i < size; i++) printf("%02x", payload[i]);')
+    out.append('  printf("\\n");')
+    out.append('}')
+    for m in messages:
+        out.append('void %s_handle_%s(SDP_data_t *node, %s_%s_t *msg){' % (prefix, m.name, prefix, m.name))
+        out.append('  uint8_t payload[%s_MAX_SIZE];' % prefix.upper())
+        out.append('  (void)node;')
+        out.append('  print_payload(payload, %s_encode_%s(msg, payload));' % (prefix, m.name))
+        out.append('}')
+    out.append('int main(int argc, char **argv){')
+    out.append('  uint8_t payload[256];')
+    out.append('  unsigned int value;')
+    out.append('  size_t i;')
+    out.append('  int arg;')
+    out.append('  for(arg = 1; arg < argc; arg++){')
+    out.append('    for(i = 0; i < strlen(argv[arg]) / 2; i++){')
+    out.append('      sscanf(&argv[arg][i * 2], "%2x", &value);')
+    out.append('      payload[i] = (uint8_t)value;')
+    out.append('    }')
+    out.append('    if(!%s_dispatch(NULL, payload, (uint8_t)i)) printf("-\\n");' % prefix)
+    out.append('  }')
+    out.append('  return 0;')
+    out.append('}')
+    out.append('')
+
+    return '\n'.join(out)
+
+
+failed = False
+folder = tempfile.mkdtemp()
+try:
+    subprocess.check_call([sys.executable, os.path.join(os.path.dirname(sdp_codegen.__file__), 'sdp_codegen.py'), SCHEMA,
+                           '--c-dir', folder, '--py-dir', folder, '--name', NAME])
+    with open(SCHEMA) as f:
+        (prefix, messages) = sdp_codegen.parse_schema(f.read(), NAME)
+    spec = importlib.util.spec_from_file_location('codegen_test_messages', os.path.join(folder, NAME + '.py'))
+    messages_py = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(messages_py)
+
+    # python round trip
+    payloads = []
+    for m in messages:
+        msg = getattr(messages_py, m.name)(**VALUES[m.name])
+        payload = msg.encode()
+        decoded = messages_py.decode(payload)
+        ok = (decoded is not None) and all(getattr(decoded, k) == v for (k, v) in VALUES[m.name].items())
+        ok = ok and (len(payload) == m.size()) and (messages_py.decode(payload[:-1]) is None)
+        print("python %s: payload %s, round trip %s" % (m.name, bytearray(payload).hex(), 'OK' if ok else 'FAILED'))
+        failed = failed or (not ok)
+        payloads.append(payload)
+    ok = (messages_py.decode([]) is None) and (messages_py.decode([0x03]) is None)
+    print("python invalid opcode: %s" % ('OK' if ok else 'FAILED'))
+    failed = failed or (not ok)
+
+    # C round trip
+    with open(os.path.join(folder, NAME + '.h')) as f:
+        ok = '#ifndef __CODEGEN_TEST_H' in f.read()
+    print("C include guard: %s" % ('OK' if ok else 'FAILED'))
+    failed = failed or (not ok)
+    if shutil.which('gcc') is None:
+        print("C round trip: skipped, gcc not found")
+    else:
+        with open(os.path.join(folder, 'sdp.h'), 'w') as f:
+            f.write(C_STUB)
+        with open(os.path.join(folder, 'main.c'), 'w') as f:
+            f.write(c_main(prefix, messages))
+        program = os.path.join(folder, 'codegen_test')
+        result = subprocess.run(['gcc', '-std=c99', '-Wall', '-Wextra', '-Wtype-limits', '-Werror', '-I', folder,
+                                 os.path.join(folder, NAME + '.c'), os.path.join(folder, 'main.c'), '-o', program],
+                                stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+        if result.returncode != 0:
+            print("C compile: FAILED\n%s" % result.stdout)
+            failed = True
+        else:
+            invalid = ['', '03', bytearray(payloads[0][:-1]).hex()]  # empty, unknown opcode, invalid size
+            args = [bytearray(p).hex() for p in payloads] + invalid
+            lines = subprocess.check_output([program] + args, universal_newlines=True).split()
+            ok = lines == [bytearray(p).hex() for p in payloads] + ['-'] * len(invalid)
+            print("C round trip: %s" % ('OK' if ok else 'FAILED %s' % lines))
+            failed = failed or (not ok)
+finally:
+    shutil.rmtree(folder)
+
+for schema in INVALID_SCHEMAS:
+    try:
+        sdp_codegen.parse_schema(schema, 'test')
+        print("invalid schema %r: accepted, FAILED" % schema)
+        failed = True
+    except sdp_codegen.SchemaError as e:
+        print("invalid schema %r: %s" % (schema, e))
+
+print("FAILED" if failed else "OK")
+sys.exit(1 if failed else 0)
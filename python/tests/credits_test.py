@@ -0,0 +1,143 @@
+# -*- coding: utf-8 -*-
+"""
+Simple Data Protocol - credits option (flow control) regression test
+Sender floods receiver with unpaced datagrams through pseudo terminals (Linux). Relay emulates rx buffer of MCU: it
+holds RX_BUFFER bytes and passes them to receiver with RATE, incoming bytes that don't fit overflow the buffer.
+Receiver advertises free space of this buffer as credits. Payloads are full of special characters, so DLE framing
+doubles frame size - credits must be counted with worst case frame size. Checks:
+ - rx buffer never overflows
+ - every datagram (and request sent as probe when credits run out) is passed to message handler of receiver
+ - with each framing, request that receiver doesn't answer (credits option without request ID option) doesn't block 
+   following requests - they are sent as probes
+
+# python python/tests/credits_test.py
+"""
+
+import os
+import select
+import sys
+import threading
+import time as systime
+import tty
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+import sdp
+
+DATAGRAMS = 200
+MAX_PAYLOAD = 50
+RX_BUFFER = 512  # [bytes]
+RATE = 4000  # [bytes/s] rx buffer is emptied with this rate
+RESPONSE_TIMEOUT = 0.5  # [s] longer than time to empty full rx buffer
+NO_RESPONSE = 0xEE  # receiver doesn't answer request with this first payload byte
+REQUESTS = 5  # answered requests after unanswered one
+
+
+class RxBuffer():
+    """ Rx buffer of emulated MCU between master sides of sender and receiver pseudo terminal """
+
+    def __init__(self, src, dst):
+        self.data = bytearray()
+        self.overflows = 0
+        self.lock = threading.Lock()
+        self.update_credit()
+        threading.Thread(target=self.fill, args=(src,), daemon=True).start()
+        threading.Thread(target=self.empty, args=(dst,), daemon=True).start()
+
+    def update_credit(self):
+        # python node advertises _SDP_MAX_CREDIT - receiver advertises free space of this buffer instead
+        sdp._SDP_MAX_CREDIT = min(0xFF, (RX_BUFFER - len(self.data)) // sdp.SDP_CREDIT_UNIT)
+
+    def fill(self, src):
+        while True:
+            data = os.read(src, 4096)
+            with self.lock:
+                if (len(self.data) + len(data)) > RX_BUFFER:
+                    self.overflows = self.overflows + 1  # MCU flushes rx buffer
+                    self.data = bytearray()
+                else:
+                    self.data.extend(data)
+                self.update_credit()
+
+    def empty(self, dst):
+        while True:
+            systime.sleep(0.005)
+            with self.lock:
+                size = min(len(self.data), int(RATE * 0.005))
+                data = bytes(self.data[:size])
+                del self.data[:size]
+            if data:
+                os.write(dst, data)
+                with self.lock:
+                    self.update_credit()
+
+
+def relay(src, dst):
+    """ Forward bytes from src to dst (responses of receiver) """
+    while True:
+        select.select([src], [], [])
+        os.write(dst, os.read(src, 4096))
+
+
+def create_link(framing):
+    """ Return sender and receiver node (with given framing) and RxBuffer between them """
+    ptys = [os.openpty() for _ in range(2)]
+    for (master, slave) in ptys:
+        tty.setraw(master)
+        tty.setraw(slave)
+    rx_buffer = RxBuffer(ptys[0][0], ptys[1][0])
+    threading.Thread(target=relay, args=(ptys[1][0], ptys[0][0]), daemon=True).start()
+    nodes = []
+    for (handler, (_, slave)) in zip((lambda node_id, payload: None, message_handler), ptys):
+        ser = sdp.SDP_serial()
+        ser.serial_init(os.ttyname(slave), 115200)
+        node = sdp.SDP(handler, ser, 0, MAX_PAYLOAD, framing)
+        node.set_options(sdp.SDP_OPTION_CREDITS)
+        node.response_timeout = RESPONSE_TIMEOUT
+        node.ack_timeout = RESPONSE_TIMEOUT
+        node.enable_receiver()
+        nodes.append(node)
+    systime.sleep(0.1)
+
+    return (nodes[0], nodes[1], rx_buffer)
+
+
+def message_handler(node_id, payload):
+    if payload[0] != NO_RESPONSE:
+        received.append(payload[0] | (payload[1] << 8))
+        receiver.send_response([])
+
+
+received = []
+(sender, receiver, rx_buffer) = create_link(sdp.SDP_FRAMING_DLE)
+sender.tx_qos = sdp.SDP_QOS_DATAGRAM
+
+sent = 0
+for i in range(DATAGRAMS):
+    # each payload byte is special character of DLE framing (except sequence number)
+    if sender.send_data([i & 0xFF, i >> 8] + [sdp._SDP_SOF, sdp._SDP_DLE] * ((MAX_PAYLOAD - 2) // 2))[0]:
+        sent = sent + 1
+timeout = systime.time() + RESPONSE_TIMEOUT * 2
+while (len(received) < sent) and (systime.time() < timeout):
+    systime.sleep(0.01)
+sender.disable_receiver()
+receiver.disable_receiver()
+
+print("sent %s/%s, received %s, rx buffer overflows %s, credit stalls %s, dropped %s" %
+      (sent, DATAGRAMS, len(received), rx_buffer.overflows, sender.credit_stalls, receiver.rx_dropped))
+failed = (sent != DATAGRAMS) or (len(received) != DATAGRAMS) or (rx_buffer.overflows != 0)
+
+for framing in (sdp.SDP_FRAMING_DLE, sdp.SDP_FRAMING_COBS, sdp.SDP_FRAMING_LENGTH):
+    (sender, receiver, rx_buffer) = create_link(framing)
+    lost = sender.send_data([NO_RESPONSE, 0])[0]
+    answered = 0
+    for i in range(REQUESTS):
+        if sender.send_data([i, 0])[0]:
+            answered = answered + 1
+    sender.disable_receiver()
+    receiver.disable_receiver()
+    print("framing %s: unanswered request status %s, following requests answered %s/%s" %
+          (framing, lost, answered, REQUESTS))
+    failed = failed or lost or (answered != REQUESTS)
+
+print("FAILED" if failed else "OK")
+sys.exit(1 if failed else 0)
@@ -0,0 +1,113 @@
+# -*- coding: utf-8 -*-
+"""
+Simple Data Protocol - FEC option cost benchmark
+Compare Reed-Solomon forward error correction (SDP_OPTION_FEC) with plain retransmission on noisy links.
+
+1. Measure python encode/decode time of one frame (C library on MCU is slower, but runs on each frame only when
+   CRC check fails - decode, and on each transmitted frame - encode).
+2. Calculate link efficiency (payload bytes / transmitted bytes, including retransmissions) for different bit error
+   rates, with and without FEC, and verify the model with random corruption of real frames.
+
+# python python/tests/fec_benchmark.py
+"""
+
+import os
+import random
+import sys
+import timeit
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+import sdp
+
+PAYLOAD_SIZES = [16, 64, 200]
+BIT_ERROR_RATES = [1e-6, 1e-5, 1e-4, 3e-4, 1e-3, 3e-3]
+# length framing: SOF + ACK + FLAGS + LEN + HCRC (header is not protected with parity bytes)
+HEADER_SIZE = 1 + 3 + 2
+CRC_SIZE = 2
+# failed frame also costs NACK frame (header + reason + CRC) and turnaround [byte times]
+RETRY_COST = HEADER_SIZE + 1 + CRC_SIZE + 10
+TIMING_REPEAT = 200
+SIMULATED_FRAMES = 5000
+
+
+def binomial(n, k, p):
+    """ Probability of exactly k events in n trials """
+    coef = 1
+    for i in range(k):
+        coef = coef * (n - i) // (i + 1)
+
+    return coef * (p ** k) * ((1 - p) ** (n - k))
+
+
+def frame_success(payload_size, ber, fec_size):
+    """ Probability that frame is accepted by receiver (byte error rate is derived from bit error rate) """
+    q = 1 - (1 - ber) ** 8
+    header_ok = (1 - q) ** HEADER_SIZE
+    if fec_size == 0:
+        return header_ok * (1 - q) ** (payload_size + CRC_SIZE)
+
+    codeword = payload_size + fec_size
+    corrected = sum(binomial(codeword, k, q) for k in range(1, fec_size // 2 + 1))
+    # no codeword errors: corrupted CRC is ignored, corrected codeword must match CRC
+    return header_ok * (binomial(codeword, 0, q) + corrected * (1 - q) ** CRC_SIZE)
+
+
+def efficiency(payload_size, ber, fec_size):
+    """ Payload bytes / transmitted byte times, retransmitted until frame is accepted """
+    frame_size = HEADER_SIZE + payload_size + fec_size + CRC_SIZE
+    success = frame_success(payload_size, ber, fec_size)
+    attempts = 1 / success
+
+    return payload_size / (frame_size * attempts + RETRY_COST * (attempts - 1))
+
+
+def simulate(fec, payload_size, ber):
+    """ Corrupt random frames (without header) and count frames that decoder repairs or leaves intact """
+    accepted = 0
+    for _ in range(SIMULATED_FRAMES):
+        message = [random.randint(0, 255) for _ in range(payload_size)]
+        codeword = message + fec.encode(message)
+        received = list(codeword)
+        for i in range(len(received)):
+            for bit in range(8):
+                if random.random() < ber:
+                    received[i] = received[i] ^ (1 << bit)
+        if (fec.decode(received) >= 0) and (received == codeword):
+            accepted = accepted + 1
+
+    return accepted / SIMULATED_FRAMES
+
+
+fec = sdp.SDP_fec(sdp.SDP_FEC_SIZE)
+
+print("\nFEC cost benchmark, SDP_FEC_SIZE = %s (corrects %s bytes per frame)" % (sdp.SDP_FEC_SIZE, sdp.SDP_FEC_SIZE // 2))
+
+print("\nPython encode/decode time per frame:")
+for size in PAYLOAD_SIZES:
+    message = [random.randint(0, 255) for _ in range(size)]
+    codeword = message + fec.encode(message)
+    corrupted = list(codeword)
+    corrupted[size // 2] = corrupted[size // 2] ^ 0x55
+    encode_time = timeit.timeit(lambda: fec.encode(message), number=TIMING_REPEAT) / TIMING_REPEAT * 1000
+    check_time = timeit.timeit(lambda: fec.decode(list(codeword)), number=TIMING_REPEAT) / TIMING_REPEAT * 1000
+    correct_time = timeit.timeit(lambda: fec.decode(list(corrupted)), number=TIMING_REPEAT) / TIMING_REPEAT * 1000
+    print("\t%3s bytes: encode %.3f ms, decode (no errors) %.3f ms, decode (1 error) %.3f ms" %
+          (size, encode_time, check_time, correct_time))
+
+print("\nLink efficiency (payload / transmitted bytes, with retransmissions), length framing:")
+print("\t%8s %8s %10s %10s %8s" % ('payload', 'BER', 'no FEC', 'FEC', 'use'))
+for size in PAYLOAD_SIZES:
+    for ber in BIT_ERROR_RATES:
+        plain = efficiency(size, ber, 0)
+        coded = efficiency(size, ber, sdp.SDP_FEC_SIZE)
+        print("\t%8s %8.0e %9.1f%% %9.1f%% %8s" % (size, ber, plain * 100, coded * 100, 'FEC' if coded > plain else 'retry'))
+
+print("\nModel check - accepted frames (header errors excluded), %s random frames:" % SIMULATED_FRAMES)
+for size in PAYLOAD_SIZES:
+    ber = 1e-3
+    q = 1 - (1 - ber) ** 8
+    codeword = size + sdp.SDP_FEC_SIZE
+    model = sum(binomial(codeword, k, q) for k in range(0, sdp.SDP_FEC_SIZE // 2 + 1))
+    print("\t%3s bytes, BER %.0e: simulated %.3f, model %.3f" % (size, ber, simulate(fec, size, ber), model))
+
+print("OVER")
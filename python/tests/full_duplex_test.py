@@ -0,0 +1,97 @@
+# -*- coding: utf-8 -*-
+"""
+Simple Data Protocol - full-duplex (request ID option) regression test
+Two python nodes are connected through pseudo terminals (Linux). Both send blocking send_data() requests at random
+offsets, so requests of the other node arrive while each node waits for its own response. Message handler takes
+HANDLER_TIME (close to response timeout), which must not be counted into response timeout of waiting node.
+Responses are marked, so request of other node that would be taken as response is detected. Blocking send_data()
+called from message handler must be rejected.
+
+# python python/tests/full_duplex_test.py
+"""
+
+import os
+import random
+import select
+import sys
+import threading
+import time as systime
+import tty
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+import sdp
+
+REQUESTS = 40
+HANDLER_TIME = 0.04  # [s]
+RESPONSE_TIMEOUT = 0.055  # [s]
+RESPONSE_MARK = 0xA5
+MAX_SPURIOUS_TIMEOUTS = 4  # of 2 * REQUESTS, pseudo terminal and thread scheduling jitter
+
+
+def relay(fds):
+    """ Forward bytes between master sides of two pseudo terminals (null modem cable) """
+    while True:
+        (readable, _, _) = select.select(fds, [], [])
+        for fd in readable:
+            data = os.read(fd, 4096)
+            os.write(fds[1] if fd == fds[0] else fds[0], data)
+
+
+class Peer():
+    def __init__(self, node_id, port):
+        self.handled = 0
+        self.nested_rejected = 0
+        self.ok = 0
+        self.wrong = 0
+        ser = sdp.SDP_serial()
+        ser.serial_init(port, 115200)
+        self.node = sdp.SDP(self.message_handler, ser, node_id, 50)
+        self.node.set_options(sdp.SDP_OPTION_REQUEST_ID)
+        self.node.response_timeout = RESPONSE_TIMEOUT
+        self.node.enable_receiver()
+
+    def message_handler(self, node_id, payload):
+        self.handled = self.handled + 1
+        systime.sleep(HANDLER_TIME)
+        if not self.node.send_data([0])[0]:
+            self.nested_rejected = self.nested_rejected + 1
+        self.node.send_response([RESPONSE_MARK] + list(payload))
+
+    def run(self, origin):
+        for i in range(REQUESTS):
+            systime.sleep(random.random() * 0.03)
+            payload = [origin, i, random.randint(0, 255)]
+            (status, response) = self.node.send_data(payload)
+            if status:
+                if response == [RESPONSE_MARK] + payload:
+                    self.ok = self.ok + 1
+                else:
+                    self.wrong = self.wrong + 1
+
+
+ptys = [os.openpty() for _ in range(2)]
+for (master, slave) in ptys:
+    tty.setraw(master)
+    tty.setraw(slave)
+threading.Thread(target=relay, args=([master for (master, _) in ptys],), daemon=True).start()
+
+peers = [Peer(node_id, os.ttyname(slave)) for (node_id, (_, slave)) in enumerate(ptys)]
+systime.sleep(0.1)
+threads = [threading.Thread(target=peer.run, args=(0x10 + i,)) for (i, peer) in enumerate(peers)]
+for thread in threads:
+    thread.start()
+for thread in threads:
+    thread.join()
+systime.sleep(0.2)
+for peer in peers:
+    peer.node.disable_receiver()
+
+failed = False
+for (i, peer) in enumerate(peers):
+    print("node %s: responses %s/%s, wrong %s, handled %s, nested send_data() rejected %s" %
+          (i, peer.ok, REQUESTS, peer.wrong, peer.handled, peer.nested_rejected))
+    failed = failed or (peer.wrong != 0) or (peer.nested_rejected != peer.handled)
+failed = failed or ((2 * REQUESTS - sum(peer.ok for peer in peers)) > MAX_SPURIOUS_TIMEOUTS)
+
+print("FAILED" if failed else "OK")
+sys.exit(1 if failed else 0)